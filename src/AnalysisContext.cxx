@@ -0,0 +1,153 @@
+/*
+ * AnalysisContext.cxx
+ */
+
+#include "AnalysisContext.h"
+
+#include <TDirectory.h>
+#include <TTree.h>
+
+/*
+ * The event display snapshots are stored as the entries of the tree <name> so that they are read
+ * back in the same order
+ */
+static void writeEventDisplays(
+		const std::vector<EventDisplaySnapshot>& displays, const char* name) {
+	EventDisplaySnapshot snapshot;
+	std::string* suffix = &snapshot.suffix;
+	std::vector<unsigned int>* stripsX = &snapshot.stripsX;
+	std::vector<short>* chargesX = &snapshot.chargesX;
+	std::vector<unsigned int>* stripsY = &snapshot.stripsY;
+	std::vector<short>* chargesY = &snapshot.chargesY;
+
+	TTree tree(name, "event display snapshots");
+	tree.Branch("eventNumber", &snapshot.eventNumber, "eventNumber/I");
+	tree.Branch("suffix", &suffix);
+	tree.Branch("numberOfTimeSlices", &snapshot.numberOfTimeSlices,
+			"numberOfTimeSlices/i");
+	tree.Branch("stripsX", &stripsX);
+	tree.Branch("chargesX", &chargesX);
+	tree.Branch("stripsY", &stripsY);
+	tree.Branch("chargesY", &chargesY);
+	for (auto& display : displays) {
+		snapshot = display;
+		tree.Fill();
+	}
+	tree.Write();
+}
+
+static void readEventDisplays(TDirectory* directory,
+		std::vector<EventDisplaySnapshot>& displays, const char* name) {
+	TTree* tree = (TTree*) directory->Get(name);
+	if (tree == NULL) {
+		return;
+	}
+
+	EventDisplaySnapshot snapshot;
+	std::string* suffix = &snapshot.suffix;
+	std::vector<unsigned int>* stripsX = &snapshot.stripsX;
+	std::vector<short>* chargesX = &snapshot.chargesX;
+	std::vector<unsigned int>* stripsY = &snapshot.stripsY;
+	std::vector<short>* chargesY = &snapshot.chargesY;
+
+	tree->SetBranchAddress("eventNumber", &snapshot.eventNumber);
+	tree->SetBranchAddress("suffix", &suffix);
+	tree->SetBranchAddress("numberOfTimeSlices", &snapshot.numberOfTimeSlices);
+	tree->SetBranchAddress("stripsX", &stripsX);
+	tree->SetBranchAddress("chargesX", &chargesX);
+	tree->SetBranchAddress("stripsY", &stripsY);
+	tree->SetBranchAddress("chargesY", &chargesY);
+	for (Long64_t entry = 0; entry < tree->GetEntries(); entry++) {
+		tree->GetEntry(entry);
+		displays.push_back(snapshot);
+	}
+	delete tree;
+}
+
+template<typename Key, typename Histogram>
+static void writeHistograms(HistogramRegistry<Key, Histogram>& histograms) {
+	for (unsigned int i = 0; i < histograms.size; i++) {
+		if (histograms.at(i) != NULL) {
+			TObject* histogram = histograms.at(i)->createRootHistogram();
+			histogram->Write(histograms.getName(i));
+			delete histogram;
+		}
+	}
+}
+
+/*
+ * Adds the histograms written by writeHistograms to the ones in <histograms>. RootHistogram is the
+ * type written for Histogram (TH1F for FastHistogram1D, TH2F for FastHistogram2D)
+ */
+template<typename RootHistogram, typename Key, typename Histogram>
+static bool addHistograms(TDirectory* directory,
+		HistogramRegistry<Key, Histogram>& histograms) {
+	for (unsigned int i = 0; i < histograms.size; i++) {
+		if (histograms.at(i) == NULL) {
+			continue;
+		}
+		RootHistogram* histogram = (RootHistogram*) directory->Get(
+				(std::string("Combined/") + histograms.getName(i)).c_str());
+		if (histogram == NULL) {
+			return false;
+		}
+		histograms.at(i)->add(*histogram);
+		delete histogram;
+	}
+	return true;
+}
+
+void AnalysisContext::writePartial(TDirectory* directory) {
+	directory->cd();
+	directory->mkdir("Combined");
+	directory->cd("Combined");
+	writeHistograms(mapCombined);
+	writeHistograms(mapCombined1D);
+
+	directory->cd();
+	directory->mkdir("Cuts");
+	for (auto& cutStat : cutStatistics) {
+		directory->cd("Cuts");
+		gDirectory->mkdir(cutStat->getName());
+		gDirectory->cd(cutStat->getName());
+		cutStat->counterHistogram.Write("counter");
+		writeEventDisplays(cutStat->eventDisplaysCut.getItems(), "cut");
+		writeEventDisplays(cutStat->eventDisplaysAccepted.getItems(),
+				"accepted");
+	}
+	directory->cd();
+}
+
+bool AnalysisContext::readPartial(TDirectory* directory) {
+	if (!addHistograms<TH2F>(directory, mapCombined)
+			|| !addHistograms<TH1F>(directory, mapCombined1D)) {
+		return false;
+	}
+
+	for (auto& cutStat : cutStatistics) {
+		std::string cutDirectoryName = std::string("Cuts/") + cutStat->getName();
+		TDirectory* cutDirectory = (TDirectory*) directory->Get(
+				cutDirectoryName.c_str());
+		if (cutDirectory == NULL) {
+			return false;
+		}
+		TH1F* counter = (TH1F*) cutDirectory->Get("counter");
+		if (counter == NULL) {
+			return false;
+		}
+
+		// the displays are samples of the events of the partial run and are merged accordingly
+		std::vector<CutStatistic*> registry;
+		CutStatistic partialCutStat(cutStat->getName(), registry);
+		partialCutStat.counterHistogram.Add(counter);
+		delete counter;
+
+		std::vector<EventDisplaySnapshot> cutDisplays, acceptedDisplays;
+		readEventDisplays(cutDirectory, cutDisplays, "cut");
+		readEventDisplays(cutDirectory, acceptedDisplays, "accepted");
+		partialCutStat.setEventDisplays(std::move(cutDisplays),
+				std::move(acceptedDisplays));
+		cutStat->merge(partialCutStat);
+	}
+	return true;
+}
@@ -0,0 +1,311 @@
+/*
+ * AnalysisContext.h
+ */
+
+#ifndef ANALYSISCONTEXT_H_
+#define ANALYSISCONTEXT_H_
+
+#include "CCommonIncludes.h"
+#include "CutFlow.h"
+#include "CutStatistic.h"
+#include "FastHistogram.h"
+#include "HistogramRegistry.h"
+#include "HitEstimator.h"
+#include "IoAudit.h"
+#include "StageTimer.h"
+
+//structure for trees
+struct gauss_t {
+	Double_t gaussXmean;
+	Double_t gaussXmeanError;
+	Double_t gaussXsigma;
+	Double_t gaussXcharge;
+	Double_t gaussXchi;
+	Double_t gaussXdof;
+	Double_t gaussXchiRed;
+	Double_t gaussYmean;
+	Double_t gaussYmeanError;
+	Double_t gaussYsigma;
+	Double_t gaussYcharge;
+	Double_t gaussYchi;
+	Double_t gaussYdof;
+	Double_t gaussYchiRed;
+	Int_t number;
+};
+
+struct maxi_t {
+	Int_t maxXmean;
+	Int_t maxXcharge;
+	Int_t maxXcluster;
+	Int_t maxYmean;
+	Int_t maxYcharge;
+	Int_t maxYcluster;
+	Int_t number;
+};
+
+typedef HistogramRegistry<RunHist1D, FastHistogram1D> FastRunHistograms1D;
+typedef HistogramRegistry<RunHist2D, FastHistogram2D> FastRunHistograms2D;
+typedef HistogramRegistry<CombinedHist1D, FastHistogram1D> FastCombinedHistograms1D;
+typedef HistogramRegistry<CombinedHist2D, FastHistogram2D> FastCombinedHistograms2D;
+
+/**
+ * Everything analyseMMEvent writes to while processing the events of one run: per-run histograms,
+ * this run's part of the combined histograms, the tree records, the cut counters and the hit
+ * estimator. Runs processed concurrently never share a context, so the event loop needs no locks.
+ *
+ * The contexts of the runs are created and merged by the main thread. If a run is split into
+ * several parts, the thread processing the run creates one copy per part (createEmptyCopy) and adds
+ * the copies to the run's context in the order of the parts (add).
+ *
+ * The histograms filled per event are FastHistograms. ROOT histograms are only created when the
+ * run is written (createRootHistograms) or merged into the combined histograms (merge).
+ */
+class AnalysisContext {
+public:
+	FastRunHistograms1D mapHist1D; 	//1D histogram of analysis for each run
+	FastRunHistograms2D mapHist2D;	//2D histogram of analysis for each run
+	std::map<std::string, TH1F*> mapPlotFit;		//plot of fits
+	FastCombinedHistograms2D mapCombined; // contribution of this run to general_mapCombined
+	FastCombinedHistograms1D mapCombined1D; // contribution of this run to general_mapCombined1D
+
+	gauss_t gauss;
+	maxi_t maxi;
+	/*
+	 * One entry per accepted event. The tree "T" is only created when the run is written so that
+	 * no TTree is touched by the worker threads
+	 */
+	std::vector<std::pair<gauss_t, maxi_t> > fitResults;
+
+	std::vector<double> eventTimes;
+	int numberOfProcessedEvents;
+	int numberOfAcceptedEvents;
+
+	IoAudit ioAudit; // see MMQuickEvent::addIoStatistics
+	CutFlowStatistics cutFlowStatistics; // see createCutFlow in MMPlots.cxx
+	StageTimes stageTimes; // collected while processing and writing the run
+
+	HitEstimator* hitEstimator;
+
+	/*
+	 * Cut statistics of this run, registered in cutStatistics instead of CutStatistic::instances.
+	 * The names are the same as the ones of the global instances they are merged into
+	 */
+	std::vector<CutStatistic*> cutStatistics;
+	CutStatistic nocut_EventsWithSmallCharge;
+	CutStatistic nocut_xtimeCutLargeYTimeEvents;
+	CutStatistic timingCuts;
+	CutStatistic timeCoincidenceCuts;
+	CutStatistic chargeCuts;
+	CutStatistic absolutePositionXCuts;
+	CutStatistic absolutePositionYCuts;
+	CutStatistic proportionXCuts;
+	CutStatistic proportionYCuts;
+	CutStatistic fitProblemCuts;
+	CutStatistic fitMeanMaxChargeDistanceCuts;
+
+	/**
+	 * Empty histograms with the binning of the combined histograms are created so that they can
+	 * simply be added to the originals by merge()
+	 */
+	AnalysisContext(const CombinedHistograms1D& combined1D,
+			const CombinedHistograms2D& combined2D,
+			HitEstimator::Type hitEstimatorType) :
+			AnalysisContext(hitEstimatorType) {
+		for (unsigned int i = 0; i < combined1D.size; i++) {
+			if (combined1D.at(i) != NULL) {
+				mapCombined1D.at(i) = new FastHistogram1D(*combined1D.at(i));
+			}
+		}
+		for (unsigned int i = 0; i < combined2D.size; i++) {
+			if (combined2D.at(i) != NULL) {
+				mapCombined.at(i) = new FastHistogram2D(*combined2D.at(i));
+			}
+		}
+	}
+
+	~AnalysisContext() {
+		mapHist1D.deleteAll();
+		mapHist2D.deleteAll();
+		for (auto& pair : mapPlotFit) {
+			delete pair.second;
+		}
+		mapCombined.deleteAll();
+		mapCombined1D.deleteAll();
+		delete hitEstimator;
+	}
+
+	/**
+	 * Seeds the event display samples of all cut statistics for the part <part> of the run
+	 * <runName>, so that every run and part samples its events independently of the others
+	 */
+	void seedEventDisplays(const std::string& runName, unsigned int part) {
+		for (auto& cutStat : cutStatistics) {
+			cutStat->seedEventDisplays(runName, part);
+		}
+	}
+
+	/**
+	 * Returns a new context with empty copies of all histograms of this context. Used for the
+	 * parts of a run processed by different threads, which are added to this context afterwards.
+	 */
+	AnalysisContext* createEmptyCopy() const {
+		AnalysisContext* copy = new AnalysisContext(hitEstimator->getType());
+		cloneEmpty(mapHist1D, copy->mapHist1D);
+		cloneEmpty(mapHist2D, copy->mapHist2D);
+		cloneEmpty(mapCombined1D, copy->mapCombined1D);
+		cloneEmpty(mapCombined, copy->mapCombined);
+		return copy;
+	}
+
+	/**
+	 * Adds everything <other> has collected to this context. <other> must have been processed
+	 * after this context (e.g. a later part of the same run) to keep the order of the tree records.
+	 * The event display samples are merged (see CutStatistic::merge), the plotted fits are moved,
+	 * not copied.
+	 */
+	void add(AnalysisContext& other) {
+		addAll(other.mapHist1D, mapHist1D);
+		addAll(other.mapHist2D, mapHist2D);
+		addAll(other.mapCombined1D, mapCombined1D);
+		addAll(other.mapCombined, mapCombined);
+		for (auto& pair : other.mapPlotFit) {
+			delete mapPlotFit[pair.first];
+			mapPlotFit[pair.first] = pair.second;
+		}
+		other.mapPlotFit.clear();
+
+		fitResults.insert(fitResults.end(), other.fitResults.begin(),
+				other.fitResults.end());
+		eventTimes.insert(eventTimes.end(), other.eventTimes.begin(),
+				other.eventTimes.end());
+		numberOfProcessedEvents += other.numberOfProcessedEvents;
+		numberOfAcceptedEvents += other.numberOfAcceptedEvents;
+		ioAudit.add(other.ioAudit);
+		cutFlowStatistics.add(other.cutFlowStatistics);
+		stageTimes.add(other.stageTimes);
+
+		mergeCutStatistics(other.cutStatistics, cutStatistics);
+	}
+
+	/**
+	 * Adds this run's part of the combined histograms to combined1D/combined2D and its cut
+	 * statistics to the instances with the same name in cutStatistics. Calling merge for the runs
+	 * in a fixed order always gives the same result, the stored event displays are a uniform
+	 * sample of the events of all merged runs.
+	 */
+	void merge(CombinedHistograms1D& combined1D,
+			CombinedHistograms2D& combined2D,
+			std::vector<CutStatistic*>& targetCutStatistics) {
+		addAllToRoot(mapCombined1D, combined1D);
+		addAllToRoot(mapCombined, combined2D);
+		mergeCutStatistics(cutStatistics, targetCutStatistics);
+	}
+
+	/**
+	 * Fills histograms1D/histograms2D with new ROOT histograms with the contents of the per-run
+	 * histograms of this context. The caller owns the new histograms.
+	 */
+	void createRootHistograms(RunHistograms1D& histograms1D,
+			RunHistograms2D& histograms2D) const {
+		for (unsigned int i = 0; i < mapHist1D.size; i++) {
+			if (mapHist1D.at(i) != NULL) {
+				histograms1D.at(i) = mapHist1D.at(i)->createRootHistogram();
+			}
+		}
+		for (unsigned int i = 0; i < mapHist2D.size; i++) {
+			if (mapHist2D.at(i) != NULL) {
+				histograms2D.at(i) = mapHist2D.at(i)->createRootHistogram();
+			}
+		}
+	}
+
+	/**
+	 * Writes everything merge() uses (the combined histograms and the cut statistics including
+	 * the event displays) to <directory>, so that another process can merge this run.
+	 */
+	void writePartial(TDirectory* directory);
+
+	/**
+	 * Adds the histograms and cut statistics written by writePartial to this context. Returns false
+	 * if <directory> does not contain all combined histograms of this context.
+	 */
+	bool readPartial(TDirectory* directory);
+
+private:
+	/**
+	 * Only creates the cut statistics and the hit estimator, the histograms are NULL
+	 */
+	explicit AnalysisContext(HitEstimator::Type hitEstimatorType) :
+			numberOfProcessedEvents(0), numberOfAcceptedEvents(0), hitEstimator(
+					HitEstimator::create(hitEstimatorType)), nocut_EventsWithSmallCharge(
+					"nocut_smallChargeEvents", cutStatistics), nocut_xtimeCutLargeYTimeEvents(
+					"nocut_xtimeCutLargeYTimeEvents", cutStatistics), timingCuts(
+					"a_timingCuts", cutStatistics), timeCoincidenceCuts(
+					"b_timeCoincidenceCuts", cutStatistics), chargeCuts(
+					"c_chargeCuts", cutStatistics), absolutePositionXCuts(
+					"d_absolutePositionXCuts", cutStatistics), absolutePositionYCuts(
+					"e_absolutePositionYCuts", cutStatistics), proportionXCuts(
+					"f_proportionXCuts", cutStatistics), proportionYCuts(
+					"g_proportionYCuts", cutStatistics), fitProblemCuts(
+					"h_fitProblemCuts", cutStatistics), fitMeanMaxChargeDistanceCuts(
+					"i_fitMeanMaxChargeDistanceCuts", cutStatistics) {
+	}
+
+	/**
+	 * Merges every element of source into the element of target with the same name
+	 */
+	static void mergeCutStatistics(std::vector<CutStatistic*>& source,
+			std::vector<CutStatistic*>& target) {
+		for (auto& cutStat : source) {
+			for (auto& targetCutStat : target) {
+				if (std::string(targetCutStat->getName()) == cutStat->getName()) {
+					targetCutStat->merge(*cutStat);
+					break;
+				}
+			}
+		}
+	}
+
+	/**
+	 * Fills every booked slot of target with an empty copy of the histogram in source
+	 */
+	template<typename Key, typename Histogram>
+	static void cloneEmpty(const HistogramRegistry<Key, Histogram>& source,
+			HistogramRegistry<Key, Histogram>& target) {
+		for (unsigned int i = 0; i < source.size; i++) {
+			if (source.at(i) != NULL) {
+				target.at(i) = source.at(i)->createEmptyCopy();
+			}
+		}
+	}
+
+	template<typename Key, typename Histogram>
+	static void addAll(const HistogramRegistry<Key, Histogram>& source,
+			HistogramRegistry<Key, Histogram>& target) {
+		for (unsigned int i = 0; i < source.size; i++) {
+			if (source.at(i) != NULL) {
+				target.at(i)->add(*source.at(i));
+			}
+		}
+	}
+
+	/**
+	 * Adds every histogram of source to the ROOT histogram with the same key in target
+	 */
+	template<typename Key, typename Histogram, typename RootHistogram>
+	static void addAllToRoot(const HistogramRegistry<Key, Histogram>& source,
+			HistogramRegistry<Key, RootHistogram>& target) {
+		for (unsigned int i = 0; i < source.size; i++) {
+			if (source.at(i) != NULL) {
+				RootHistogram* histogram = source.at(i)->createRootHistogram();
+				target.at(i)->Add(histogram);
+				delete histogram;
+			}
+		}
+	}
+
+	AnalysisContext(const AnalysisContext&);
+	AnalysisContext& operator=(const AnalysisContext&);
+};
+
+#endif /* ANALYSISCONTEXT_H_ */
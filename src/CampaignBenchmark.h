@@ -0,0 +1,203 @@
+/*
+ * CampaignBenchmark.h
+ */
+
+#ifndef CAMPAIGNBENCHMARK_H_
+#define CAMPAIGNBENCHMARK_H_
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "IoAudit.h"
+#include "StageTimer.h"
+
+/**
+ * Throughput of a whole campaign (enabled via --benchmark=FILE, see the target campaign-benchmark
+ * of the Makefile): events and bytes read per run, wall time, peak resident set size and the time
+ * per stage, written as JSON so that the results of different commits and machines can be compared
+ * by scripts.
+ *
+ * Only the runs processed by this process are counted. The children of --processes are included in
+ * the peak RSS but not in the events and bytes.
+ */
+class CampaignBenchmark {
+public:
+	CampaignBenchmark() :
+			start(std::chrono::steady_clock::now()) {
+	}
+
+	/**
+	 * Starts the wall time measurement
+	 */
+	void startTimer() {
+		start = std::chrono::steady_clock::now();
+	}
+
+	/**
+	 * Stores a setting of the campaign (e.g. a command line option) written with the results
+	 */
+	void addParameter(const std::string& name, const std::string& value) {
+		parameters.push_back(std::make_pair(name, value));
+	}
+
+	/**
+	 * Adds a processed run. <audit> contains what the readers of the run have read.
+	 */
+	void addRun(const std::string& runName, uint64_t processedEvents,
+			uint64_t acceptedEvents, const IoAudit& audit) {
+		Run run;
+		run.name = runName;
+		run.processedEvents = processedEvents;
+		run.acceptedEvents = acceptedEvents;
+		run.bytesRead = 0;
+		for (auto& file : audit.files) {
+			run.bytesRead += file.bytesRead;
+		}
+		run.uncompressedBytesRead = 0;
+		for (auto& pair : audit.branches) {
+			run.uncompressedBytesRead += pair.second.bytesRead;
+		}
+		runs.push_back(run);
+	}
+
+	/**
+	 * Writes the results up to now and the summed <stageTimes> to <fileName>. Returns false if the
+	 * file could not be written.
+	 */
+	bool write(const std::string& fileName, const StageTimes& stageTimes) const {
+		const double seconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+
+		Run total;
+		total.processedEvents = 0;
+		total.acceptedEvents = 0;
+		total.bytesRead = 0;
+		total.uncompressedBytesRead = 0;
+		for (auto& run : runs) {
+			total.processedEvents += run.processedEvents;
+			total.acceptedEvents += run.acceptedEvents;
+			total.bytesRead += run.bytesRead;
+			total.uncompressedBytesRead += run.uncompressedBytesRead;
+		}
+
+		// ru_maxrss is in kilobytes on Linux
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		const long peakRss = usage.ru_maxrss;
+		getrusage(RUSAGE_CHILDREN, &usage);
+		const long peakRssOfChildren = usage.ru_maxrss;
+
+		char hostName[256] = "";
+		gethostname(hostName, sizeof(hostName) - 1);
+
+		std::ofstream file(fileName.c_str());
+		file << "{" << std::endl;
+		file << "  \"host\": " << quote(hostName) << "," << std::endl;
+		file << "  \"hardwareThreads\": "
+				<< std::thread::hardware_concurrency() << "," << std::endl;
+		file << "  \"parameters\": {";
+		for (unsigned int i = 0; i < parameters.size(); i++) {
+			file << (i == 0 ? "" : ",") << std::endl << "    "
+					<< quote(parameters[i].first) << ": "
+					<< quote(parameters[i].second);
+		}
+		file << std::endl << "  }," << std::endl;
+		file << "  \"wallTimeSeconds\": " << seconds << "," << std::endl;
+		file << "  \"processedEvents\": " << total.processedEvents << ","
+				<< std::endl;
+		file << "  \"acceptedEvents\": " << total.acceptedEvents << ","
+				<< std::endl;
+		file << "  \"eventsPerSecond\": "
+				<< (seconds == 0 ? 0 : total.processedEvents / seconds) << ","
+				<< std::endl;
+		file << "  \"bytesRead\": " << total.bytesRead << "," << std::endl;
+		file << "  \"megaBytesReadPerSecond\": "
+				<< (seconds == 0 ? 0 : total.bytesRead / 1e6 / seconds) << ","
+				<< std::endl;
+		file << "  \"uncompressedBytesRead\": " << total.uncompressedBytesRead
+				<< "," << std::endl;
+		file << "  \"peakRssKiloBytes\": " << peakRss << "," << std::endl;
+		file << "  \"peakRssOfChildrenKiloBytes\": " << peakRssOfChildren << ","
+				<< std::endl;
+
+		/*
+		 * Empty unless compiled with MM_ENABLE_TIMING
+		 */
+		uint64_t totalNanoseconds = 0;
+		for (unsigned int i = 0; i < StageTimes::NUMBER_OF_STAGES; i++) {
+			totalNanoseconds += stageTimes.nanoseconds[i];
+		}
+		file << "  \"stages\": {";
+		bool first = true;
+		for (unsigned int i = 0;
+				i < StageTimes::NUMBER_OF_STAGES && totalNanoseconds != 0; i++) {
+			file << (first ? "" : ",") << std::endl << "    "
+					<< quote(StageTimes::getName(i)) << ": {\"seconds\": "
+					<< stageTimes.nanoseconds[i] / 1e9 << ", \"calls\": "
+					<< stageTimes.calls[i] << ", \"fraction\": "
+					<< (double) stageTimes.nanoseconds[i] / totalNanoseconds
+					<< "}";
+			first = false;
+		}
+		file << std::endl << "  }," << std::endl;
+
+		file << "  \"runs\": [";
+		for (unsigned int i = 0; i < runs.size(); i++) {
+			file << (i == 0 ? "" : ",") << std::endl << "    {\"name\": "
+					<< quote(runs[i].name) << ", \"processedEvents\": "
+					<< runs[i].processedEvents << ", \"acceptedEvents\": "
+					<< runs[i].acceptedEvents << ", \"bytesRead\": "
+					<< runs[i].bytesRead << "}";
+		}
+		file << std::endl << "  ]" << std::endl;
+		file << "}" << std::endl;
+		file.close();
+
+		if (!file) {
+			std::cerr << "Unable to write the benchmark results to " << fileName
+					<< std::endl;
+			return false;
+		}
+		std::cout << "Benchmark: " << total.processedEvents << " events in "
+				<< seconds << " s (" << total.processedEvents / seconds
+				<< " events/s, " << total.bytesRead / 1e6 / seconds
+				<< " MB/s), peak RSS " << peakRss / 1024 << " MB, written to "
+				<< fileName << std::endl;
+		return true;
+	}
+
+private:
+	struct Run {
+		std::string name;
+		uint64_t processedEvents;
+		uint64_t acceptedEvents;
+		uint64_t bytesRead; // from disk
+		uint64_t uncompressedBytesRead;
+	};
+
+	static std::string quote(const std::string& value) {
+		std::string quoted = "\"";
+		for (char c : value) {
+			if (c == '"' || c == '\\') {
+				quoted += '\\';
+			}
+			quoted += c;
+		}
+		return quoted + "\"";
+	}
+
+	std::chrono::steady_clock::time_point start;
+	std::vector<std::pair<std::string, std::string> > parameters;
+	std::vector<Run> runs;
+};
+
+#endif /* CAMPAIGNBENCHMARK_H_ */
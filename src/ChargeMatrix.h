@@ -0,0 +1,121 @@
+/*
+ * ChargeMatrix.h
+ */
+
+#ifndef CHARGEMATRIX_H_
+#define CHARGEMATRIX_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "MMEventView.h"
+
+/**
+ * Contiguous strips x time slices matrix of the charges of one event.
+ *
+ * Every row (strip) is padded with at least one zero to a multiple of ROW_ALIGNMENT shorts and
+ * the buffer starts at a BUFFER_ALIGNMENT byte boundary so that SIMD kernels may load whole rows
+ * with aligned loads and gather 32 bit words starting at any time slice of a row. The buffer is
+ * only reallocated if an event has more strips than any event before so that it can be reused for
+ * every event of a run.
+ */
+class ChargeMatrix {
+public:
+	static const unsigned int BUFFER_ALIGNMENT = 64; // bytes (one cache line)
+	static const unsigned int ROW_ALIGNMENT = 16; // shorts (one 256 bit register)
+
+	ChargeMatrix() :
+			m_data(NULL), m_capacity(0), m_numberOfStrips(0), m_numberOfTimeSlices(
+					0), m_stride(0) {
+	}
+
+	~ChargeMatrix() {
+		free(m_data);
+	}
+
+	/**
+	 * Copies the charges of all strips of one event into the matrix
+	 */
+	void load(const std::vector<std::vector<short> >& apv_q) {
+		const unsigned int numberOfStrips = apv_q.size();
+		const unsigned int numberOfTimeSlices =
+				numberOfStrips == 0 ? 0 : apv_q[0].size();
+		resize(numberOfStrips, numberOfTimeSlices);
+
+		for (unsigned int strip = 0; strip != numberOfStrips; strip++) {
+			const std::vector<short>& charges = apv_q[strip];
+			short* row = m_data + strip * m_stride;
+
+			unsigned int length = charges.size();
+			if (length > numberOfTimeSlices) {
+				length = numberOfTimeSlices;
+			}
+			if (length != 0) {
+				memcpy(row, &charges[0], length * sizeof(short));
+			}
+			memset(row + length, 0, (m_stride - length) * sizeof(short));
+		}
+	}
+
+	/**
+	 * Sets the size of the matrix. The content of the matrix is undefined afterwards
+	 */
+	void resize(unsigned int numberOfStrips, unsigned int numberOfTimeSlices) {
+		m_numberOfStrips = numberOfStrips;
+		m_numberOfTimeSlices = numberOfTimeSlices;
+		m_stride = (numberOfTimeSlices + ROW_ALIGNMENT) / ROW_ALIGNMENT
+				* ROW_ALIGNMENT;
+
+		const std::size_t requiredSize = (std::size_t) numberOfStrips
+				* m_stride;
+		if (requiredSize > m_capacity) {
+			free(m_data);
+			m_data = NULL;
+			m_capacity = 0;
+
+			void* buffer = NULL;
+			if (posix_memalign(&buffer, BUFFER_ALIGNMENT,
+					requiredSize * sizeof(short)) != 0) {
+				throw std::bad_alloc();
+			}
+			m_data = static_cast<short*>(buffer);
+			m_capacity = requiredSize;
+		}
+	}
+
+	short* row(unsigned int strip) {
+		return m_data + strip * m_stride;
+	}
+
+	ChargeMatrixView getView() const {
+		return ChargeMatrixView(m_data, m_numberOfStrips, m_numberOfTimeSlices,
+				m_stride);
+	}
+
+	unsigned int getNumberOfStrips() const {
+		return m_numberOfStrips;
+	}
+
+	unsigned int getNumberOfTimeSlices() const {
+		return m_numberOfTimeSlices;
+	}
+
+	unsigned int getStride() const {
+		return m_stride;
+	}
+
+private:
+	// The buffer is owned by this object
+	ChargeMatrix(const ChargeMatrix&);
+	ChargeMatrix& operator=(const ChargeMatrix&);
+
+	short* m_data;
+	std::size_t m_capacity;
+	unsigned int m_numberOfStrips;
+	unsigned int m_numberOfTimeSlices;
+	unsigned int m_stride;
+};
+
+#endif /* CHARGEMATRIX_H_ */
@@ -0,0 +1,160 @@
+/*
+ * CutFlow.h
+ */
+
+#ifndef CUTFLOW_H_
+#define CUTFLOW_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum class CutCost {
+	CHEAP, // compares values that are already known
+	EXPENSIVE // computes something for the cut (cross sections, fits)
+};
+
+struct CutStageStatistics {
+	uint64_t passed;
+	uint64_t failed;
+	uint64_t nanoseconds; // spent in the predicate
+
+	CutStageStatistics() :
+			passed(0), failed(0), nanoseconds(0) {
+	}
+};
+
+/**
+ * Pass/fail counts and time spent per stage of a CutFlow, collected by one AnalysisContext. The
+ * statistics of several parts of the same run are combined with add().
+ */
+class CutFlowStatistics {
+public:
+	std::vector<CutStageStatistics> stages;
+
+	void add(const CutFlowStatistics& other) {
+		if (stages.size() < other.stages.size()) {
+			stages.resize(other.stages.size());
+		}
+		for (unsigned int i = 0; i < other.stages.size(); i++) {
+			stages[i].passed += other.stages[i].passed;
+			stages[i].failed += other.stages[i].failed;
+			stages[i].nanoseconds += other.stages[i].nanoseconds;
+		}
+	}
+};
+
+/**
+ * The cuts applied to every event, as a sequence of registered stages. Each stage has a name, a
+ * cost class, a predicate deciding whether the event passes and the bookkeeping (cut statistics and
+ * histograms) done if the event passes or fails. run() evaluates the stages in the order they were
+ * added until one fails.
+ *
+ * The stages are always evaluated in this order: every cut statistic counts the events that passed
+ * all previous cuts, so the first failing stage in this order has to be known for every event.
+ * Evaluating a stage earlier would only add work. The measured selectivity and cost per stage
+ * (see print) show which cuts are worth being moved to the front of the sequence.
+ *
+ * <Event> is the state of the analysed event passed to the stages, which can store results (e.g.
+ * fits) for later stages in it.
+ */
+template<typename Event>
+class CutFlow {
+public:
+	typedef std::function<bool(Event&)> Predicate;
+	typedef std::function<void(Event&)> Action;
+
+	/**
+	 * Appends a stage. <onPass>/<onFail> may be empty.
+	 */
+	void addStage(const std::string& name, CutCost cost, Predicate predicate,
+			Action onPass = Action(), Action onFail = Action()) {
+		Stage stage;
+		stage.name = name;
+		stage.cost = cost;
+		stage.predicate = predicate;
+		stage.onPass = onPass;
+		stage.onFail = onFail;
+		stages.push_back(stage);
+	}
+
+	/**
+	 * Applies all stages to <event> and counts the results in <statistics>. Returns true if the
+	 * event passed all stages.
+	 */
+	bool run(Event& event, CutFlowStatistics& statistics) const {
+		if (statistics.stages.size() < stages.size()) {
+			statistics.stages.resize(stages.size());
+		}
+
+		for (unsigned int i = 0; i < stages.size(); i++) {
+			const Stage& stage = stages[i];
+			CutStageStatistics& stageStatistics = statistics.stages[i];
+
+			auto start = std::chrono::steady_clock::now();
+			const bool passed = stage.predicate(event);
+			stageStatistics.nanoseconds +=
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::now() - start).count();
+
+			if (!passed) {
+				stageStatistics.failed++;
+				if (stage.onFail) {
+					stage.onFail(event);
+				}
+				return false;
+			}
+			stageStatistics.passed++;
+			if (stage.onPass) {
+				stage.onPass(event);
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Prints the events passed/cut, the fraction cut and the time spent per stage. "cut/us" is the
+	 * number of events cut per microsecond spent in the stage, the larger it is the earlier the cut
+	 * should be done.
+	 */
+	void print(const std::string& runName,
+			const CutFlowStatistics& statistics) const {
+		std::stringstream report;
+		report << "Cut flow of run " << runName
+				<< " (name, cost, passed, cut, %cut, ns/event, cut/us):"
+				<< std::endl;
+		for (unsigned int i = 0;
+				i < stages.size() && i < statistics.stages.size(); i++) {
+			const CutStageStatistics& stage = statistics.stages[i];
+			const uint64_t evaluated = stage.passed + stage.failed;
+			report << "  " << stages[i].name << "\t"
+					<< (stages[i].cost == CutCost::CHEAP ? "cheap" : "expensive")
+					<< "\t" << stage.passed << "\t" << stage.failed << "\t"
+					<< (evaluated == 0 ? 0 : 100. * stage.failed / evaluated)
+					<< "%\t"
+					<< (evaluated == 0 ? 0 : (double) stage.nanoseconds / evaluated)
+					<< "\t"
+					<< (stage.nanoseconds == 0 ?
+							0 : 1000. * stage.failed / stage.nanoseconds)
+					<< std::endl;
+		}
+		std::cout << report.str();
+	}
+
+private:
+	struct Stage {
+		std::string name;
+		CutCost cost;
+		Predicate predicate;
+		Action onPass;
+		Action onFail;
+	};
+
+	std::vector<Stage> stages;
+};
+
+#endif /* CUTFLOW_H_ */
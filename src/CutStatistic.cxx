@@ -9,33 +9,67 @@
 
 #include "MMQuickEvent.h"
 
-#define MAX_EVENT_DISPLAYS_PER_CUT 5
-
 std::vector<CutStatistic*> CutStatistic::instances;
+unsigned int CutStatistic::numberOfEventDisplays = 5;
 
-void CutStatistic::Fill(double value, MMQuickEvent* event, std::string suffix) {
-	counterHistogram.Fill(value);
-
-	if (value == 1
-			&& eventDisplaysCut.size() < MAX_EVENT_DISPLAYS_PER_CUT * 2) {
-		TH2F *eventDisplayX, *eventDisplayY;
-
-		std::stringstream eventDisplaySuffix;
-		eventDisplaySuffix << "-" << counterHistogram.GetName() << suffix;
-		event->generateEventDisplay(eventDisplayX, eventDisplayY,
-				eventDisplaySuffix.str());
-		eventDisplaysCut.push_back(eventDisplayX);
-		eventDisplaysCut.push_back(eventDisplayY);
-	} else if (value == 0
-			&& eventDisplaysAccepted.size() < MAX_EVENT_DISPLAYS_PER_CUT * 2) {
-		TH2F *eventDisplayX, *eventDisplayY;
-
-		std::stringstream eventDisplaySuffix;
-		eventDisplaySuffix << "-" << counterHistogram.GetName() << suffix;
-		event->generateEventDisplay(eventDisplayX, eventDisplayY,
-				eventDisplaySuffix.str());
-		eventDisplaysAccepted.push_back(eventDisplayX);
-		eventDisplaysAccepted.push_back(eventDisplayY);
+void CutStatistic::setNumberOfEventDisplays(unsigned int number) {
+	numberOfEventDisplays = number;
+	for (auto& cutStat : instances) {
+		cutStat->eventDisplaysCut.setCapacity(number);
+		cutStat->eventDisplaysAccepted.setCapacity(number);
 	}
 }
 
+void CutStatistic::takeSnapshot(EventDisplaySnapshot& snapshot,
+		MMQuickEvent* event, const char* suffix) {
+	event->takeEventDisplaySnapshot(snapshot,
+			"-" + std::string(counterHistogram.GetName()) + suffix);
+}
+
+void CutStatistic::merge(CutStatistic& other) {
+	counterHistogram.Add(&other.counterHistogram);
+	eventDisplaysCut.merge(other.eventDisplaysCut);
+	eventDisplaysAccepted.merge(other.eventDisplaysAccepted);
+}
+
+void CutStatistic::setEventDisplays(std::vector<EventDisplaySnapshot> cut,
+		std::vector<EventDisplaySnapshot> accepted) {
+	// accepted events are counted in the first bin (value 0), cut events in the second one
+	eventDisplaysAccepted.assign(std::move(accepted),
+			(uint64_t) counterHistogram.GetBinContent(1));
+	eventDisplaysCut.assign(std::move(cut),
+			(uint64_t) counterHistogram.GetBinContent(2));
+}
+
+void EventDisplaySnapshot::createHistograms(TH2F* &eventDisplayX,
+		TH2F* &eventDisplayY) const {
+	std::stringstream histoName;
+	histoName << eventNumber << "-Eventdisplay";
+
+	std::string histoNameX = histoName.str() + "_X" + suffix;
+	std::string histoNameY = histoName.str() + "_Y" + suffix;
+
+	eventDisplayX = new TH2F(histoNameX.c_str(),
+			";strip number; time [25 ns]; charge", xStrips, 0, xStrips - 1,
+			numberOfTimeSlices, 0, numberOfTimeSlices - 1);
+
+	eventDisplayY = new TH2F(histoNameY.c_str(),
+			";strip number; time [25 ns]; charge", yStrips, 0, yStrips - 1,
+			numberOfTimeSlices, 0, numberOfTimeSlices - 1);
+
+	// store the charges in the bins corresponding to the absolute strip numbers
+	for (unsigned int i = 0; i != stripsX.size(); i++) {
+		for (unsigned int timeSlice = 0; timeSlice != numberOfTimeSlices;
+				timeSlice++) {
+			eventDisplayX->SetBinContent(stripsX[i] + 1/*x*/, timeSlice + 1/*y*/,
+					chargesX[i * numberOfTimeSlices + timeSlice]/*z*/);
+		}
+	}
+	for (unsigned int i = 0; i != stripsY.size(); i++) {
+		for (unsigned int timeSlice = 0; timeSlice != numberOfTimeSlices;
+				timeSlice++) {
+			eventDisplayY->SetBinContent(stripsY[i] + 1/*x*/, timeSlice + 1/*y*/,
+					chargesY[i * numberOfTimeSlices + timeSlice]/*z*/);
+		}
+	}
+}
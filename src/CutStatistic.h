@@ -11,31 +11,115 @@
 #include <TH1.h>
 #include <TH2.h>
 #include <TNamed.h>
+#include <functional>
+#include <string>
 #include <vector>
 
+#include "EventDisplaySnapshot.h"
+#include "ReservoirSample.h"
+
 class MMQuickEvent;
 
 class CutStatistic {
 public:
 	static std::vector<CutStatistic*> instances;
 	TH1F counterHistogram;
-	std::vector<TH2F*> eventDisplaysCut;
-	std::vector<TH2F*> eventDisplaysAccepted;
+
+
+	/*
+	 * Number of cut and of accepted events of which event displays are stored (set via
+	 * setNumberOfEventDisplays)
+	 */
+	static unsigned int numberOfEventDisplays;
+
+	/*
+	 * Random samples of the cut/accepted events. The TH2F event displays are only created from the
+	 * snapshots when they are written.
+	 */
+	ReservoirSample<EventDisplaySnapshot> eventDisplaysCut;
+	ReservoirSample<EventDisplaySnapshot> eventDisplaysAccepted;
 
 	CutStatistic(std::string name):counterHistogram(name.c_str(), ";accepted/cut ;entries", 2,
-			-0.5, 1.5) {
+			-0.5, 1.5), eventDisplaysCut(numberOfEventDisplays, getSeed(name)), eventDisplaysAccepted(
+			numberOfEventDisplays, getSeed(name) + 1) {
 		instances.push_back(this);
 	}
 
-	void Fill(double value, MMQuickEvent* event, std::string suffix="");
+	/**
+	 * Registers the new instance in <registry> instead of instances (used for the per-run
+	 * statistics of an AnalysisContext)
+	 */
+	CutStatistic(std::string name, std::vector<CutStatistic*>& registry) :
+			counterHistogram(name.c_str(), ";accepted/cut ;entries", 2, -0.5,
+					1.5), eventDisplaysCut(numberOfEventDisplays, getSeed(name)), eventDisplaysAccepted(
+					numberOfEventDisplays, getSeed(name) + 1) {
+		registry.push_back(this);
+	}
+
+	/**
+	 * Sets the number of stored event displays of all instances and of the ones created later.
+	 * Clears the stored displays.
+	 */
+	static void setNumberOfEventDisplays(unsigned int number);
+
+	/**
+	 * Seeds the event display samples for the part <part> of the run <runName> (see
+	 * getSampleSeed). Must be called before any event is filled.
+	 */
+	void seedEventDisplays(const std::string& runName, unsigned int part) {
+		eventDisplaysCut.seed(getSampleSeed(getName(), runName, part));
+		eventDisplaysAccepted.seed(getSampleSeed(getName(), runName, part) + 1);
+	}
+
+	/**
+	 * Counts the event as cut (value 1) or accepted (value 0) and stores an event display of it if
+	 * the reservoir samples it. Nothing but the counters is touched for all other events.
+	 */
+	void Fill(double value, MMQuickEvent* event, const char* suffix = "") {
+		counterHistogram.Fill(value);
+
+		EventDisplaySnapshot* snapshot = NULL;
+		if (value == 1) {
+			snapshot = eventDisplaysCut.offer();
+		} else if (value == 0) {
+			snapshot = eventDisplaysAccepted.offer();
+		}
+		if (snapshot != NULL) {
+			takeSnapshot(*snapshot, event, suffix);
+		}
+	}
 
 	const char* getName() {
 		return counterHistogram.GetName();
 	}
 
+	/**
+	 * Adds the counters of <other> and merges its event displays into the samples of this instance
+	 * as if all events had been filled into this one. The event displays of <other> are cleared.
+	 */
+	void merge(CutStatistic& other);
+
+	/**
+	 * Sets the event displays to the ones written of an instance with the same counters (see
+	 * AnalysisContext::readPartial). The number of events they were sampled from is taken from
+	 * counterHistogram.
+	 */
+	void setEventDisplays(std::vector<EventDisplaySnapshot> cut,
+			std::vector<EventDisplaySnapshot> accepted);
+
 	void reset(){
 		counterHistogram.Reset();
+		eventDisplaysCut.clear();
+		eventDisplaysAccepted.clear();
+	}
+
+private:
+	static unsigned int getSeed(const std::string& name) {
+		return getSampleSeed(name);
 	}
+
+	void takeSnapshot(EventDisplaySnapshot& snapshot, MMQuickEvent* event,
+			const char* suffix);
 };
 
 #endif /* CUTSTATISTIC_H_ */
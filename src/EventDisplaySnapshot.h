@@ -0,0 +1,45 @@
+/*
+ * EventDisplaySnapshot.h
+ */
+
+#ifndef EVENTDISPLAYSNAPSHOT_H_
+#define EVENTDISPLAYSNAPSHOT_H_
+
+#include <string>
+#include <vector>
+
+class TH2F;
+
+/**
+ * Charges of one event as needed for its event display: only the strips that fired with the raw
+ * charges of all their time slices. Taking a snapshot is a plain copy, the TH2F event displays are
+ * only created by createHistograms when they are written.
+ */
+struct EventDisplaySnapshot {
+	int eventNumber;
+
+	/*
+	 * Appended to the names of the event displays ("-<cut name>" for the cut statistics)
+	 */
+	std::string suffix;
+
+	unsigned int numberOfTimeSlices;
+
+	/*
+	 * Absolute strip numbers of the X and Y strips that fired. chargesX/Y contain
+	 * numberOfTimeSlices charges per strip in the same order.
+	 */
+	std::vector<unsigned int> stripsX;
+	std::vector<short> chargesX;
+	std::vector<unsigned int> stripsY;
+	std::vector<short> chargesY;
+
+	/**
+	 * Creates the heatmaps of the X and Y strips (x=strip, y=time slice, z=charge), named
+	 * "<eventNumber>-Eventdisplay_X<suffix>" and "<eventNumber>-Eventdisplay_Y<suffix>". The caller
+	 * owns the histograms.
+	 */
+	void createHistograms(TH2F* &eventDisplayX, TH2F* &eventDisplayY) const;
+};
+
+#endif /* EVENTDISPLAYSNAPSHOT_H_ */
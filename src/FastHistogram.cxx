@@ -0,0 +1,137 @@
+/*
+ * FastHistogram.cxx
+ */
+
+#include "FastHistogram.h"
+
+#include <TH1F.h>
+#include <TH2F.h>
+
+/*
+ * Title including the axis titles, as passed to the constructor of a histogram ("title;x;y")
+ */
+static std::string getFullTitle(const TH1& histogram, bool withZTitle) {
+	std::string title = std::string(histogram.GetTitle()) + ";"
+			+ histogram.GetXaxis()->GetTitle() + ";"
+			+ histogram.GetYaxis()->GetTitle();
+	if (withZTitle) {
+		title += std::string(";") + histogram.GetZaxis()->GetTitle();
+	}
+	return title;
+}
+
+FastHistogram1D::FastHistogram1D(std::string _name, std::string _title,
+		int numberOfBins, double low, double high) :
+		name(_name), title(_title), axis(numberOfBins, low, high), contents(
+				numberOfBins + 2), entries(0), sumOfWeights(0), sumOfWeights2(
+				0), sumOfWeightsX(0), sumOfWeightsX2(0) {
+}
+
+FastHistogram1D::FastHistogram1D(const TH1F& prototype) :
+		FastHistogram1D(prototype.GetName(), getFullTitle(prototype, false),
+				prototype.GetXaxis()->GetNbins(),
+				prototype.GetXaxis()->GetXmin(),
+				prototype.GetXaxis()->GetXmax()) {
+}
+
+void FastHistogram1D::add(const FastHistogram1D& other) {
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		contents[bin] += other.contents[bin];
+	}
+	entries += other.entries;
+	sumOfWeights += other.sumOfWeights;
+	sumOfWeights2 += other.sumOfWeights2;
+	sumOfWeightsX += other.sumOfWeightsX;
+	sumOfWeightsX2 += other.sumOfWeightsX2;
+}
+
+void FastHistogram1D::add(const TH1F& histogram) {
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		contents[bin] += histogram.GetBinContent(bin);
+	}
+	double stats[4];
+	histogram.GetStats(stats);
+	entries += histogram.GetEntries();
+	sumOfWeights += stats[0];
+	sumOfWeights2 += stats[1];
+	sumOfWeightsX += stats[2];
+	sumOfWeightsX2 += stats[3];
+}
+
+TH1F* FastHistogram1D::createRootHistogram() const {
+	TH1F* histogram = new TH1F(name.c_str(), title.c_str(), axis.numberOfBins,
+			axis.low, axis.high);
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		histogram->SetBinContent(bin, contents[bin]);
+	}
+	// SetBinContent resets the statistics, so they have to be set afterwards
+	double stats[4] = { sumOfWeights, sumOfWeights2, sumOfWeightsX,
+			sumOfWeightsX2 };
+	histogram->PutStats(stats);
+	histogram->SetEntries(entries);
+	return histogram;
+}
+
+FastHistogram2D::FastHistogram2D(std::string _name, std::string _title,
+		int numberOfBinsX, double lowX, double highX, int numberOfBinsY,
+		double lowY, double highY) :
+		name(_name), title(_title), xAxis(numberOfBinsX, lowX, highX), yAxis(
+				numberOfBinsY, lowY, highY), contents(
+				(numberOfBinsX + 2) * (numberOfBinsY + 2)), entries(0), sumOfWeights(
+				0), sumOfWeights2(0), sumOfWeightsX(0), sumOfWeightsX2(0), sumOfWeightsY(
+				0), sumOfWeightsY2(0), sumOfWeightsXY(0) {
+}
+
+FastHistogram2D::FastHistogram2D(const TH2F& prototype) :
+		FastHistogram2D(prototype.GetName(), getFullTitle(prototype, true),
+				prototype.GetXaxis()->GetNbins(),
+				prototype.GetXaxis()->GetXmin(),
+				prototype.GetXaxis()->GetXmax(),
+				prototype.GetYaxis()->GetNbins(),
+				prototype.GetYaxis()->GetXmin(),
+				prototype.GetYaxis()->GetXmax()) {
+}
+
+void FastHistogram2D::add(const FastHistogram2D& other) {
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		contents[bin] += other.contents[bin];
+	}
+	entries += other.entries;
+	sumOfWeights += other.sumOfWeights;
+	sumOfWeights2 += other.sumOfWeights2;
+	sumOfWeightsX += other.sumOfWeightsX;
+	sumOfWeightsX2 += other.sumOfWeightsX2;
+	sumOfWeightsY += other.sumOfWeightsY;
+	sumOfWeightsY2 += other.sumOfWeightsY2;
+	sumOfWeightsXY += other.sumOfWeightsXY;
+}
+
+void FastHistogram2D::add(const TH2F& histogram) {
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		contents[bin] += histogram.GetBinContent(bin);
+	}
+	double stats[7];
+	histogram.GetStats(stats);
+	entries += histogram.GetEntries();
+	sumOfWeights += stats[0];
+	sumOfWeights2 += stats[1];
+	sumOfWeightsX += stats[2];
+	sumOfWeightsX2 += stats[3];
+	sumOfWeightsY += stats[4];
+	sumOfWeightsY2 += stats[5];
+	sumOfWeightsXY += stats[6];
+}
+
+TH2F* FastHistogram2D::createRootHistogram() const {
+	TH2F* histogram = new TH2F(name.c_str(), title.c_str(),
+			xAxis.numberOfBins, xAxis.low, xAxis.high, yAxis.numberOfBins,
+			yAxis.low, yAxis.high);
+	for (unsigned int bin = 0; bin < contents.size(); bin++) {
+		histogram->SetBinContent(bin, contents[bin]);
+	}
+	double stats[7] = { sumOfWeights, sumOfWeights2, sumOfWeightsX,
+			sumOfWeightsX2, sumOfWeightsY, sumOfWeightsY2, sumOfWeightsXY };
+	histogram->PutStats(stats);
+	histogram->SetEntries(entries);
+	return histogram;
+}
@@ -0,0 +1,169 @@
+/*
+ * FastHistogram.h
+ */
+
+#ifndef FASTHISTOGRAM_H_
+#define FASTHISTOGRAM_H_
+
+#include <string>
+#include <vector>
+
+class TH1F;
+class TH2F;
+
+/**
+ * Fixed binning of one axis, calculating bins exactly like TAxis::FindBin does for equidistant
+ * bins: 0 is the underflow and numberOfBins+1 the overflow bin.
+ */
+struct FastAxis {
+	int numberOfBins;
+	double low;
+	double high;
+
+	FastAxis(int _numberOfBins, double _low, double _high) :
+			numberOfBins(_numberOfBins), low(_low), high(_high) {
+	}
+
+	int findBin(double x) const {
+		if (x < low) {
+			return 0;
+		}
+		if (!(x < high)) {
+			return numberOfBins + 1;
+		}
+		return 1 + int(numberOfBins * (x - low) / (high - low));
+	}
+
+	bool isOverflowOrUnderflow(int bin) const {
+		return bin == 0 || bin > numberOfBins;
+	}
+};
+
+/**
+ * Histogram filled in the event loop instead of a TH1F. Filling is a non-virtual bin calculation
+ * and two additions, there is no locking, no directory and no automatic rebinning. Every
+ * AnalysisContext has its own instances, so threads never fill the same histogram; the parts of a
+ * run are merged with add().
+ *
+ * Bin contents and statistics (entries, sum of weights, mean, RMS) are the same as the ones of a
+ * TH1F filled with the same values. The TH1F is only created when the histogram is written
+ * (createRootHistogram).
+ */
+class FastHistogram1D {
+public:
+	FastHistogram1D(std::string name, std::string title, int numberOfBins,
+			double low, double high);
+
+	/**
+	 * Empty histogram with the name, titles and binning of <prototype>
+	 */
+	explicit FastHistogram1D(const TH1F& prototype);
+
+	void Fill(double x) {
+		const int bin = axis.findBin(x);
+		contents[bin]++;
+		entries++;
+		if (axis.isOverflowOrUnderflow(bin)) {
+			return;
+		}
+		sumOfWeights++;
+		sumOfWeights2++;
+		sumOfWeightsX += x;
+		sumOfWeightsX2 += x * x;
+	}
+
+	void add(const FastHistogram1D& other);
+
+	/**
+	 * Adds the contents and statistics of <histogram> which must have the same binning
+	 */
+	void add(const TH1F& histogram);
+
+	/**
+	 * Returns a new TH1F with the contents of this histogram, owned by the caller
+	 */
+	TH1F* createRootHistogram() const;
+
+	FastHistogram1D* createEmptyCopy() const {
+		return new FastHistogram1D(name, title, axis.numberOfBins, axis.low,
+				axis.high);
+	}
+
+	const std::string& getName() const {
+		return name;
+	}
+
+private:
+	std::string name;
+	std::string title;
+	FastAxis axis;
+	std::vector<double> contents; // including underflow and overflow bin
+	double entries;
+	double sumOfWeights;
+	double sumOfWeights2;
+	double sumOfWeightsX;
+	double sumOfWeightsX2;
+};
+
+/**
+ * Two dimensional version of FastHistogram1D, equivalent to a TH2F. The bins are stored in the
+ * same order as in ROOT (bin = binY * (numberOfBinsX + 2) + binX).
+ */
+class FastHistogram2D {
+public:
+	FastHistogram2D(std::string name, std::string title, int numberOfBinsX,
+			double lowX, double highX, int numberOfBinsY, double lowY,
+			double highY);
+
+	explicit FastHistogram2D(const TH2F& prototype);
+
+	void Fill(double x, double y) {
+		const int binX = xAxis.findBin(x);
+		const int binY = yAxis.findBin(y);
+		contents[binY * (xAxis.numberOfBins + 2) + binX]++;
+		entries++;
+		if (xAxis.isOverflowOrUnderflow(binX)
+				|| yAxis.isOverflowOrUnderflow(binY)) {
+			return;
+		}
+		sumOfWeights++;
+		sumOfWeights2++;
+		sumOfWeightsX += x;
+		sumOfWeightsX2 += x * x;
+		sumOfWeightsY += y;
+		sumOfWeightsY2 += y * y;
+		sumOfWeightsXY += x * y;
+	}
+
+	void add(const FastHistogram2D& other);
+
+	void add(const TH2F& histogram);
+
+	TH2F* createRootHistogram() const;
+
+	FastHistogram2D* createEmptyCopy() const {
+		return new FastHistogram2D(name, title, xAxis.numberOfBins, xAxis.low,
+				xAxis.high, yAxis.numberOfBins, yAxis.low, yAxis.high);
+	}
+
+	const std::string& getName() const {
+		return name;
+	}
+
+private:
+	std::string name;
+	std::string title;
+	FastAxis xAxis;
+	FastAxis yAxis;
+	std::vector<double> contents;
+	double entries;
+	double sumOfWeights;
+	double sumOfWeights2;
+	double sumOfWeightsX;
+	double sumOfWeightsX2;
+	double sumOfWeightsY;
+	double sumOfWeightsY2;
+	double sumOfWeightsXY;
+};
+
+#endif /* FASTHISTOGRAM_H_ */
@@ -6,6 +6,7 @@
  */
 
 #include "Helper.h"
+#include "HitEstimator.h"
 
 #include <TAttMarker.h>
 #include <TAxis.h>
@@ -16,14 +17,22 @@
 #include <TH2.h>
 #include <TH1F.h>
 #include <TH2F.h>
+#include <TList.h>
 #include <TNamed.h>
 #include <iostream>
 
 using namespace std;
 
+std::mutex& getFitMutex() {
+	static std::mutex fitMutex;
+	return fitMutex;
+}
+
 void writeTH2FToPdf(TH2F* object, std::string subfolder,
 		std::string drawOptions) {
-	gStyle->SetOptStat(0);
+	MM_TIME_STAGE(PDF_OUTPUT);
+	std::stringstream pdfName;
+	pdfName << outPath << subfolder << "/" << object->GetName() << ".pdf";
 
 	if (strcmp(object->GetName(), "hitWidthYByVAED") == 0) {
 		object->SetMinimum(1.4);
@@ -32,22 +41,21 @@ void writeTH2FToPdf(TH2F* object, std::string subfolder,
 	if (strcmp(object->GetName(), "hitWidthXByVAED") == 0) {
 		object->SetMinimum(0.8);
 	}
-
-	std::stringstream pdfName;
-	pdfName << outPath << subfolder << "/";
-
-	std::stringstream mkdir;
-	mkdir << "mkdir -p " << pdfName.str();
-	system(mkdir.str().c_str());
-
-	pdfName << object->GetName() << ".pdf";
-
-	TCanvas canvas("c", "data", 200, 10, 700, 500);
-	canvas.SetRightMargin(0.15);
 	object->GetZaxis()->SetTitleOffset(1.2);
-	object->Draw(drawOptions.c_str());
-	canvas.Print(pdfName.str().c_str(), "pdf");
-	gStyle->SetOptStat(1);
+	if (!PdfRenderQueue::getInstance().isEnabled()) {
+		return;
+	}
+
+	TH2F* copy = (TH2F*) object->Clone();
+	PdfRenderQueue::getInstance().render(pdfName.str(), copy,
+			[=](TCanvas& canvas) {
+				gStyle->SetOptStat(0);
+				canvas.SetRightMargin(0.15);
+				copy->Draw(drawOptions.c_str());
+			});
+	PdfRenderQueue::getInstance().run([]() {
+		gStyle->SetOptStat(1);
+	});
 }
 
 TGraph* generateGraph(std::string name, std::string xTitle,
@@ -107,6 +115,7 @@ TGraph* generateGraph(std::string name, std::string xTitle,
 	f1.SetParLimits(1, 0.8 * a, 1.3 * a);
 
 	f1.SetLineColor(fitLineColor);
+	std::lock_guard<std::mutex> lock(getFitMutex());
 	graph->Fit(&f1, "Rq");
 	return graph;
 }
@@ -127,8 +136,6 @@ void plotHitWidthGraph(std::string name, std::string xTitle,
 		double parameterValue, double driftGap, double fitRangeStart,
 		double fitRangeEnd) {
 
-	gStyle->SetStatW(0.2);
-
 	std::vector<double> xValuesFiltered;
 	std::vector<double> yValuesFiltered;
 	std::vector<double> yValueErrorsFiltered;
@@ -147,41 +154,18 @@ void plotHitWidthGraph(std::string name, std::string xTitle,
 			false);
 }
 
-TF1* fitHitWidhtHistogram(TH1F* mmhitWidthHisto, TH1F* combinedWidthHisto,
-		std::vector<double>& VDsForGraphs, std::vector<double>& VAsForGraphs,
-		std::vector<double>& hitWidthForGraphs,
-		std::vector<double>& hitWidthForGraphsError, int VD, int VA) {
-
-	// fit histrogram maxChargeCrossSection with Gaussian distribution
-	mmhitWidthHisto->Fit("gaus", "Sq");
-	TF1* widthHistFitResult = mmhitWidthHisto->GetFunction("gaus");
-	if (widthHistFitResult) {
-		combinedWidthHisto->Fill(widthHistFitResult->GetParameter(1));
-		// Plot hit width vs VD
-		VDsForGraphs.push_back(VD);
-		VAsForGraphs.push_back(VA);
-		hitWidthForGraphs.push_back(widthHistFitResult->GetParameter(1));
-		hitWidthForGraphsError.push_back(widthHistFitResult->GetParError(1));
-	}
-
-	return widthHistFitResult;
-}
-
-TF1* fitGauss(vector<std::pair<int, short> > stripAndChargeAtMaxChargeTimes,
-		int eventNumber, std::string name, TH1F* &maxChargeCrossSection,
-		unsigned int startFitRange, unsigned int endFitRange) {
+TH1F* generateCrossSectionHistogram(
+		const vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, std::string name, unsigned int startFitRange,
+		unsigned int endFitRange) {
 	// Generate the title of the histogram
 	stringstream histoName;
 	histoName.str("");
 	histoName << eventNumber << name;
 
-	// check if any hit has been passed
-	if (stripAndChargeAtMaxChargeTimes.empty()) {
-		return NULL;
-	}
-
-	maxChargeCrossSection = new TH1F(histoName.str().c_str(), "; strip; charge",
-			endFitRange - startFitRange + 2, startFitRange, endFitRange);
+	TH1F* maxChargeCrossSection = new TH1F(histoName.str().c_str(),
+			"; strip; charge", endFitRange - startFitRange + 2, startFitRange,
+			endFitRange);
 
 // Fill the histogram
 	for (unsigned int strip = 0; strip != stripAndChargeAtMaxChargeTimes.size();
@@ -194,6 +178,41 @@ TF1* fitGauss(vector<std::pair<int, short> > stripAndChargeAtMaxChargeTimes,
 					stripAndChargeAtMaxChargeTimes[strip].second);
 		}
 	}
+	return maxChargeCrossSection;
+}
+
+TH1F* generateCrossSectionHistogram(
+		const vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, std::string name, unsigned int startFitRange,
+		unsigned int endFitRange, const HitFitResult& fitResult) {
+	TH1F* maxChargeCrossSection = generateCrossSectionHistogram(
+			stripAndChargeAtMaxChargeTimes, eventNumber, name, startFitRange,
+			endFitRange);
+
+	// Attach the estimated Gaussian as if it had been fitted
+	TF1* gaussian = new TF1("gaus", "gaus", startFitRange, endFitRange);
+	gaussian->SetParameter(0, fitResult.amplitude);
+	gaussian->SetParameter(1, fitResult.mean);
+	gaussian->SetParError(1, fitResult.meanError);
+	gaussian->SetParameter(2, fitResult.sigma);
+	gaussian->SetChisquare(fitResult.chi2);
+	gaussian->SetNDF(fitResult.ndf);
+	maxChargeCrossSection->GetListOfFunctions()->Add(gaussian);
+	return maxChargeCrossSection;
+}
+
+TF1* fitGauss(
+		const vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, std::string name, TH1F* &maxChargeCrossSection,
+		unsigned int startFitRange, unsigned int endFitRange) {
+	// check if any hit has been passed
+	if (stripAndChargeAtMaxChargeTimes.empty()) {
+		return NULL;
+	}
+
+	maxChargeCrossSection = generateCrossSectionHistogram(
+			stripAndChargeAtMaxChargeTimes, eventNumber, name, startFitRange,
+			endFitRange);
 
 // fit histrogram maxChargeDistribution with Gaussian distribution
 	maxChargeCrossSection->Fit("gaus", "Sq", NULL, startFitRange, endFitRange);
@@ -18,6 +18,10 @@
 #include <TLegend.h>
 #include <map>
 #include <cmath>
+#include <mutex>
+
+#include "PdfRenderQueue.h"
+#include "StageTimer.h"
 
 class TF1;
 class TH1;
@@ -25,56 +29,66 @@ class TMultiGraph;
 
 class TH2F;
 
+struct HitFitResult;
+
 //set output path and name of output files
 const std::string inPath = "/localscratch/praktikum/data/";	//Path of the Input
 const std::string outPath = "/localscratch/praktikum/output/"; // Path of the Output
 //const string outPath = "/tmp/output/"; // Path of the Output
 const std::string appendName = "";				// Name of single measurements
+const std::string runListFile = "../src/runs.txt"; // List of all runs (see RunCatalogue), relative to the working directory
 const std::string combinedPlotsFile = "combined.root";// Name of the file for the combined results of all runs (hier muss jeder Tag einzeln analysiert werden! Da Zeile 79-84(driftStart...ampSteps) für jeden Tag anders war.
 
+/**
+ * Writes <object> to <outPath><subfolder>/<namePrefix><name>.pdf. The object is copied and the PDF
+ * is rendered by the PdfRenderQueue, so <object> may be changed or deleted right afterwards. Only
+ * the axis title offset is set on <object> itself, as it used to be.
+ */
 template<typename T>
 void writeToPdf(T* object, std::string subfolder, std::string drawOptions,
 		std::string namePrefix = "", int optFit = 1111,
 		bool buildLegend = false) {
-	gStyle->SetOptFit(optFit);
-
-	std::string histoName(object->GetName());
-	gStyle->SetStatW(0.2);
-	gStyle->SetStatY(0.9);
-	gStyle->SetStatX(0.47);
-
-	if (dynamic_cast<TH1*>(object)) {
-		gStyle->SetStatY(0.9);
-		gStyle->SetStatX(0.9);
-	}
-	if (histoName == "timeDistribution") {
-		gStyle->SetStatY(0.5);
-		gStyle->SetStatX(0.6);
-	}
+	MM_TIME_STAGE(PDF_OUTPUT);
 	std::stringstream pdfName;
-	pdfName << outPath << subfolder << "/";
-
-	std::stringstream mkdir;
-	mkdir << "mkdir -p " << pdfName.str();
-	system(mkdir.str().c_str());
+	pdfName << outPath << subfolder << "/" << namePrefix << object->GetName()
+			<< ".pdf";
 
-	pdfName << namePrefix << object->GetName() << ".pdf";
-
-	TCanvas canvas("c", "data", 200, 10, 700, 500);
-	canvas.SetLeftMargin(0.11);
 	if (!dynamic_cast<TMultiGraph*>(object)) {
 		object->GetYaxis()->SetTitleOffset(1.5);
 	}
-	object->Draw(drawOptions.c_str());
-	if (buildLegend) {
-		TLegend *leg = canvas.BuildLegend();
-		leg->SetFillStyle(0);
-		leg->SetX1(0.15);
-		leg->SetY1(0.7);
-		leg->SetX2(0.48);
-		leg->SetY2(0.9);
+	if (!PdfRenderQueue::getInstance().isEnabled()) {
+		return;
 	}
-	canvas.Print(pdfName.str().c_str(), "pdf");
+	T* copy = (T*) object->Clone();
+	PdfRenderQueue::getInstance().render(pdfName.str(), copy,
+			[=](TCanvas& canvas) {
+				gStyle->SetOptFit(optFit);
+
+				std::string histoName(copy->GetName());
+				gStyle->SetStatW(0.2);
+				gStyle->SetStatY(0.9);
+				gStyle->SetStatX(0.47);
+
+				if (dynamic_cast<TH1*>(copy)) {
+					gStyle->SetStatY(0.9);
+					gStyle->SetStatX(0.9);
+				}
+				if (histoName == "timeDistribution") {
+					gStyle->SetStatY(0.5);
+					gStyle->SetStatX(0.6);
+				}
+
+				canvas.SetLeftMargin(0.11);
+				copy->Draw(drawOptions.c_str());
+				if (buildLegend) {
+					TLegend *leg = canvas.BuildLegend();
+					leg->SetFillStyle(0);
+					leg->SetX1(0.15);
+					leg->SetY1(0.7);
+					leg->SetX2(0.48);
+					leg->SetY2(0.9);
+				}
+			});
 }
 void writeTH2FToPdf(TH2F* object, std::string subfolder,
 		std::string drawOptions);
@@ -100,13 +114,34 @@ void plotGraph(std::string name, std::string xTitle,
 		std::vector<double> yErrors, std::string subdir, double fitRangeStart,
 		double fitRangeEnd, bool fitQuadratic);
 
-TF1* fitHitWidhtHistogram(TH1F* mmhitWidthHisto, TH1F* combinedWidthHisto,
-		std::vector<double>& VDsForGraphs, std::vector<double>& VAsForGraphs,
-		std::vector<double>& hitWidthForGraphs,
-		std::vector<double>& hitWidthForGraphsError, int VD, int VA);
+/*
+ * Histogram of the charges of all strips in [startFitRange, endFitRange] of the cross section
+ */
+TH1F* generateCrossSectionHistogram(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, std::string name, unsigned int startFitRange,
+		unsigned int endFitRange);
 
+/*
+ * Same as above with the Gaussian of a HitEstimator attached as fit function (for plotting)
+ */
+TH1F* generateCrossSectionHistogram(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, std::string name, unsigned int startFitRange,
+		unsigned int endFitRange, const HitFitResult& fitResult);
+
+/*
+ * TMinuit and the TF1 fits work on the global gMinuit instance, so only one fit may run at a time.
+ * Every Fit call has to hold this mutex if runs are processed concurrently.
+ */
+std::mutex& getFitMutex();
+
+/*
+ * Minuit fit of the cross section (reference for the HitEstimators, see HitEstimator.h). The caller
+ * has to hold getFitMutex().
+ */
 TF1* fitGauss(
-		std::vector<std::pair<int, short> > stripAndChargeAtMaxChargeTimes,
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
 		int eventNumber, std::string name, TH1F* &maxChargeCrossSection,
 		unsigned int startFitRange, unsigned int endFitRange);
 
@@ -0,0 +1,149 @@
+/*
+ * HistogramRegistry.h
+ */
+
+#ifndef HISTOGRAMREGISTRY_H_
+#define HISTOGRAMREGISTRY_H_
+
+#include <TH1.h>
+#include <TH2.h>
+
+/*
+ * Histograms filled while processing the events. The histogram with the key <name> is called
+ * "<name>" in all output files. The lists are sorted alphabetically so that the histograms are
+ * written in the same order as with the string keyed maps used before.
+ *
+ * To add a histogram, add its name to the list and book it in bookRunHistograms or
+ * bookCombinedHistograms (MMPlots.cxx).
+ */
+#define RUN_HISTOGRAMS_1D(H) \
+	H(mmchargex) H(mmchargexUncut) H(mmchargey) H(mmchargeyUncut) H(mmdtime) \
+	H(mmhitWidthX) H(mmhitWidthY) H(mmhitx) H(mmhity) H(mmtimex) H(mmtimey)
+
+#define RUN_HISTOGRAMS_2D(H) \
+	H(mmhitmap)
+
+#define COMBINED_HISTOGRAMS_1D(H) \
+	H(chargexAllEvents) H(chargexAllEventsAfterCoincidenceCut) \
+	H(chargexAllEventsAfterTimingCut) H(chargexAllEventsUncut) \
+	H(chargeyAllEvents) H(chargeyAllEventsAfterCoincidenceCut) \
+	H(chargeyAllEventsAfterTimingCut) H(chargeyAllEventsUncut) \
+	H(hitWidthX) H(hitWidthY) H(timeCoincidence) H(timeDistributionUncutX) \
+	H(timeDistributionUncutY) H(timeDistributionX) \
+	H(timeDistributionXAfterTimeCut) H(timeDistributionY) \
+	H(timeDistributionYAfterTimeCut) H(timeDistributionYAfterTimeXCut)
+
+#define COMBINED_HISTOGRAMS_2D(H) \
+	H(chargeX) H(chargeXfieldStrength) H(chargeXuncut) H(chargeY) \
+	H(chargeYfieldStrength) H(chargeYuncut) H(mmhitneighboursX) \
+	H(mmhitneighboursY) H(rate) H(timeShapeX) H(timeShapeXUncut) H(timeShapeY) \
+	H(timeShapeYUncut)
+
+template<typename Key>
+struct HistogramNames;
+
+#define HISTOGRAM_KEY(name) name,
+#define HISTOGRAM_NAME(name) #name,
+
+/*
+ * Defines the enum <Key> with one value per element of <LIST> and the names belonging to it
+ */
+#define DEFINE_HISTOGRAM_KEYS(Key, LIST) \
+	enum class Key { \
+		LIST(HISTOGRAM_KEY) NUMBER_OF_HISTOGRAMS \
+	}; \
+	template<> \
+	struct HistogramNames<Key> { \
+		static const char* get(Key key) { \
+			static const char* names[] = { LIST(HISTOGRAM_NAME) }; \
+			return names[(unsigned int) key]; \
+		} \
+	};
+
+DEFINE_HISTOGRAM_KEYS(RunHist1D, RUN_HISTOGRAMS_1D)
+DEFINE_HISTOGRAM_KEYS(RunHist2D, RUN_HISTOGRAMS_2D)
+DEFINE_HISTOGRAM_KEYS(CombinedHist1D, COMBINED_HISTOGRAMS_1D)
+DEFINE_HISTOGRAM_KEYS(CombinedHist2D, COMBINED_HISTOGRAMS_2D)
+
+#undef DEFINE_HISTOGRAM_KEYS
+#undef HISTOGRAM_NAME
+#undef HISTOGRAM_KEY
+
+/**
+ * Fixed set of histograms addressed by an enum value (see RunHist1D...) instead of a string. A
+ * lookup is a plain array access and a misspelled key does not compile instead of silently
+ * creating an empty entry.
+ *
+ * Iterating over a registry gives the histogram pointers in the order of the keys. Slots that were
+ * not booked are NULL.
+ */
+template<typename Key, typename Histogram>
+class HistogramRegistry {
+public:
+	static const unsigned int size = (unsigned int) Key::NUMBER_OF_HISTOGRAMS;
+
+	HistogramRegistry() {
+		for (unsigned int i = 0; i < size; i++) {
+			histograms[i] = NULL;
+		}
+	}
+
+	Histogram*& operator[](Key key) {
+		return histograms[(unsigned int) key];
+	}
+
+	Histogram* operator[](Key key) const {
+		return histograms[(unsigned int) key];
+	}
+
+	/**
+	 * Access by the position of the key, for loops over two registries at once
+	 */
+	Histogram*& at(unsigned int index) {
+		return histograms[index];
+	}
+
+	Histogram* at(unsigned int index) const {
+		return histograms[index];
+	}
+
+	static const char* getName(unsigned int index) {
+		return HistogramNames<Key>::get((Key) index);
+	}
+
+	Histogram** begin() {
+		return histograms;
+	}
+
+	Histogram** end() {
+		return histograms + size;
+	}
+
+	Histogram* const * begin() const {
+		return histograms;
+	}
+
+	Histogram* const * end() const {
+		return histograms + size;
+	}
+
+	/**
+	 * Deletes all histograms and sets their slots to NULL
+	 */
+	void deleteAll() {
+		for (unsigned int i = 0; i < size; i++) {
+			delete histograms[i];
+			histograms[i] = NULL;
+		}
+	}
+
+private:
+	Histogram* histograms[size];
+};
+
+typedef HistogramRegistry<RunHist1D, TH1F> RunHistograms1D;
+typedef HistogramRegistry<RunHist2D, TH2F> RunHistograms2D;
+typedef HistogramRegistry<CombinedHist1D, TH1F> CombinedHistograms1D;
+typedef HistogramRegistry<CombinedHist2D, TH2F> CombinedHistograms2D;
+
+#endif /* HISTOGRAMREGISTRY_H_ */
@@ -0,0 +1,351 @@
+/*
+ * HitEstimator.cxx
+ */
+
+#include "HitEstimator.h"
+
+#include <TF1.h>
+#include <TH1F.h>
+#include <cmath>
+#include <mutex>
+
+#include "Helper.h"
+
+/*
+ * Maximum number of strips of one cross section (360 strips per axis)
+ */
+#define MAX_FIT_POINTS 512
+
+/**
+ * Charges of the strips inside the fit range and their x values (see
+ * HitEstimator::getBinCenter). Strips without charge are skipped like empty bins in a ROOT fit.
+ */
+struct FitPoints {
+	double x[MAX_FIT_POINTS];
+	double charge[MAX_FIT_POINTS];
+	int strip[MAX_FIT_POINTS];
+	unsigned int size;
+
+	FitPoints(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			unsigned int startFitRange, unsigned int endFitRange) :
+			size(0) {
+		for (unsigned int i = 0; i != stripAndChargeAtMaxChargeTimes.size();
+				i++) {
+			const int stripNumber = stripAndChargeAtMaxChargeTimes[i].first;
+			if (stripNumber < (int) startFitRange
+					|| stripNumber > (int) endFitRange) {
+				continue;
+			}
+			// Same as SetBinContent: a strip stored twice overwrites the first charge
+			if (size != 0 && strip[size - 1] == stripNumber) {
+				size--;
+			}
+			if (stripAndChargeAtMaxChargeTimes[i].second == 0
+					|| size == MAX_FIT_POINTS) {
+				continue;
+			}
+			strip[size] = stripNumber;
+			x[size] = HitEstimator::getBinCenter(stripNumber, startFitRange,
+					endFitRange);
+			charge[size] = stripAndChargeAtMaxChargeTimes[i].second;
+			size++;
+		}
+	}
+};
+
+/**
+ * Inverts the symmetric 3x3 matrix m. Returns false if m is singular
+ */
+static bool invertSymmetric3x3(const double m[3][3], double inverse[3][3]) {
+	const double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	const double c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	const double c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	const double determinant = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+	if (determinant == 0 || !std::isfinite(determinant)) {
+		return false;
+	}
+
+	inverse[0][0] = c00 / determinant;
+	inverse[0][1] = inverse[1][0] = c01 / determinant;
+	inverse[0][2] = inverse[2][0] = c02 / determinant;
+	inverse[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / determinant;
+	inverse[1][2] = inverse[2][1] = (m[0][2] * m[1][0] - m[0][0] * m[1][2])
+			/ determinant;
+	inverse[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / determinant;
+	return true;
+}
+
+/**
+ * Calculates chi2, ndf and the error of the mean of the Gaussian stored in result. The errors of
+ * the charges are sqrt(|charge|) like for a histogram filled via SetBinContent. The error of the
+ * mean is taken from the covariance matrix of a chi2 fit at the estimated parameters.
+ *
+ * Returns false if the parameters are not usable.
+ */
+static bool calculateChi2AndErrors(const FitPoints& points,
+		HitFitResult& result) {
+	if (!std::isfinite(result.mean) || !std::isfinite(result.sigma)
+			|| !std::isfinite(result.amplitude) || result.sigma <= 0) {
+		return false;
+	}
+
+	double chi2 = 0;
+	double curvature[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+	for (unsigned int i = 0; i != points.size; i++) {
+		const double weight = 1. / std::fabs(points.charge[i]);
+		const double distance = points.x[i] - result.mean;
+		const double exponential = std::exp(
+				-0.5 * distance * distance / (result.sigma * result.sigma));
+		const double residual = points.charge[i]
+				- result.amplitude * exponential;
+		chi2 += residual * residual * weight;
+
+		// derivatives of the Gaussian by amplitude, mean and sigma
+		const double derivative[3] = { exponential, result.amplitude
+				* exponential * distance / (result.sigma * result.sigma),
+				result.amplitude * exponential * distance * distance
+						/ (result.sigma * result.sigma * result.sigma) };
+		for (int row = 0; row != 3; row++) {
+			for (int column = 0; column != 3; column++) {
+				curvature[row][column] += weight * derivative[row]
+						* derivative[column];
+			}
+		}
+	}
+
+	double covariance[3][3];
+	result.meanError =
+			invertSymmetric3x3(curvature, covariance) && covariance[1][1] > 0 ?
+					std::sqrt(covariance[1][1]) : 0;
+	result.chi2 = chi2;
+	result.ndf = points.size - 3;
+	return true;
+}
+
+bool CenterOfGravityEstimator::estimate(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, unsigned int startFitRange, unsigned int endFitRange,
+		HitFitResult& result) {
+	FitPoints points(stripAndChargeAtMaxChargeTimes, startFitRange,
+			endFitRange);
+	if (points.size < 3) {
+		return false;
+	}
+
+	double sumOfCharges = 0;
+	double sumOfWeightedX = 0;
+	double maximumCharge = 0;
+	for (unsigned int i = 0; i != points.size; i++) {
+		if (points.charge[i] > 0) {
+			sumOfCharges += points.charge[i];
+			sumOfWeightedX += points.charge[i] * points.x[i];
+			if (points.charge[i] > maximumCharge) {
+				maximumCharge = points.charge[i];
+			}
+		}
+	}
+	if (sumOfCharges <= 0) {
+		return false;
+	}
+	result.mean = sumOfWeightedX / sumOfCharges;
+
+	double sumOfWeightedSquares = 0;
+	for (unsigned int i = 0; i != points.size; i++) {
+		if (points.charge[i] > 0) {
+			sumOfWeightedSquares += points.charge[i]
+					* (points.x[i] - result.mean) * (points.x[i] - result.mean);
+		}
+	}
+	result.sigma = std::sqrt(sumOfWeightedSquares / sumOfCharges);
+	result.amplitude = maximumCharge;
+
+	return calculateChi2AndErrors(points, result);
+}
+
+bool ThreePointGaussEstimator::estimate(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, unsigned int startFitRange, unsigned int endFitRange,
+		HitFitResult& result) {
+	FitPoints points(stripAndChargeAtMaxChargeTimes, startFitRange,
+			endFitRange);
+	if (points.size < 3) {
+		return false;
+	}
+
+	unsigned int maximum = 0;
+	for (unsigned int i = 1; i != points.size; i++) {
+		if (points.charge[i] > points.charge[maximum]) {
+			maximum = i;
+		}
+	}
+
+	// Both direct neighbours must have been stored with a positive charge
+	if (maximum == 0 || maximum == points.size - 1
+			|| points.strip[maximum - 1] != points.strip[maximum] - 1
+			|| points.strip[maximum + 1] != points.strip[maximum] + 1
+			|| points.charge[maximum - 1] <= 0
+			|| points.charge[maximum + 1] <= 0) {
+		return false;
+	}
+
+	const double logLeft = std::log(points.charge[maximum - 1]);
+	const double logCenter = std::log(points.charge[maximum]);
+	const double logRight = std::log(points.charge[maximum + 1]);
+	const double curvature = 2 * logCenter - logLeft - logRight;
+	if (curvature <= 0) {
+		return false;
+	}
+
+	const double stripDistance = points.x[maximum + 1] - points.x[maximum];
+	const double shift = 0.5 * (logRight - logLeft) / curvature;
+
+	result.mean = points.x[maximum] + shift * stripDistance;
+	result.sigma = stripDistance / std::sqrt(curvature);
+	result.amplitude = std::exp(logCenter + 0.25 * (logRight - logLeft) * shift);
+
+	return calculateChi2AndErrors(points, result);
+}
+
+bool WeightedLeastSquaresGaussEstimator::estimate(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, unsigned int startFitRange, unsigned int endFitRange,
+		HitFitResult& result) {
+	FitPoints points(stripAndChargeAtMaxChargeTimes, startFitRange,
+			endFitRange);
+	if (points.size < 3) {
+		return false;
+	}
+
+	/*
+	 * ln(charge) = a + b*x + c*x^2 is fitted to all strips with positive charge. The weights are
+	 * charge^2 in the first iteration and the squared Gaussian of the previous iteration
+	 * afterwards. x is shifted by the position of the maximum to keep the matrix well conditioned.
+	 */
+	double origin = points.x[0];
+	double maximumCharge = points.charge[0];
+	unsigned int numberOfPositivePoints = 0;
+	for (unsigned int i = 0; i != points.size; i++) {
+		if (points.charge[i] > 0) {
+			numberOfPositivePoints++;
+		}
+		if (points.charge[i] > maximumCharge) {
+			maximumCharge = points.charge[i];
+			origin = points.x[i];
+		}
+	}
+	if (numberOfPositivePoints < 3) {
+		return false;
+	}
+
+	double a = 0, b = 0, c = 0;
+	for (int iteration = 0; iteration != NUMBER_OF_ITERATIONS; iteration++) {
+		double normalMatrix[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+		double rightHandSide[3] = { 0, 0, 0 };
+
+		for (unsigned int i = 0; i != points.size; i++) {
+			if (points.charge[i] <= 0) {
+				continue;
+			}
+			const double x = points.x[i] - origin;
+			double weight = points.charge[i];
+			if (iteration != 0) {
+				weight = std::exp(a + b * x + c * x * x);
+			}
+			weight *= weight;
+
+			const double powers[3] = { 1, x, x * x };
+			const double logCharge = std::log(points.charge[i]);
+			for (int row = 0; row != 3; row++) {
+				rightHandSide[row] += weight * powers[row] * logCharge;
+				for (int column = 0; column != 3; column++) {
+					normalMatrix[row][column] += weight * powers[row]
+							* powers[column];
+				}
+			}
+		}
+
+		double inverse[3][3];
+		if (!invertSymmetric3x3(normalMatrix, inverse)) {
+			return false;
+		}
+		a = inverse[0][0] * rightHandSide[0] + inverse[0][1] * rightHandSide[1]
+				+ inverse[0][2] * rightHandSide[2];
+		b = inverse[1][0] * rightHandSide[0] + inverse[1][1] * rightHandSide[1]
+				+ inverse[1][2] * rightHandSide[2];
+		c = inverse[2][0] * rightHandSide[0] + inverse[2][1] * rightHandSide[1]
+				+ inverse[2][2] * rightHandSide[2];
+
+		// No maximum: the charges do not look like a Gaussian
+		if (c >= 0) {
+			return false;
+		}
+	}
+
+	result.sigma = std::sqrt(-0.5 / c);
+	result.mean = origin - 0.5 * b / c;
+	result.amplitude = std::exp(a - 0.25 * b * b / c);
+
+	return calculateChi2AndErrors(points, result);
+}
+
+bool MinuitEstimator::estimate(
+		const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+		int eventNumber, unsigned int startFitRange, unsigned int endFitRange,
+		HitFitResult& result) {
+	std::lock_guard<std::mutex> lock(getFitMutex());
+
+	TH1F* maxChargeCrossSection = NULL;
+	TF1* gaussFit = fitGauss(stripAndChargeAtMaxChargeTimes, eventNumber,
+			"maxChargeCrossSection", maxChargeCrossSection, startFitRange,
+			endFitRange);
+
+	if (gaussFit != NULL) {
+		result.amplitude = gaussFit->GetParameter(0);
+		result.mean = gaussFit->GetParameter(1);
+		result.meanError = gaussFit->GetParError(1);
+		result.sigma = gaussFit->GetParameter(2);
+		result.chi2 = gaussFit->GetChisquare();
+		result.ndf = gaussFit->GetNDF();
+	}
+	delete maxChargeCrossSection;
+	return gaussFit != NULL;
+}
+
+HitEstimator* HitEstimator::create(Type type) {
+	switch (type) {
+	case CENTER_OF_GRAVITY:
+		return new CenterOfGravityEstimator();
+	case THREE_POINT_GAUSS:
+		return new ThreePointGaussEstimator();
+	case MINUIT:
+		return new MinuitEstimator();
+	default:
+		return new WeightedLeastSquaresGaussEstimator();
+	}
+}
+
+const char* HitEstimator::getName(Type type) {
+	switch (type) {
+	case CENTER_OF_GRAVITY:
+		return "cog";
+	case THREE_POINT_GAUSS:
+		return "3point";
+	case MINUIT:
+		return "minuit";
+	default:
+		return "wls";
+	}
+}
+
+bool HitEstimator::getTypeByName(std::string name, Type& type) {
+	const Type types[] = { CENTER_OF_GRAVITY, THREE_POINT_GAUSS,
+			WEIGHTED_LEAST_SQUARES, MINUIT };
+	for (unsigned int i = 0; i != sizeof(types) / sizeof(types[0]); i++) {
+		if (name == getName(types[i])) {
+			type = types[i];
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,147 @@
+/*
+ * HitEstimator.h
+ */
+
+#ifndef HITESTIMATOR_H_
+#define HITESTIMATOR_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Parameters of the Gaussian describing the charge distribution of a cross section (same meaning
+ * as the parameters of the ROOT "gaus" function: amplitude*exp(-0.5*((x-mean)/sigma)^2))
+ */
+struct HitFitResult {
+	double amplitude;
+	double mean;
+	double meanError;
+	double sigma;
+	double chi2;
+	int ndf;
+};
+
+/**
+ * Estimates hit position and width of the charge cross section of one event.
+ *
+ * The strips in [startFitRange, endFitRange] are mapped to the same x values as the bin centers of
+ * the histogram used by fitGauss (see getBinCenter) so that every estimator is comparable to the
+ * reference fit. chi2 and ndf are calculated like a ROOT chi2 fit with errors sqrt(|charge|),
+ * ignoring strips without charge.
+ */
+class HitEstimator {
+public:
+	enum Type {
+		CENTER_OF_GRAVITY, THREE_POINT_GAUSS, WEIGHTED_LEAST_SQUARES, MINUIT
+	};
+
+	virtual ~HitEstimator() {
+	}
+
+	/**
+	 * Returns false if no result could be estimated (same as fitGauss returning NULL)
+	 */
+	virtual bool estimate(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			int eventNumber, unsigned int startFitRange,
+			unsigned int endFitRange, HitFitResult& result) = 0;
+
+	virtual Type getType() const = 0;
+
+	const char* getName() const {
+		return getName(getType());
+	}
+
+	/**
+	 * Returns a new estimator of the given type
+	 */
+	static HitEstimator* create(Type type);
+
+	static const char* getName(Type type);
+
+	/**
+	 * Parses the name of an estimator as used on the command line (cog, 3point, wls, minuit).
+	 * Returns false if the name is unknown
+	 */
+	static bool getTypeByName(std::string name, Type& type);
+
+	/**
+	 * x value of the strip in the histogram used by fitGauss: the histogram has
+	 * endFitRange-startFitRange+2 bins between startFitRange and endFitRange and the charge of
+	 * strip s is stored in bin s-startFitRange+1
+	 */
+	static double getBinCenter(int strip, unsigned int startFitRange,
+			unsigned int endFitRange) {
+		const double binWidth = (double) (endFitRange - startFitRange)
+				/ (endFitRange - startFitRange + 2);
+		return startFitRange + (strip - (double) startFitRange + 0.5) * binWidth;
+	}
+};
+
+/**
+ * Charge weighted mean and RMS of all strips with positive charge
+ */
+class CenterOfGravityEstimator: public HitEstimator {
+public:
+	bool estimate(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			int eventNumber, unsigned int startFitRange,
+			unsigned int endFitRange, HitFitResult& result);
+
+	Type getType() const {
+		return CENTER_OF_GRAVITY;
+	}
+};
+
+/**
+ * Parabola through the logarithms of the charges of the strip with maximum charge and its two
+ * direct neighbours (exact Gaussian through three points)
+ */
+class ThreePointGaussEstimator: public HitEstimator {
+public:
+	bool estimate(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			int eventNumber, unsigned int startFitRange,
+			unsigned int endFitRange, HitFitResult& result);
+
+	Type getType() const {
+		return THREE_POINT_GAUSS;
+	}
+};
+
+/**
+ * Weighted least squares fit of a parabola to the logarithms of the charges (Guo's iterative
+ * variant of Caruana's algorithm). All data is kept on the stack.
+ */
+class WeightedLeastSquaresGaussEstimator: public HitEstimator {
+public:
+	static const int NUMBER_OF_ITERATIONS = 3;
+
+	bool estimate(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			int eventNumber, unsigned int startFitRange,
+			unsigned int endFitRange, HitFitResult& result);
+
+	Type getType() const {
+		return WEIGHTED_LEAST_SQUARES;
+	}
+};
+
+/**
+ * Reference implementation: Minuit fit of a histogram via fitGauss. Slow, only meant to validate
+ * the other estimators.
+ */
+class MinuitEstimator: public HitEstimator {
+public:
+	bool estimate(
+			const std::vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTimes,
+			int eventNumber, unsigned int startFitRange,
+			unsigned int endFitRange, HitFitResult& result);
+
+	Type getType() const {
+		return MINUIT;
+	}
+};
+
+#endif /* HITESTIMATOR_H_ */
@@ -0,0 +1,111 @@
+/*
+ * IoAudit.h
+ */
+
+#ifndef IOAUDIT_H_
+#define IOAUDIT_H_
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Rtypes.h>
+
+struct BranchReadStatistics {
+	Long64_t bytesRead; // uncompressed, as returned by TBranch::GetEntry
+	Long64_t compressedBytesRead; // sum of the compressed sizes of all baskets read
+	Long64_t basketsRead;
+
+	BranchReadStatistics() :
+			bytesRead(0), compressedBytesRead(0), basketsRead(0) {
+	}
+};
+
+struct FileReadStatistics {
+	std::string fileName;
+	Long64_t bytesRead; // from disk, including the prefetching of the TTreeCache
+	int readCalls;
+	bool hasCache;
+	double cacheHitRate; // TTreeCache::GetEfficiencyRel: baskets found in the cache / baskets requested
+	double cacheEfficiency; // TTreeCache::GetEfficiency: baskets used / baskets prefetched
+
+	FileReadStatistics() :
+			bytesRead(0), readCalls(0), hasCache(false), cacheHitRate(0), cacheEfficiency(
+					0) {
+	}
+};
+
+/**
+ * What has been read by the MMQuickEvents of one run (see MMQuickEvent::addIoStatistics). The
+ * statistics of several readers of the same run are combined with add().
+ */
+class IoAudit {
+public:
+	std::map<std::string, BranchReadStatistics> branches;
+	std::vector<FileReadStatistics> files;
+
+	void add(const IoAudit& other) {
+		for (auto& pair : other.branches) {
+			BranchReadStatistics& statistics = branches[pair.first];
+			statistics.bytesRead += pair.second.bytesRead;
+			statistics.compressedBytesRead += pair.second.compressedBytesRead;
+			statistics.basketsRead += pair.second.basketsRead;
+		}
+		files.insert(files.end(), other.files.begin(), other.files.end());
+	}
+
+	/**
+	 * Prints the bytes read per branch. With <detailed> the compressed bytes, the number of baskets
+	 * and the read calls and cache hit rate of every file are printed as well.
+	 */
+	void print(const std::string& runName, bool detailed) const {
+		BranchReadStatistics total;
+		for (auto& pair : branches) {
+			total.bytesRead += pair.second.bytesRead;
+			total.compressedBytesRead += pair.second.compressedBytesRead;
+			total.basketsRead += pair.second.basketsRead;
+		}
+
+		std::stringstream report;
+		report << "Bytes read per branch of run " << runName << ":" << std::endl;
+		for (auto& pair : branches) {
+			printBranch(report, pair.first, pair.second, total.bytesRead,
+					detailed);
+		}
+		printBranch(report, "total", total, total.bytesRead, detailed);
+
+		if (detailed) {
+			for (auto& file : files) {
+				report << "  " << file.fileName << ": " << file.bytesRead
+						<< " bytes in " << file.readCalls << " read calls";
+				if (file.hasCache) {
+					report << ", TTreeCache hit rate " << 100 * file.cacheHitRate
+							<< "%, efficiency " << 100 * file.cacheEfficiency
+							<< "%";
+				} else {
+					report << ", no TTreeCache";
+				}
+				report << std::endl;
+			}
+		}
+		std::cout << report.str();
+	}
+
+private:
+	static void printBranch(std::stringstream& report, std::string name,
+			const BranchReadStatistics& statistics, Long64_t totalBytes,
+			bool detailed) {
+		report << "  " << name << "\t" << statistics.bytesRead << "\t"
+				<< (totalBytes == 0 ? 0 : 100. * statistics.bytesRead / totalBytes)
+				<< "%";
+		if (detailed) {
+			report << "\tcompressed " << statistics.compressedBytesRead
+					<< "\tbaskets " << statistics.basketsRead;
+		}
+		report << std::endl;
+	}
+};
+
+#endif /* IOAUDIT_H_ */
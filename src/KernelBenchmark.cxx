@@ -0,0 +1,387 @@
+/*
+ * KernelBenchmark.cxx
+ *
+ * Micro-benchmark of the per-event kernels of MMQuickEvent and of the hit estimators on synthetic
+ * events (see SyntheticEventGenerator), without any file access. Every kernel is timed separately:
+ * the work it depends on (loading the charges, findMaxCharge, the cross sections) is done for each
+ * event before its timer is started.
+ *
+ * With --check nothing is timed: the SIMD implementations of SimdKernels are compared with the
+ * scalar ones on the same events instead, and the exit code is 1 if any result differs.
+ *
+ * Usage: KernelBenchmark [--events=N] [--repetitions=R] [--seed=S] [--check]
+ */
+
+#include <TH1.h>
+#include <TH2.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "CutStatistic.h"
+#include "EventDisplaySnapshot.h"
+#include "FastHistogram.h"
+#include "HitEstimator.h"
+#include "MapFile.h"
+#include "MMQuickEvent.h"
+#include "SimdKernels.h"
+#include "SyntheticEventGenerator.h"
+
+// same as in MMPlots.cxx
+#define FIT_RANGE 20
+
+// only the first mismatches of each instruction set are printed by --check
+#define MAX_REPORTED_MISMATCHES 10
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+ * Work done per event before (prepare) and during (kernel) the measurement
+ */
+typedef std::function<void(SyntheticEvent&)> BenchmarkStep;
+
+/*
+ * Runs <prepare> and <kernel> for all events <repetitions> times and returns the smallest total
+ * time spent in <kernel> per repetition in nanoseconds (the least disturbed one)
+ */
+static double measure(std::vector<SyntheticEvent>& events,
+		unsigned int repetitions, BenchmarkStep prepare, BenchmarkStep kernel) {
+	double best = std::numeric_limits<double>::max();
+	for (unsigned int repetition = 0; repetition != repetitions;
+			repetition++) {
+		double total = 0;
+		for (SyntheticEvent& event : events) {
+			prepare(event);
+			const Clock::time_point start = Clock::now();
+			kernel(event);
+			total += std::chrono::duration_cast<std::chrono::nanoseconds>(
+					Clock::now() - start).count();
+		}
+		best = std::min(best, total);
+	}
+	return best;
+}
+
+/*
+ * Fit range of the hit on one axis as in fitHit of MMPlots.cxx
+ */
+static void getFitRange(const MMEventView& view, int stripWithMaxCharge,
+		unsigned int& startFitRange, unsigned int& endFitRange) {
+	const int start = view.mm_strip[stripWithMaxCharge] - FIT_RANGE / 2;
+	startFitRange = start > 0 ? start : 0;
+	endFitRange = view.mm_strip[stripWithMaxCharge] + FIT_RANGE / 2;
+}
+
+static bool isEqual(const MaxChargeResult& left, const MaxChargeResult& right) {
+	return left.maxChargeX == right.maxChargeX
+			&& left.stripWithMaxChargeX == right.stripWithMaxChargeX
+			&& left.timeSliceOfMaxChargeX == right.timeSliceOfMaxChargeX
+			&& left.maxChargeY == right.maxChargeY
+			&& left.stripWithMaxChargeY == right.stripWithMaxChargeY
+			&& left.timeSliceOfMaxChargeY == right.timeSliceOfMaxChargeY
+			&& left.numberOfXHits == right.numberOfXHits
+			&& left.numberOfYHits == right.numberOfYHits;
+}
+
+/*
+ * Compares the results of every instruction set supported by the CPU with the scalar ones:
+ * findMaxCharge for every prefix of the strips of each event (to cover the remainders of the vector
+ * loops) and gatherCrossSections for every valid time slice. Returns the number of mismatches.
+ */
+static unsigned int checkInstructionSets(std::vector<SyntheticEvent>& events,
+		MMQuickEvent* event) {
+	const MMEventView& view = event->getView();
+	const SimdKernels::InstructionSet best = SimdKernels::detectInstructionSet();
+	if (best == SimdKernels::SCALAR) {
+		std::cout << "Only the scalar kernels are supported by this CPU"
+				<< std::endl;
+	}
+
+	unsigned int numberOfMismatches = 0;
+	std::vector<std::pair<int, short> > expectedX, expectedY;
+	std::vector<std::pair<int, short> > crossSectionX, crossSectionY;
+	for (int i = SimdKernels::SCALAR + 1; i <= best; i++) {
+		const SimdKernels::InstructionSet instructionSet =
+				(SimdKernels::InstructionSet) i;
+		const char* name = SimdKernels::getInstructionSetName(instructionSet);
+		const unsigned int numberOfMismatchesBefore = numberOfMismatches;
+		unsigned int numberOfComparisons = 0;
+		for (SyntheticEvent& e : events) {
+			event->setEvent(e.apv_id, e.mm_strip, e.apv_q, e.apv_qmax,
+					e.apv_tbqmax);
+			event->loadCharges();
+			const unsigned int numberOfStrips = view.getNumberOfStrips();
+
+			for (unsigned int n = 0; n <= numberOfStrips; n++) {
+				MaxChargeResult expected, result;
+				SimdKernels::setInstructionSet(SimdKernels::SCALAR);
+				SimdKernels::findMaxCharge(view.apv_id.data(),
+						view.apv_qmax.data(), view.apv_tbqmax.data(), n, expected);
+				SimdKernels::setInstructionSet(instructionSet);
+				SimdKernels::findMaxCharge(view.apv_id.data(),
+						view.apv_qmax.data(), view.apv_tbqmax.data(), n, result);
+				numberOfComparisons++;
+				if (!isEqual(expected, result)) {
+					if (numberOfMismatches - numberOfMismatchesBefore
+							< MAX_REPORTED_MISMATCHES) {
+						std::cerr << name << ": findMaxCharge differs for event "
+								<< e.apv_evt << " with " << n << " strips"
+								<< std::endl;
+					}
+					numberOfMismatches++;
+				}
+			}
+
+			expectedX.resize(numberOfStrips + 1);
+			expectedY.resize(numberOfStrips + 1);
+			crossSectionX.resize(numberOfStrips + 1);
+			crossSectionY.resize(numberOfStrips + 1);
+			const int stride = view.apv_q.getStride();
+			for (int timeSliceX = 0; timeSliceX < stride - 1; timeSliceX++) {
+				// different time slices for X and Y
+				const int timeSliceY = stride - 2 - timeSliceX;
+				unsigned int expectedNumberOfX, expectedNumberOfY;
+				unsigned int numberOfX, numberOfY;
+				SimdKernels::setInstructionSet(SimdKernels::SCALAR);
+				SimdKernels::gatherCrossSections(view.apv_id.data(),
+						view.mm_strip.data(), view.apv_q.data(), stride,
+						numberOfStrips, timeSliceX, timeSliceY, &expectedX[0],
+						expectedNumberOfX, &expectedY[0], expectedNumberOfY);
+				SimdKernels::setInstructionSet(instructionSet);
+				SimdKernels::gatherCrossSections(view.apv_id.data(),
+						view.mm_strip.data(), view.apv_q.data(), stride,
+						numberOfStrips, timeSliceX, timeSliceY, &crossSectionX[0],
+						numberOfX, &crossSectionY[0], numberOfY);
+				numberOfComparisons++;
+				if (numberOfX != expectedNumberOfX
+						|| numberOfY != expectedNumberOfY
+						|| !std::equal(crossSectionX.begin(),
+								crossSectionX.begin() + numberOfX,
+								expectedX.begin())
+						|| !std::equal(crossSectionY.begin(),
+								crossSectionY.begin() + numberOfY,
+								expectedY.begin())) {
+					if (numberOfMismatches - numberOfMismatchesBefore
+							< MAX_REPORTED_MISMATCHES) {
+						std::cerr << name
+								<< ": gatherCrossSections differs for event "
+								<< e.apv_evt << " at the time slices " << timeSliceX
+								<< "/" << timeSliceY << std::endl;
+					}
+					numberOfMismatches++;
+				}
+			}
+		}
+		std::cout << name << ": " << numberOfComparisons
+				<< " results compared with the scalar kernels, "
+				<< numberOfMismatches - numberOfMismatchesBefore << " differ"
+				<< std::endl;
+	}
+	SimdKernels::setInstructionSet(best);
+	return numberOfMismatches;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned int numberOfEvents = 2000;
+	unsigned int repetitions = 5;
+	unsigned int seed = 1;
+	bool check = false;
+	for (int i = 1; i < argc; i++) {
+		std::string argument(argv[i]);
+		if (argument.find("--events=") == 0) {
+			numberOfEvents = atoi(
+					argument.substr(std::string("--events=").size()).c_str());
+		} else if (argument.find("--repetitions=") == 0) {
+			repetitions = atoi(
+					argument.substr(std::string("--repetitions=").size()).c_str());
+		} else if (argument.find("--seed=") == 0) {
+			seed = atoi(argument.substr(std::string("--seed=").size()).c_str());
+		} else if (argument == "--check") {
+			check = true;
+		} else {
+			std::cerr << "Unknown argument " << argument << std::endl;
+			std::cerr
+					<< "Usage: KernelBenchmark [--events=N] [--repetitions=R] [--seed=S] [--check]"
+					<< std::endl;
+			return 1;
+		}
+	}
+	if (numberOfEvents == 0 || repetitions == 0) {
+		std::cerr << "At least one event and one repetition are needed"
+				<< std::endl;
+		return 1;
+	}
+
+	TH1::AddDirectory(kFALSE);
+	MapFile::setProportionLimits();
+
+	SyntheticEventGenerator generator(SyntheticEventParameters(), seed);
+	std::vector<SyntheticEvent> events(numberOfEvents);
+	double numberOfStripsX = 0;
+	double numberOfStripsY = 0;
+	for (SyntheticEvent& event : events) {
+		generator.generate(event);
+		for (unsigned int id : event.apv_id) {
+			(MMQuickEvent::isX(id) ? numberOfStripsX : numberOfStripsY)++;
+		}
+	}
+
+	MMQuickEvent quickEvent(std::vector<std::string>(), "raw", 0);
+	quickEvent.setShowProgress(false);
+	MMQuickEvent* event = &quickEvent;
+	const MMEventView& view = event->getView();
+
+	if (check) {
+		return checkInstructionSets(events, event) == 0 ? 0 : 1;
+	}
+
+	/*
+	 * Preparation steps, each one including the previous ones
+	 */
+	BenchmarkStep setEvent = [event](SyntheticEvent& e) {
+		event->setEvent(e.apv_id, e.mm_strip, e.apv_q, e.apv_qmax, e.apv_tbqmax);
+	};
+	BenchmarkStep loadCharges = [&](SyntheticEvent& e) {
+		setEvent(e);
+		event->findMaxCharge(view);
+		event->loadCharges();
+	};
+	BenchmarkStep generateCrossSections = [&](SyntheticEvent& e) {
+		loadCharges(e);
+		event->generateFixedTimeCrossSections();
+	};
+
+	// Histograms and cut statistics with the binning and names used by the analysis
+	FastHistogram2D neighboursX("mmhitneighboursX", "", 13, -6.5, 6.5, 20, 0,
+			100);
+	FastHistogram2D neighboursY("mmhitneighboursY", "", 13, -6.5, 6.5, 20, 0,
+			100);
+	FastHistogram2D timeShapeX("timeShapeX", "", 2 * NUMBER_OF_TIME_SLICES + 1,
+			-NUMBER_OF_TIME_SLICES - 0.5, NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5,
+			100.5);
+	FastHistogram2D timeShapeY("timeShapeY", "", 2 * NUMBER_OF_TIME_SLICES + 1,
+			-NUMBER_OF_TIME_SLICES - 0.5, NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5,
+			100.5);
+	std::vector<CutStatistic*> cutStatistics;
+	CutStatistic absolutePositionXCuts("absolutePositionXCuts", cutStatistics);
+	CutStatistic absolutePositionYCuts("absolutePositionYCuts", cutStatistics);
+	CutStatistic proportionXCuts("proportionXCuts", cutStatistics);
+	CutStatistic proportionYCuts("proportionYCuts", cutStatistics);
+
+	EventDisplaySnapshot snapshot;
+
+	std::vector<std::pair<std::string, double> > results;
+	auto run = [&](std::string name, BenchmarkStep prepare, BenchmarkStep kernel) {
+		results.push_back(
+				std::make_pair(name,
+						measure(events, repetitions, prepare, kernel)));
+	};
+
+	// Time of starting and stopping the clock, subtracted from all kernels
+	const double timerOverhead = measure(events, repetitions, setEvent,
+			[](SyntheticEvent&) {});
+
+	run("findMaxCharge", setEvent, [&](SyntheticEvent&) {
+		event->findMaxCharge(view);
+	});
+
+	run("generateFixedTimeCrossSections", loadCharges, [&](SyntheticEvent&) {
+		event->generateFixedTimeCrossSections();
+	});
+
+	run("runProportionCut (X+Y)", generateCrossSections, [&](SyntheticEvent&) {
+		const bool acceptEventX = event->runProportionCut(&neighboursX,
+				event->stripAndChargeAtMaxChargeTimeX, event->maxChargeX,
+				MapFile::getProportionLimitsOfMaxHitNeighboursX(),
+				absolutePositionXCuts, proportionXCuts, false,
+				event->positionOfMaxChargeInCrossSectionX);
+		event->runProportionCut(&neighboursY,
+				event->stripAndChargeAtMaxChargeTimeY, event->maxChargeY,
+				MapFile::getProportionLimitsOfMaxHitNeighboursY(),
+				absolutePositionYCuts, proportionYCuts, !acceptEventX,
+				event->positionOfMaxChargeInCrossSectionY);
+	});
+
+	run("calculateClusterSize (X+Y)", generateCrossSections,
+			[&](SyntheticEvent&) {
+				event->calculateClusterSize(event->stripAndChargeAtMaxChargeTimeX,
+						event->positionOfMaxChargeInCrossSectionX);
+				event->calculateClusterSize(event->stripAndChargeAtMaxChargeTimeY,
+						event->positionOfMaxChargeInCrossSectionY);
+			});
+
+	run("generateTimeShape (X+Y)", loadCharges, [&](SyntheticEvent&) {
+		event->generateTimeShape(&timeShapeX, event->maxChargeX,
+				event->stripWithMaxChargeX, event->timeSliceOfMaxChargeX);
+		event->generateTimeShape(&timeShapeY, event->maxChargeY,
+				event->stripWithMaxChargeY, event->timeSliceOfMaxChargeY);
+	});
+
+	/*
+	 * The event display is taken as a snapshot for every sampled event, the histograms are only
+	 * created for the ones that are written
+	 */
+	run("takeEventDisplaySnapshot", loadCharges, [&](SyntheticEvent&) {
+		event->takeEventDisplaySnapshot(snapshot);
+	});
+
+	run("event display histograms", [&](SyntheticEvent& e) {
+		loadCharges(e);
+		event->takeEventDisplaySnapshot(snapshot);
+	}, [&](SyntheticEvent&) {
+		TH2F* eventDisplayX;
+		TH2F* eventDisplayY;
+		snapshot.createHistograms(eventDisplayX, eventDisplayY);
+		delete eventDisplayX;
+		delete eventDisplayY;
+	});
+
+	const HitEstimator::Type estimatorTypes[] = {
+			HitEstimator::CENTER_OF_GRAVITY, HitEstimator::THREE_POINT_GAUSS,
+			HitEstimator::WEIGHTED_LEAST_SQUARES, HitEstimator::MINUIT };
+	for (HitEstimator::Type type : estimatorTypes) {
+		HitEstimator* estimator = HitEstimator::create(type);
+		HitFitResult result;
+		run(std::string("hit fit ") + estimator->getName() + " (X+Y)",
+				generateCrossSections, [&](SyntheticEvent&) {
+					unsigned int startFitRange;
+					unsigned int endFitRange;
+					getFitRange(view, event->stripWithMaxChargeX, startFitRange,
+							endFitRange);
+					estimator->estimate(event->stripAndChargeAtMaxChargeTimeX, 0,
+							startFitRange, endFitRange, result);
+					getFitRange(view, event->stripWithMaxChargeY, startFitRange,
+							endFitRange);
+					estimator->estimate(event->stripAndChargeAtMaxChargeTimeY, 0,
+							startFitRange, endFitRange, result);
+				});
+		delete estimator;
+	}
+
+	std::cout << "Kernel benchmark: " << numberOfEvents
+			<< " synthetic events (seed " << seed << "), best of " << repetitions
+			<< " repetitions, " << numberOfStripsX / numberOfEvents
+			<< " X and " << numberOfStripsY / numberOfEvents
+			<< " Y strips per event, timer overhead "
+			<< timerOverhead / numberOfEvents << " ns/event subtracted"
+			<< std::endl;
+	std::cout << "(kernel, ns/event, events/s):" << std::endl;
+	for (auto& result : results) {
+		const double nanosecondsPerEvent = std::max(0.,
+				(result.second - timerOverhead) / numberOfEvents);
+		std::cout << "  " << std::left << std::setw(34) << result.first
+				<< std::right << std::setw(12) << std::fixed
+				<< std::setprecision(1) << nanosecondsPerEvent << std::setw(16)
+				<< std::setprecision(0)
+				<< (nanosecondsPerEvent == 0 ? 0 : 1e9 / nanosecondsPerEvent)
+				<< std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * MMEventView.h
+ */
+
+#ifndef MMEVENTVIEW_H_
+#define MMEVENTVIEW_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Read-only view of a contiguous block of elements that is owned by someone else (e.g. the buffer
+ * of a branch vector). Copying a span never copies the underlying data.
+ */
+template<typename T>
+class ConstSpan {
+public:
+	ConstSpan() :
+			m_data(NULL), m_size(0) {
+	}
+
+	ConstSpan(const T* data, std::size_t size) :
+			m_data(data), m_size(size) {
+	}
+
+	ConstSpan(const std::vector<T>& vector) :
+			m_data(vector.empty() ? NULL : &vector[0]), m_size(vector.size()) {
+	}
+
+	const T& operator[](std::size_t i) const {
+		return m_data[i];
+	}
+
+	std::size_t size() const {
+		return m_size;
+	}
+
+	bool empty() const {
+		return m_size == 0;
+	}
+
+	const T* data() const {
+		return m_data;
+	}
+
+	const T* begin() const {
+		return m_data;
+	}
+
+	const T* end() const {
+		return m_data + m_size;
+	}
+
+private:
+	const T* m_data;
+	std::size_t m_size;
+};
+
+/**
+ * Read-only view of a strips x time slices charge matrix stored row by row (one row per strip).
+ * Rows are padded to getStride() elements so that every row starts at an aligned address.
+ */
+class ChargeMatrixView {
+public:
+	ChargeMatrixView() :
+			m_data(NULL), m_numberOfStrips(0), m_numberOfTimeSlices(0), m_stride(
+					0) {
+	}
+
+	ChargeMatrixView(const short* data, unsigned int numberOfStrips,
+			unsigned int numberOfTimeSlices, unsigned int stride) :
+			m_data(data), m_numberOfStrips(numberOfStrips), m_numberOfTimeSlices(
+					numberOfTimeSlices), m_stride(stride) {
+	}
+
+	/**
+	 * Returns the charge of strip <strip> in time section <timeSlice>
+	 */
+	short operator()(unsigned int strip, unsigned int timeSlice) const {
+		return m_data[strip * m_stride + timeSlice];
+	}
+
+	/**
+	 * Returns the charges of all time sections of the given strip
+	 */
+	const short* row(unsigned int strip) const {
+		return m_data + strip * m_stride;
+	}
+
+	const short* data() const {
+		return m_data;
+	}
+
+	unsigned int size() const {
+		return m_numberOfStrips;
+	}
+
+	unsigned int getNumberOfTimeSlices() const {
+		return m_numberOfTimeSlices;
+	}
+
+	unsigned int getStride() const {
+		return m_stride;
+	}
+
+private:
+	const short* m_data;
+	unsigned int m_numberOfStrips;
+	unsigned int m_numberOfTimeSlices;
+	unsigned int m_stride;
+};
+
+/**
+ * Read-only view of the current event of an MMQuickEvent. All spans point directly into the
+ * branch buffers (or the charge matrix of the MMQuickEvent) and are only valid until the next
+ * call of MMQuickEvent::getNextEvent().
+ *
+ * All per-strip spans have the same size: element i of every span belongs to the same strip.
+ */
+struct MMEventView {
+	unsigned int apv_evt;
+	int time_s;
+	int time_us;
+
+	ConstSpan<unsigned int> apv_id; // isX(apv_id[i]) returns true if the i-th strip is X-layer
+	ConstSpan<unsigned int> mm_strip; // mm_strip[i] is absolute strip number (strips without charge are not stored anywhere)
+	ChargeMatrixView apv_q; // apv_q(i, j) is the charge of strip i in time section j (matrix of whole event)
+	ConstSpan<short> apv_qmax; // apv_qmax[i] is the maxmimal measured charge of strip i of all time sections
+	ConstSpan<short> apv_tbqmax; // apv_tbqmax[i] is the time section of the corresponding maximum charge (see above)
+
+	MMEventView() :
+			apv_evt(0), time_s(0), time_us(0) {
+	}
+
+	unsigned int getNumberOfStrips() const {
+		return apv_qmax.size();
+	}
+};
+
+#endif /* MMEVENTVIEW_H_ */
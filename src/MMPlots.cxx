@@ -6,15 +6,36 @@
 #include "TFitResult.h"
 #include "TCanvas.h"
 #include "Helper.h"
+#include "HitEstimator.h"
+#include "AnalysisContext.h"
+#include "RunSummary.h"
+#include "RunOutputFile.h"
+#include "CutFlow.h"
+#include "PerfCounters.h"
+#include "CampaignBenchmark.h"
+
+#include <TROOT.h>
+#include <TSystem.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <set>
 /*
- * Limit the number of events to be processed to gain speed for debugging
- * -1 means all events will be processed
+ * Limit the number of events per run (--max-events=N) and of runs per drift gap
+ * (--runs-per-drift-gap=N) to be processed to gain speed for debugging
+ * -1 means all events/runs will be processed
  */
 int MAX_NUM_OF_EVENTS_TO_BE_PROCESSED = -1; // 192154 (run with fewest events)
-#define MAX_NUM_OF_RUNS_TO_BE_PROCESSED -1
+int MAX_NUM_OF_RUNS_TO_BE_PROCESSED = -1;
 
 #define DRAW_CUT_EVENT_DISPLAYS true
 /*
@@ -40,54 +61,139 @@ int MAX_NUM_OF_EVENTS_TO_BE_PROCESSED = -1; // 192154 (run with fewest events)
 #define FIT_RANGE 20
 #define MAX_FIT_MEAN_DISTANCE_TO_MAX 2 // Number of strips
 
+//TRGBURST gives number of recorded timesteps (variable from data aquisition)
+//timesteps = (TRGBURST+1)*3
+const int TRGBURST = 8;
+
 using namespace std;
 
 // Global Variables
-MMQuickEvent *m_event;
-map<string, TTree*> general_mapTree; 		//TTress
-map<string, TH1F*> general_mapHist1D; 	//1D histogram of analysis for each run
-map<string, TH2F*> general_mapHist2D;	//2D histogram of analysis for each run
-map<string, TH1F*> general_mapPlotFit;		//plot of fits
-map<string, TH2F*> general_mapCombined;		//combined Plots
-map<string, TH1F*> general_mapCombined1D;
+/*
+ * Estimator used for the hit position and width (set via --estimator=cog|3point|wls|minuit)
+ */
+HitEstimator::Type HIT_ESTIMATOR_TYPE = HitEstimator::WEIGHTED_LEAST_SQUARES;
 
-map<string, TH2F*> global_mapCombined2D;
+/*
+ * Number of runs processed concurrently (set via --jobs=N). Every run has its own AnalysisContext,
+ * the results are merged into the combined histograms in the order of the runs
+ */
+unsigned int NUMBER_OF_PARALLEL_RUNS = 1;
 
-Double_t m_TotalEventNumber;
-vector<double> eventTimes;
-
-//structure for trees
-struct gauss_t {
-	Double_t gaussXmean;
-	Double_t gaussXmeanError;
-	Double_t gaussXsigma;
-	Double_t gaussXcharge;
-	Double_t gaussXchi;
-	Double_t gaussXdof;
-	Double_t gaussXchiRed;
-	Double_t gaussYmean;
-	Double_t gaussYmeanError;
-	Double_t gaussYsigma;
-	Double_t gaussYcharge;
-	Double_t gaussYchi;
-	Double_t gaussYdof;
-	Double_t gaussYchiRed;
-	Int_t number;
-};
+/*
+ * Number of threads processing the events of a single run (set via --threads-per-run=N)
+ */
+int NUMBER_OF_THREADS_PER_RUN = 1;
 
-struct maxi_t {
-	Int_t maxXmean;
-	Int_t maxXcharge;
-	Int_t maxXcluster;
-	Int_t maxYmean;
-	Int_t maxYcharge;
-	Int_t maxYcluster;
-	Int_t number;
-};
+/*
+ * Number of runs processed concurrently by forked child processes (set via --processes=N). Replaces
+ * --jobs if larger than 1. Every child prints the stage times and hardware counters of its run to
+ * its log in <outPath>logs/, the ones printed by the parent do not include the children.
+ */
+unsigned int NUMBER_OF_PROCESSES = 1;
+
+/*
+ * Process the runs in a worker thread while the main thread writes the previous one, and open the
+ * next run before the current one is finished (see processRunsInThreads). Switched off via
+ * --no-pipeline
+ */
+bool PIPELINE_RUNS = true;
+
+/*
+ * Render the PDFs in a background thread (see PdfRenderQueue), switched off via --sync-pdf
+ */
+bool ASYNCHRONOUS_PDF_RENDERING = true;
+
+/*
+ * Write the plots of each run as pages of a single PDF <outPath>RunPlots/DG<gap>-<run>.pdf instead
+ * of one file per plot (--pdf-per-run)
+ */
+bool PDF_PER_RUN = false;
+
+/*
+ * Read the charges of an event only if it passes the first cuts (see MMQuickEvent::loadCharges).
+ * Switched off via --read-all-branches
+ */
+bool STAGED_BRANCH_LOADING = true;
+
+/*
+ * Print the compressed bytes, baskets, read calls and TTreeCache hit rate of every run in addition
+ * to the bytes read per branch (--io-audit)
+ */
+bool PRINT_IO_AUDIT = false;
 
-gauss_t gauss;
-maxi_t maxi;
+/*
+ * Print the events passed and cut and the time spent per stage of the cut flow of every run
+ * (--cut-flow)
+ */
+bool PRINT_CUT_FLOW = false;
 
+/*
+ * Number of events read ahead by a background thread of every reader, 0 to read the events in the
+ * analysing thread (--prefetch=N)
+ */
+unsigned int PREFETCHED_EVENTS = 0;
+
+/*
+ * Size of the TTreeCache of every reader in bytes, -1 for ROOT's default (--cache-size=MB), and the
+ * number of entries to learn the branches to be cached, 0 for ROOT's default
+ * (--cache-learn-entries=N)
+ */
+Long64_t TREE_CACHE_SIZE = -1;
+int TREE_CACHE_LEARN_ENTRIES = 0;
+
+/*
+ * Sharded processing (set via --shard i/N): only the runs with SHARD_INDEX == index % NUMBER_OF_SHARDS
+ * (index of the run in the whole campaign, see processShard) are processed and written as partial
+ * files. NUMBER_OF_SHARDS is 0 if sharding is disabled
+ */
+unsigned int SHARD_INDEX = 0;
+unsigned int NUMBER_OF_SHARDS = 0;
+
+/*
+ * Merge stage (set via the argument "merge"): the combined results are created from the partial
+ * files written by the shards instead of processing the runs
+ */
+bool MERGE_PARTIAL_FILES_ONLY = false;
+
+/*
+ * Time spent per stage of all runs written by this process and of the combined plots (only
+ * collected if compiled with MM_ENABLE_TIMING, see StageTimer.h)
+ */
+StageTimes campaignStageTimes;
+
+/*
+ * Events, bytes read and time per stage of all runs processed by this process, written as JSON to
+ * BENCHMARK_FILE if set (--benchmark=FILE)
+ */
+CampaignBenchmark campaignBenchmark;
+std::string BENCHMARK_FILE;
+
+/*
+ * Number of runs that could not be processed or merged
+ */
+int numberOfFailedRuns = 0;
+
+/*
+ * All runs of the campaign, read from runListFile or the file given via --runs=FILE
+ */
+RunCatalogue runCatalogue;
+std::string RUN_LIST_FILE = runListFile;
+
+/*
+ * Directory containing the files run<number>.root, set via --input-path=DIR (e.g. for the files
+ * written by RawEventGenerator)
+ */
+std::string INPUT_PATH = inPath;
+
+CombinedHistograms2D general_mapCombined;		//combined Plots
+CombinedHistograms1D general_mapCombined1D;
+
+map<string, TH2F*> global_mapCombined2D;
+
+/*
+ * Cut statistics of all runs of the current drift gap (the per-run statistics of the
+ * AnalysisContexts are merged into these)
+ */
 CutStatistic nocut_EventsWithSmallCharge("nocut_smallChargeEvents");
 CutStatistic nocut_xtimeCutLargeYTimeEvents("nocut_xtimeCutLargeYTimeEvents");
 
@@ -116,381 +222,426 @@ bool storeHistogram(int eventNumber, int totalStores) {
 					&& MAX_NUM_OF_EVENTS_TO_BE_PROCESSED <= totalStores);
 }
 
-// analysis of single event: characteristics of event and Gaussian fit
-bool analyseMMEvent(MMQuickEvent *event, int eventNumber, int TRGBURST) {
-
-// declaration of helping variables to more easily access event data
-	vector<unsigned int> apvIDofStrip = *event->apv_id; // MMQuickEvent::isX(apvIDofStrip[i]) returns true if the i-th strip is X-layer
-	vector<unsigned int> stripNumShowingSignal = *event->mm_strip; // stripNumShowingSignal[i] is absolute strip number (strips without charge are not stored anywhere)
-	vector<vector<short> > chargeOfStripOfTime = *event->apv_q; // chargeOfStripOfTime[i][j] is the charge of strip i in time section j (matrix of whole event)
-	vector<short> maxChargeOfStrip = *event->apv_qmax; // maxChargeOfStrip[i] is the maxmimal measured charge of strip i of all time sections
-	vector<short> timeSliceOfMaxChargeOfStrip = *event->apv_tbqmax; // timeSliceOfMaxChargeOfStrip[i] is the time section of the corresponding maximum charge (see above)
+/**
+ * State of the event analysed by analyseMMEvent, passed to the stages of the cut flow
+ */
+struct AnalysedEvent {
+	AnalysisContext& context;
+	MMQuickEvent* event;
+	const MMEventView& view;
+	int eventNumber;
 
 	/*
-	 * 2. Find maximum charge
+	 * Set by the fit stages
 	 */
-	event->findMaxCharge();
+	int startFitRangeX;
+	int endFitRangeX;
+	int startFitRangeY;
+	int endFitRangeY;
+	HitFitResult gaussFitX;
+	HitFitResult gaussFitY;
+
+	AnalysedEvent(AnalysisContext& _context, MMQuickEvent* _event,
+			const MMEventView& _view, int _eventNumber) :
+			context(_context), event(_event), view(_view), eventNumber(
+					_eventNumber), startFitRangeX(0), endFitRangeX(0), startFitRangeY(
+					0), endFitRangeY(0) {
+	}
+};
 
-	general_mapHist1D["mmchargexUncut"]->Fill(event->maxChargeX);
-	general_mapHist1D["mmchargeyUncut"]->Fill(event->maxChargeY);
+/*
+ * Fits the hit of the X or Y cross section of <e> (fit problem cut)
+ */
+static bool fitHit(AnalysedEvent& e, bool isX) {
+	MM_TIME_STAGE(HIT_FIT);
+	ScopedPerfRegion perfRegion(PerfRegion::HIT_FIT);
+	MMQuickEvent* event = e.event;
+	const int stripWithMaxCharge =
+			isX ? event->stripWithMaxChargeX : event->stripWithMaxChargeY;
 
-	general_mapCombined1D["chargexAllEventsUncut"]->Fill(event->maxChargeX);
-	general_mapCombined1D["chargeyAllEventsUncut"]->Fill(event->maxChargeY);
+	/*
+	 * The start of the range must not be negative (it is used as unsigned strip number)
+	 */
+	int startFitRange = e.view.mm_strip[stripWithMaxCharge] - FIT_RANGE / 2;
+	startFitRange = startFitRange > 0 ? startFitRange : 0;
+	const int endFitRange = e.view.mm_strip[stripWithMaxCharge] + FIT_RANGE / 2;
+
+	(isX ? e.startFitRangeX : e.startFitRangeY) = startFitRange;
+	(isX ? e.endFitRangeX : e.endFitRangeY) = endFitRange;
+	return e.context.hitEstimator->estimate(
+			isX ? event->stripAndChargeAtMaxChargeTimeX :
+					event->stripAndChargeAtMaxChargeTimeY, e.eventNumber,
+			startFitRange, endFitRange, isX ? e.gaussFitX : e.gaussFitY);
+}
 
-	general_mapCombined1D["timeDistributionUncutX"]->Fill(
-			event->timeSliceOfMaxChargeX);
-	general_mapCombined1D["timeDistributionUncutY"]->Fill(
-			event->timeSliceOfMaxChargeY);
+/*
+ * Checks if the fit mean is close enough to the maximum (fit mean distance cut)
+ */
+static bool isFitMeanCloseToMaximum(AnalysedEvent& e, bool isX) {
+	const int stripWithMaxCharge =
+			isX ? e.event->stripWithMaxChargeX : e.event->stripWithMaxChargeY;
+	const double mean = isX ? e.gaussFitX.mean : e.gaussFitY.mean;
+	return !(abs(e.view.mm_strip[stripWithMaxCharge] - mean)
+			> MAX_FIT_MEAN_DISTANCE_TO_MAX);
+}
 
-	if (event->stripWithMaxChargeX != -1 && event->stripWithMaxChargeY != -1
-			&& storeHistogram(eventNumber, 10000)) {
-		event->generateTimeShape(general_mapCombined["timeShapeXUncut"],
-				event->maxChargeX, event->stripWithMaxChargeX,
-				event->timeSliceOfMaxChargeX);
-		event->generateTimeShape(general_mapCombined["timeShapeYUncut"],
-				event->maxChargeY, event->stripWithMaxChargeY,
-				event->timeSliceOfMaxChargeY);
-	}
+/**
+ * The cuts of analyseMMEvent in the order they are applied. The bookkeeping of each stage fills the
+ * cut statistics and the histograms of the events that passed the previous cuts exactly as the
+ * cut statistics table expects it.
+ */
+static CutFlow<AnalysedEvent> createCutFlow() {
+	CutFlow<AnalysedEvent> flow;
 
 	// Timing cut
-	if (event->timeSliceOfMaxChargeX < MIN_TIMESLICE
-			|| event->timeSliceOfMaxChargeX > MAX_TIMESLICE) {
-		timingCuts.Fill(1, event);
-		if (event->timeSliceOfMaxChargeX != -1
-				&& event->timeSliceOfMaxChargeY > 0
-				&& event->timeSliceOfMaxChargeY < 7) {
-			nocut_xtimeCutLargeYTimeEvents.Fill(0, event);
+	flow.addStage("timingX", CutCost::CHEAP, [](AnalysedEvent& e) {
+		return !(e.event->timeSliceOfMaxChargeX < MIN_TIMESLICE
+				|| e.event->timeSliceOfMaxChargeX > MAX_TIMESLICE);
+	}, [](AnalysedEvent& e) {
+		MM_TIME_STAGE(HISTOGRAM_FILLS);
+		e.context.mapCombined1D[CombinedHist1D::timeDistributionYAfterTimeXCut]->Fill(
+				e.event->timeSliceOfMaxChargeY);
+	}, [](AnalysedEvent& e) {
+		e.context.timingCuts.Fill(1, e.event);
+		if (e.event->timeSliceOfMaxChargeX != -1
+				&& e.event->timeSliceOfMaxChargeY > 0
+				&& e.event->timeSliceOfMaxChargeY < 7) {
+			e.context.nocut_xtimeCutLargeYTimeEvents.Fill(0, e.event);
 		}
-		return false;
-	}
-
-	general_mapCombined1D["timeDistributionYAfterTimeXCut"]->Fill(
-			event->timeSliceOfMaxChargeY);
-
-	if (event->timeSliceOfMaxChargeY < MIN_TIMESLICE
-			|| event->timeSliceOfMaxChargeY > MAX_TIMESLICE) {
-		timingCuts.Fill(1, event);
-		return false;
-	} else {
-		timingCuts.Fill(0, event);
-	}
-
-	general_mapCombined1D["timeDistributionXAfterTimeCut"]->Fill(
-			event->timeSliceOfMaxChargeX);
-	general_mapCombined1D["timeDistributionYAfterTimeCut"]->Fill(
-			event->timeSliceOfMaxChargeY);
+	});
+
+	flow.addStage("timingY", CutCost::CHEAP, [](AnalysedEvent& e) {
+		return !(e.event->timeSliceOfMaxChargeY < MIN_TIMESLICE
+				|| e.event->timeSliceOfMaxChargeY > MAX_TIMESLICE);
+	}, [](AnalysedEvent& e) {
+		MM_TIME_STAGE(HISTOGRAM_FILLS);
+		AnalysisContext& context = e.context;
+		MMQuickEvent* event = e.event;
+		context.timingCuts.Fill(0, event);
+
+		context.mapCombined1D[CombinedHist1D::timeDistributionXAfterTimeCut]->Fill(
+				event->timeSliceOfMaxChargeX);
+		context.mapCombined1D[CombinedHist1D::timeDistributionYAfterTimeCut]->Fill(
+				event->timeSliceOfMaxChargeY);
 
-	general_mapCombined1D["chargexAllEventsAfterTimingCut"]->Fill(
-			event->maxChargeX);
-	general_mapCombined1D["chargeyAllEventsAfterTimingCut"]->Fill(
-			event->maxChargeY);
+		context.mapCombined1D[CombinedHist1D::chargexAllEventsAfterTimingCut]->Fill(
+				event->maxChargeX);
+		context.mapCombined1D[CombinedHist1D::chargeyAllEventsAfterTimingCut]->Fill(
+				event->maxChargeY);
 
-	if (event->timeSliceOfMaxChargeX != -1
-			&& event->timeSliceOfMaxChargeY != -1) {
-		general_mapCombined1D["timeCoincidence"]->Fill(
-				event->timeSliceOfMaxChargeX - event->timeSliceOfMaxChargeY);
-	}
+		if (event->timeSliceOfMaxChargeX != -1
+				&& event->timeSliceOfMaxChargeY != -1) {
+			context.mapCombined1D[CombinedHist1D::timeCoincidence]->Fill(
+					event->timeSliceOfMaxChargeX - event->timeSliceOfMaxChargeY);
+		}
+	}, [](AnalysedEvent& e) {
+		e.context.timingCuts.Fill(1, e.event);
+	});
 
 	// coincidence cut
-	if (event->timeSliceOfMaxChargeX
-			- event->timeSliceOfMaxChargeY> MAX_XY_TIME_DIFFERENCE ||
-			event->timeSliceOfMaxChargeX - event->timeSliceOfMaxChargeY
-			< MIN_XY_TIME_DIFFERENCE) {
-
-		if (event->maxChargeX < MIN_CHARGE_X || event->maxChargeY < MIN_CHARGE_Y) {
-			nocut_EventsWithSmallCharge.Fill(0, event);
+	flow.addStage("timeCoincidence", CutCost::CHEAP, [](AnalysedEvent& e) {
+		const int timeDifference = e.event->timeSliceOfMaxChargeX
+				- e.event->timeSliceOfMaxChargeY;
+		return !(timeDifference > MAX_XY_TIME_DIFFERENCE
+				|| timeDifference < MIN_XY_TIME_DIFFERENCE);
+	}, [](AnalysedEvent& e) {
+		MM_TIME_STAGE(HISTOGRAM_FILLS);
+		e.context.timeCoincidenceCuts.Fill(0, e.event);
+		e.context.mapCombined1D[CombinedHist1D::chargexAllEventsAfterCoincidenceCut]->Fill(
+				e.event->maxChargeX);
+		e.context.mapCombined1D[CombinedHist1D::chargeyAllEventsAfterCoincidenceCut]->Fill(
+				e.event->maxChargeY);
+	}, [](AnalysedEvent& e) {
+		if (e.event->maxChargeX < MIN_CHARGE_X
+				|| e.event->maxChargeY < MIN_CHARGE_Y) {
+			e.context.nocut_EventsWithSmallCharge.Fill(0, e.event);
 		}
-
-		timeCoincidenceCuts.Fill(1, event);
-		return false;
-	} else {
-		timeCoincidenceCuts.Fill(0, event);
-	}
-	general_mapCombined1D["chargexAllEventsAfterCoincidenceCut"]->Fill(
-			event->maxChargeX);
-	general_mapCombined1D["chargeyAllEventsAfterCoincidenceCut"]->Fill(
-			event->maxChargeY);
+		e.context.timeCoincidenceCuts.Fill(1, e.event);
+	});
 
 	// Charge cut
-	if (event->maxChargeX < MIN_CHARGE_X || event->maxChargeY < MIN_CHARGE_Y) {
-		chargeCuts.Fill(1, event);
-		return false;
-	} else {
-		chargeCuts.Fill(0, event);
-	}
+	flow.addStage("charge", CutCost::CHEAP, [](AnalysedEvent& e) {
+		return !(e.event->maxChargeX < MIN_CHARGE_X
+				|| e.event->maxChargeY < MIN_CHARGE_Y);
+	}, [](AnalysedEvent& e) {
+		e.context.chargeCuts.Fill(0, e.event);
+	}, [](AnalysedEvent& e) {
+		e.context.chargeCuts.Fill(1, e.event);
+	});
 
 	/*
-	 * Calculate cluster sizes
+	 * Proportion cuts on the charge distribution over the strips at the time slice with maximum
+	 * charge (runProportionCut fills the absolute position and proportion cut statistics itself)
 	 */
-//	event->generateFixedTimeCrossSections();
-//
-//	int clusterSizeX = event->calculateClusterSize(
-//			event->stripAndChargeAtMaxChargeTimeX,
-//			event->positionOfMaxChargeInCrossSectionX);
-//
-//	int clusterSizeY = event->calculateClusterSize(
-//			event->stripAndChargeAtMaxChargeTimeY,
-//			event->positionOfMaxChargeInCrossSectionY);
-//
-//	general_mapHist1D["mmclusterxUncut"]->Fill(clusterSizeX);
-//	general_mapHist1D["mmclusteryUncut"]->Fill(clusterSizeY);
-//
-//	general_mapCombined1D["clusterxUncut"]->Fill(clusterSizeX);
-//	general_mapCombined1D["clusteryUncut"]->Fill(clusterSizeY);
-//
-//	// Cluster cut
-//	if (clusterSizeX < MIN_CLUSTER_X || clusterSizeY < MIN_CLUSTER_Y
-//			|| clusterSizeX > MAX_CLUSTER_X || clusterSizeY > MAX_CLUSTER_Y) {
-//		std::stringstream suffix;
-//		suffix << clusterSizeX << "-" << clusterSizeY;
-//		clusterCuts.Fill(1, event, suffix.str());
-//		return false;
-//	} else {
-//		clusterCuts.Fill(0, event);
-//	}
+	flow.addStage("proportion", CutCost::EXPENSIVE, [](AnalysedEvent& e) {
+		AnalysisContext& context = e.context;
+		MMQuickEvent* event = e.event;
+		{
+			MM_TIME_STAGE(CROSS_SECTIONS);
+			event->generateFixedTimeCrossSections();
+		}
+		MM_TIME_STAGE(PROPORTION_CUT);
+		ScopedPerfRegion perfRegion(PerfRegion::PROPORTION_CUT);
+
+		bool acceptEventX = event->runProportionCut(
+				context.mapCombined[CombinedHist2D::mmhitneighboursX],
+				event->stripAndChargeAtMaxChargeTimeX, event->maxChargeX,
+				MapFile::getProportionLimitsOfMaxHitNeighboursX(),
+				context.absolutePositionXCuts, context.proportionXCuts, false,
+				event->positionOfMaxChargeInCrossSectionX);
+
+		bool acceptEventY = event->runProportionCut(
+				context.mapCombined[CombinedHist2D::mmhitneighboursY],
+				event->stripAndChargeAtMaxChargeTimeY, event->maxChargeY,
+				MapFile::getProportionLimitsOfMaxHitNeighboursY(),
+				context.absolutePositionYCuts,
+				context.proportionYCuts, !acceptEventX,
+				event->positionOfMaxChargeInCrossSectionY);
+
+		return acceptEventX && acceptEventY;
+	});
+
 	/*
 	 * 4. Gaussian fits to charge distribution over strips at timestep with maximum charge
 	 */
+	// fit problem cut
+	flow.addStage("fitX", CutCost::EXPENSIVE, [](AnalysedEvent& e) {
+		return fitHit(e, true);
+	}, CutFlow<AnalysedEvent>::Action(), [](AnalysedEvent& e) {
+		e.context.fitProblemCuts.Fill(1, e.event);
+	});
 
-	event->generateFixedTimeCrossSections();
-	// Proportion cuts
-	bool acceptEventX = event->runProportionCut(
-			general_mapCombined["mmhitneighboursX"],
-			event->stripAndChargeAtMaxChargeTimeX, event->maxChargeX,
-			MapFile::getProportionLimitsOfMaxHitNeighboursX(),
-			absolutePositionXCuts, proportionXCuts, false,
-			event->positionOfMaxChargeInCrossSectionX);
-
-	bool acceptEventY = event->runProportionCut(
-			general_mapCombined["mmhitneighboursY"],
-			event->stripAndChargeAtMaxChargeTimeY, event->maxChargeY,
-			MapFile::getProportionLimitsOfMaxHitNeighboursY(),
-			absolutePositionYCuts, proportionYCuts, !acceptEventX,
-			event->positionOfMaxChargeInCrossSectionY);
-
-	if (!acceptEventX || !acceptEventY) {
-		return false;
-	}
+	// fit mean distance cut
+	flow.addStage("fitMeanX", CutCost::CHEAP, [](AnalysedEvent& e) {
+		return isFitMeanCloseToMaximum(e, true);
+	}, CutFlow<AnalysedEvent>::Action(), [](AnalysedEvent& e) {
+		e.context.fitProblemCuts.Fill(0, e.event);
+		e.context.fitMeanMaxChargeDistanceCuts.Fill(1, e.event);
+	});
+
+	flow.addStage("fitY", CutCost::EXPENSIVE, [](AnalysedEvent& e) {
+		return fitHit(e, false);
+	}, [](AnalysedEvent& e) {
+		e.context.fitProblemCuts.Fill(0, e.event);
+	}, [](AnalysedEvent& e) {
+		e.context.fitProblemCuts.Fill(1, e.event);
+	});
+
+	flow.addStage("fitMeanY", CutCost::CHEAP, [](AnalysedEvent& e) {
+		return isFitMeanCloseToMaximum(e, false);
+	}, [](AnalysedEvent& e) {
+		e.context.fitMeanMaxChargeDistanceCuts.Fill(0, e.event);
+	}, [](AnalysedEvent& e) {
+		e.context.fitMeanMaxChargeDistanceCuts.Fill(1, e.event);
+	});
+
+	return flow;
+}
 
-	/*
-	 * Fit hits
-	 */
-	TF1* gaussFitX = NULL;
-	TF1* gaussFitY = NULL;
-	TH1F* fitHistoX = NULL;
-	TH1F* fitHistoY = NULL;
-
-	int startFitRange = stripNumShowingSignal[event->stripWithMaxChargeX]
-			- FIT_RANGE / 2;
-	gaussFitX = fitGauss(event->stripAndChargeAtMaxChargeTimeX, eventNumber,
-			"maxChargeCrossSectionX", fitHistoX,
-			startFitRange > 0 ? startFitRange : 0,
-			stripNumShowingSignal[event->stripWithMaxChargeX] + FIT_RANGE / 2);
+/*
+ * The stages are shared by all threads, the statistics are collected per AnalysisContext
+ */
+const CutFlow<AnalysedEvent> cutFlow = createCutFlow();
+
+// analysis of single event: characteristics of event and Gaussian fit
+bool analyseMMEvent(AnalysisContext& context, MMQuickEvent *event,
+		const MMEventView& view, int eventNumber, int TRGBURST) {
+
+// helping variable to more easily access event data (points into the branch buffers, no copy)
+	const ConstSpan<unsigned int>& stripNumShowingSignal = view.mm_strip; // stripNumShowingSignal[i] is absolute strip number (strips without charge are not stored anywhere)
 
-	// fit problem cut
-	if (gaussFitX == NULL) {
-		fitProblemCuts.Fill(1, event);
-		delete fitHistoX;
-		return false;
-	}
 	/*
-	 * Check if the fit mean is close enough to the maximum
+	 * 2. Find maximum charge
 	 */
-	// fit mean distance cut
-	double mean = gaussFitX->GetParameter(1);
-	if (abs(
-			stripNumShowingSignal[event->stripWithMaxChargeX]
-					- mean) > MAX_FIT_MEAN_DISTANCE_TO_MAX) {
-		delete fitHistoX;
-		fitProblemCuts.Fill(0, event);
-		fitMeanMaxChargeDistanceCuts.Fill(1, event);
-		return false;
+	{
+		MM_TIME_STAGE(FIND_MAX_CHARGE);
+		ScopedPerfRegion perfRegion(PerfRegion::FIND_MAX_CHARGE);
+		event->findMaxCharge(view);
 	}
 
-	gaussFitY = fitGauss(event->stripAndChargeAtMaxChargeTimeY, eventNumber,
-			"maxChargeCrossSectionY", fitHistoY,
-			stripNumShowingSignal[event->stripWithMaxChargeY] - FIT_RANGE / 2,
-			stripNumShowingSignal[event->stripWithMaxChargeY] + FIT_RANGE / 2);
+	{
+		MM_TIME_STAGE(HISTOGRAM_FILLS);
+		context.mapHist1D[RunHist1D::mmchargexUncut]->Fill(event->maxChargeX);
+		context.mapHist1D[RunHist1D::mmchargeyUncut]->Fill(event->maxChargeY);
 
-	if (gaussFitY == NULL) {
-		fitProblemCuts.Fill(1, event);
-		delete fitHistoX;
-		delete fitHistoY;
-		return false;
-	} else {
-		fitProblemCuts.Fill(0, event);
+		context.mapCombined1D[CombinedHist1D::chargexAllEventsUncut]->Fill(event->maxChargeX);
+		context.mapCombined1D[CombinedHist1D::chargeyAllEventsUncut]->Fill(event->maxChargeY);
+
+		context.mapCombined1D[CombinedHist1D::timeDistributionUncutX]->Fill(
+				event->timeSliceOfMaxChargeX);
+		context.mapCombined1D[CombinedHist1D::timeDistributionUncutY]->Fill(
+				event->timeSliceOfMaxChargeY);
+
+		if (event->stripWithMaxChargeX != -1 && event->stripWithMaxChargeY != -1
+				&& storeHistogram(eventNumber, 10000)) {
+			event->generateTimeShape(context.mapCombined[CombinedHist2D::timeShapeXUncut],
+					event->maxChargeX, event->stripWithMaxChargeX,
+					event->timeSliceOfMaxChargeX);
+			event->generateTimeShape(context.mapCombined[CombinedHist2D::timeShapeYUncut],
+					event->maxChargeY, event->stripWithMaxChargeY,
+					event->timeSliceOfMaxChargeY);
+		}
 	}
 
 	/*
-	 * Check if the fit mean is close enough to the maximum
+	 * 3. Cuts (see createCutFlow)
 	 */
-	mean = gaussFitY->GetParameter(1);
-	if (abs(
-			stripNumShowingSignal[event->stripWithMaxChargeY]
-					- mean) > MAX_FIT_MEAN_DISTANCE_TO_MAX) {
-		delete fitHistoX;
-		delete fitHistoY;
-		fitMeanMaxChargeDistanceCuts.Fill(1, event);
+	AnalysedEvent analysedEvent(context, event, view, eventNumber);
+	if (!cutFlow.run(analysedEvent, context.cutFlowStatistics)) {
 		return false;
-	} else {
-		fitMeanMaxChargeDistanceCuts.Fill(0, event);
 	}
+	const HitFitResult& gaussFitX = analysedEvent.gaussFitX;
+	const HitFitResult& gaussFitY = analysedEvent.gaussFitY;
+	const int startFitRangeX = analysedEvent.startFitRangeX;
+	const int endFitRangeX = analysedEvent.endFitRangeX;
+	const int startFitRangeY = analysedEvent.startFitRangeY;
+	const int endFitRangeY = analysedEvent.endFitRangeY;
 
 	/*
 	 * ############################################################
 	 * #################### ALL CUTS DONE HERE ####################
 	 * ############################################################
 	 */
-	event->generateTimeShape(general_mapCombined["timeShapeX"],
+	MM_TIME_STAGE(HISTOGRAM_FILLS); // everything left is filled into histograms
+	event->generateTimeShape(context.mapCombined[CombinedHist2D::timeShapeX],
 			event->maxChargeX, event->stripWithMaxChargeX,
 			event->timeSliceOfMaxChargeX);
-	event->generateTimeShape(general_mapCombined["timeShapeY"],
+	event->generateTimeShape(context.mapCombined[CombinedHist2D::timeShapeY],
 			event->maxChargeY, event->stripWithMaxChargeY,
 			event->timeSliceOfMaxChargeY);
 
-	general_mapCombined1D["timeDistributionX"]->Fill(
+	context.mapCombined1D[CombinedHist1D::timeDistributionX]->Fill(
 			event->timeSliceOfMaxChargeX);
-	general_mapCombined1D["timeDistributionY"]->Fill(
+	context.mapCombined1D[CombinedHist1D::timeDistributionY]->Fill(
 			event->timeSliceOfMaxChargeY);
 
 //storage after procession
 //Fill trees	(replace 1)
-	gauss.gaussXmean = gaussFitX->GetParameter(1);
-	gauss.gaussXmeanError = gaussFitX->GetParError(1);
-	gauss.gaussXsigma = gaussFitX->GetParameter(2);
-	gauss.gaussXcharge = gaussFitX->GetParameter(0);
-	gauss.gaussXchi = gaussFitX->GetChisquare();
-	gauss.gaussXdof = gaussFitX->GetNDF();
-	gauss.gaussXchiRed = gaussFitX->GetChisquare() / gaussFitX->GetNDF();
-	gauss.gaussYmean = gaussFitY->GetParameter(1);
-	gauss.gaussYmeanError = gaussFitY->GetParError(1);
-	gauss.gaussYsigma = gaussFitY->GetParameter(2);
-	gauss.gaussYcharge = gaussFitY->GetParameter(0);
-	gauss.gaussYchi = gaussFitY->GetChisquare();
-	gauss.gaussYdof = gaussFitY->GetNDF();
-	gauss.gaussYchiRed = gaussFitY->GetChisquare() / gaussFitY->GetNDF();
-	gauss.number = eventNumber;
-
-	general_mapHist1D["mmhitWidthX"]->Fill(gauss.gaussXsigma);
-	general_mapHist1D["mmhitWidthY"]->Fill(gauss.gaussYsigma);
+	context.gauss.gaussXmean = gaussFitX.mean;
+	context.gauss.gaussXmeanError = gaussFitX.meanError;
+	context.gauss.gaussXsigma = gaussFitX.sigma;
+	context.gauss.gaussXcharge = gaussFitX.amplitude;
+	context.gauss.gaussXchi = gaussFitX.chi2;
+	context.gauss.gaussXdof = gaussFitX.ndf;
+	context.gauss.gaussXchiRed = gaussFitX.chi2 / gaussFitX.ndf;
+	context.gauss.gaussYmean = gaussFitY.mean;
+	context.gauss.gaussYmeanError = gaussFitY.meanError;
+	context.gauss.gaussYsigma = gaussFitY.sigma;
+	context.gauss.gaussYcharge = gaussFitY.amplitude;
+	context.gauss.gaussYchi = gaussFitY.chi2;
+	context.gauss.gaussYdof = gaussFitY.ndf;
+	context.gauss.gaussYchiRed = gaussFitY.chi2 / gaussFitY.ndf;
+	context.gauss.number = eventNumber;
+
+	context.mapHist1D[RunHist1D::mmhitWidthX]->Fill(context.gauss.gaussXsigma);
+	context.mapHist1D[RunHist1D::mmhitWidthY]->Fill(context.gauss.gaussYsigma);
 
 	/*
 	 * ???
 	 * Was ist hier zu tun?
 	 */
-	maxi.maxXmean = event->maxChargeX;
-	maxi.maxYmean = event->maxChargeY;
-	maxi.maxXcharge = 1;
-	maxi.maxYcharge = 1;
-	maxi.maxXcluster = 1;
-	maxi.maxYcluster = 1;
-	maxi.number = eventNumber;
-
-	general_mapTree["fits"]->Fill();
+	context.maxi.maxXmean = event->maxChargeX;
+	context.maxi.maxYmean = event->maxChargeY;
+	context.maxi.maxXcharge = 1;
+	context.maxi.maxYcharge = 1;
+	context.maxi.maxXcluster = 1;
+	context.maxi.maxYcluster = 1;
+	context.maxi.number = eventNumber;
+
+	{
+		MM_TIME_STAGE(TREE_FILLS);
+		context.fitResults.push_back(std::make_pair(context.gauss, context.maxi));
+	}
 
 	if (storeHistogram(eventNumber, 5)) {
-		general_mapPlotFit[std::string(fitHistoX->GetName())] = fitHistoX;
-		general_mapPlotFit[std::string(fitHistoY->GetName())] = fitHistoY;
-
-		std::stringstream namePrefix;
-		namePrefix << "DG" << MapFile::driftGap << "-";
-		writeToPdf<TH1F>(fitHistoX, "HitWidthFits", "", namePrefix.str());
-		writeToPdf<TH1F>(fitHistoY, "HitWidthFits", "", namePrefix.str());
-	} else {
-		delete fitHistoY;
-		delete fitHistoX;
+		// The histograms are only generated for the few fits that are plotted
+		TH1F* fitHistoX = generateCrossSectionHistogram(
+				event->stripAndChargeAtMaxChargeTimeX, eventNumber,
+				"maxChargeCrossSectionX", startFitRangeX, endFitRangeX,
+				gaussFitX);
+		TH1F* fitHistoY = generateCrossSectionHistogram(
+				event->stripAndChargeAtMaxChargeTimeY, eventNumber,
+				"maxChargeCrossSectionY", startFitRangeY, endFitRangeY,
+				gaussFitY);
+		context.mapPlotFit[std::string(fitHistoX->GetName())] = fitHistoX;
+		context.mapPlotFit[std::string(fitHistoY->GetName())] = fitHistoY;
 	}
 
-	general_mapHist2D["mmhitmap"]->Fill(
+	context.mapHist2D[RunHist2D::mmhitmap]->Fill(
 			/*strip with maximum charge in X*/stripNumShowingSignal[event->stripWithMaxChargeX],
 			/*strip with maximum charge in Y*/stripNumShowingSignal[event->stripWithMaxChargeY]);
 
-	general_mapCombined1D["chargexAllEvents"]->Fill(event->maxChargeX);
-	general_mapCombined1D["chargeyAllEvents"]->Fill(event->maxChargeY);
+	context.mapCombined1D[CombinedHist1D::chargexAllEvents]->Fill(event->maxChargeX);
+	context.mapCombined1D[CombinedHist1D::chargeyAllEvents]->Fill(event->maxChargeY);
 
-	general_mapHist1D["mmchargex"]->Fill(
+	context.mapHist1D[RunHist1D::mmchargex]->Fill(
 	/*maximum charge x*/event->maxChargeX);
-	general_mapHist1D["mmchargey"]->Fill(
+	context.mapHist1D[RunHist1D::mmchargey]->Fill(
 	/*maximum charge y*/event->maxChargeY);
-	general_mapHist1D["mmhitx"]->Fill(
+	context.mapHist1D[RunHist1D::mmhitx]->Fill(
 			/*strip x with maximum charge*/stripNumShowingSignal[event->stripWithMaxChargeX]);
-	general_mapHist1D["mmhity"]->Fill(
+	context.mapHist1D[RunHist1D::mmhity]->Fill(
 			/*strip y with maximum charge*/stripNumShowingSignal[event->stripWithMaxChargeY]);
 
-//	general_mapHist1D["mmclusterx"]->Fill(clusterSizeX);
-//	general_mapHist1D["mmclustery"]->Fill(clusterSizeY);
+//	context.mapHist1D[RunHist1D::mmclusterx]->Fill(clusterSizeX);
+//	context.mapHist1D[RunHist1D::mmclustery]->Fill(clusterSizeY);
 //
-//	general_mapCombined1D["clusterx"]->Fill(clusterSizeX);
-//	general_mapCombined1D["clustery"]->Fill(clusterSizeY);
+//	context.mapCombined1D[CombinedHist1D::clusterx]->Fill(clusterSizeX);
+//	context.mapCombined1D[CombinedHist1D::clustery]->Fill(clusterSizeY);
 
-	general_mapHist1D["mmtimex"]->Fill(
+	context.mapHist1D[RunHist1D::mmtimex]->Fill(
 	/*time of maximum charge x*/event->timeSliceOfMaxChargeX * 25);
-	general_mapHist1D["mmtimey"]->Fill(
+	context.mapHist1D[RunHist1D::mmtimey]->Fill(
 	/*time of maximum charge y*/event->timeSliceOfMaxChargeY * 25);
 
-	eventTimes.push_back(
-			(double) event->time_s + (double) event->time_us / 1e6);
+	context.eventTimes.push_back(
+			(double) view.time_s + (double) view.time_us / 1e6);
 	return true;
 }
 
-// Main Program
-void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
-		std::vector<double>& averageHitwidthsY,
-		std::vector<double>& averageHitwidthsXError,
-		std::vector<double>& averageHitwidthsYError,
-		std::map<double/*ED*/,
-				std::map<int/*VA*/,
-						std::map<double/*DG*/,
-								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgX,
-		std::map<double/*ED*/,
-				std::map<int/*VA*/,
-						std::map<double/*DG*/,
-								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgY) {
-
-	for (auto& cutStat : CutStatistic::instances) {
-		cutStat->reset();
-	}
-
-// map files to read different run of data in a row
-// get data file name from MapFile.h
-	map<string, TFile*> mapFile = MicroMegas.getFile();
-
-//TRGBURST gives number of recorded timesteps (variable from data aquisition)
-//timesteps = (TRGBURST+1)*3
-	const int TRGBURST = 8;
+/**
+ * Data for graphs to plot the fit width vs the value of VD for every run
+ */
+struct HitWidthGraphData {
+	std::vector<double> VDsForGraphsX;
+	std::vector<double> VAsForGraphsX;
+	std::vector<double> hitWidthsX;
+	std::vector<double> hitWidthsXErrors;
+	std::vector<double> VDsForGraphsY;
+	std::vector<double> VAsForGraphsY;
+	std::vector<double> hitWidthsY;
+	std::vector<double> hitWidthsYErrors;
+};
 
-//initialize file and histograms for combined output of all runs
+/**
+ * Initializes the histograms combining all runs of the drift gap of MicroMegas
+ */
+void bookCombinedHistograms(MapFile& MicroMegas) {
 	int numberOfXBins = (MicroMegas.driftEnd - MicroMegas.driftStart)
 			/ MicroMegas.driftSteps + 1;
 	double firstXBinValue = MicroMegas.driftStart - 0.5 * MicroMegas.driftSteps;
 	double lastXBinValue = MicroMegas.driftEnd + 0.5 * MicroMegas.driftSteps;
 
-	std::stringstream combinedFileName;
-	combinedFileName << outPath << MicroMegas.getDriftGap()
-			<< combinedPlotsFile;
-
-	TFile* fileCombined = new TFile(combinedFileName.str().c_str(),
-			(Option_t*) "RECREATE");
-	general_mapCombined["rate"] = new TH2F("rate",
+	general_mapCombined[CombinedHist2D::rate] = new TH2F("rate",
 			";VDrift [V];VAmp [V];rate [Hz]", numberOfXBins, firstXBinValue,
 			lastXBinValue,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
-	general_mapCombined["chargeX"] = new TH2F("chargeX",
+	general_mapCombined[CombinedHist2D::chargeX] = new TH2F("chargeX",
 			";VDrift [V];VAmp [V];Charge", numberOfXBins, firstXBinValue,
 			lastXBinValue,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
-	general_mapCombined["chargeY"] = new TH2F("chargeY",
+	general_mapCombined[CombinedHist2D::chargeY] = new TH2F("chargeY",
 			";VDrift [V];VAmp [V];Charge", numberOfXBins, firstXBinValue,
 			lastXBinValue,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
 
-	general_mapCombined["chargeXfieldStrength"] = new TH2F(
+	general_mapCombined[CombinedHist2D::chargeXfieldStrength] = new TH2F(
 			"chargeXfieldStrength",
 			";drift field strength [kV/m] ;VAmp [V];charge", numberOfXBins,
 			firstXBinValue / MicroMegas.driftGap,
@@ -498,7 +649,7 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
-	general_mapCombined["chargeYfieldStrength"] = new TH2F(
+	general_mapCombined[CombinedHist2D::chargeYfieldStrength] = new TH2F(
 			"chargeYfieldStrength",
 			";drift field strength [kV/m] ;VAmp [V];charge", numberOfXBins,
 			firstXBinValue / MicroMegas.driftGap,
@@ -507,391 +658,1086 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
 
-	general_mapCombined["chargeXuncut"] = new TH2F("chargeXuncut",
+	general_mapCombined[CombinedHist2D::chargeXuncut] = new TH2F("chargeXuncut",
 			";VDrift [V] ;VAmp [V];charge", numberOfXBins, firstXBinValue,
 			lastXBinValue,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
-	general_mapCombined["chargeYuncut"] = new TH2F("chargeYuncut",
+	general_mapCombined[CombinedHist2D::chargeYuncut] = new TH2F("chargeYuncut",
 			";VDrift [V] ;VAmp [V];charge", numberOfXBins, firstXBinValue,
 			lastXBinValue,
 			(MicroMegas.ampEnd - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
 			MicroMegas.ampStart - 0.5 * MicroMegas.ampSteps,
 			MicroMegas.ampEnd + 0.5 * MicroMegas.ampSteps);
 
-	general_mapCombined["mmhitneighboursX"] = new TH2F("mmhitneighboursX",
+	general_mapCombined[CombinedHist2D::mmhitneighboursX] = new TH2F("mmhitneighboursX",
 			";distance [strips]; relative charge [% of max];count", 13, -6.5,
 			6.5, 20, 0, 100);
 
-	general_mapCombined["mmhitneighboursY"] = new TH2F("mmhitneighboursY",
+	general_mapCombined[CombinedHist2D::mmhitneighboursY] = new TH2F("mmhitneighboursY",
 			";distance [strips]; relative charge [% of max];count", 13, -6.5,
 			6.5, 20, 0, 100);
 
-	general_mapCombined["timeShapeX"] = new TH2F("timeShapeX",
+	general_mapCombined[CombinedHist2D::timeShapeX] = new TH2F("timeShapeX",
 			";time section [25 ns]; charge relative to maximum strip [%]",
 			2 * NUMBER_OF_TIME_SLICES + 1, -NUMBER_OF_TIME_SLICES - 0.5,
 			NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5, 100.5);
-	general_mapCombined["timeShapeY"] = new TH2F("timeShapeY",
+	general_mapCombined[CombinedHist2D::timeShapeY] = new TH2F("timeShapeY",
 			";time section [25 ns]; charge relative to maximum strip [%]",
 			2 * NUMBER_OF_TIME_SLICES + 1, -NUMBER_OF_TIME_SLICES - 0.5,
 			NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5, 100.5);
-	general_mapCombined["timeShapeXUncut"] = new TH2F("timeShapeXUncut",
+	general_mapCombined[CombinedHist2D::timeShapeXUncut] = new TH2F("timeShapeXUncut",
 			";time section [25 ns]; charge relative to maximum charge [%]",
 			2 * NUMBER_OF_TIME_SLICES + 1, -NUMBER_OF_TIME_SLICES - 0.5,
 			NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5, 100.5);
-	general_mapCombined["timeShapeYUncut"] = new TH2F("timeShapeYUncut",
+	general_mapCombined[CombinedHist2D::timeShapeYUncut] = new TH2F("timeShapeYUncut",
 			";time section [25 ns]; charge relative to maximum charge [%]",
 			2 * NUMBER_OF_TIME_SLICES + 1, -NUMBER_OF_TIME_SLICES - 0.5,
 			NUMBER_OF_TIME_SLICES + 0.5, 45, -34.5, 100.5);
 
-	general_mapCombined1D["chargexAllEvents"] = new TH1F("chargexAllEvents",
+	general_mapCombined1D[CombinedHist1D::chargexAllEvents] = new TH1F("chargexAllEvents",
 			";charge X; entries", 100, 0, 1000);
-	general_mapCombined1D["chargeyAllEvents"] = new TH1F("chargeyAllEvents",
+	general_mapCombined1D[CombinedHist1D::chargeyAllEvents] = new TH1F("chargeyAllEvents",
 			";charge Y; entries", 100, 0, 1000);
-	general_mapCombined1D["chargexAllEventsAfterTimingCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargexAllEventsAfterTimingCut] = new TH1F(
 			"chargexAllEventsAfterTimingCut", ";charge X; entries", 100, 0,
 			1000);
-	general_mapCombined1D["chargeyAllEventsAfterTimingCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargeyAllEventsAfterTimingCut] = new TH1F(
 			"chargeyAllEventsAfterTimingCut", ";charge Y; entries", 100, 0,
 			1000);
-	general_mapCombined1D["chargexAllEventsAfterCoincidenceCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargexAllEventsAfterCoincidenceCut] = new TH1F(
 			"chargexAllEventsAfterCoincidenceCut", ";charge X; entries", 100, 0,
 			1000);
-	general_mapCombined1D["chargeyAllEventsAfterCoincidenceCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargeyAllEventsAfterCoincidenceCut] = new TH1F(
 			"chargeyAllEventsAfterCoincidenceCut", ";charge Y; entries", 100, 0,
 			1000);
-	general_mapCombined1D["chargexAllEventsUncut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargexAllEventsUncut] = new TH1F(
 			"chargexAllEventsUncut", ";charge X; entries", 100, 0, 1000);
-	general_mapCombined1D["chargeyAllEventsUncut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::chargeyAllEventsUncut] = new TH1F(
 			"chargeyAllEventsUncut", ";charge Y; entries", 100, 0, 1000);
 
-	general_mapCombined1D["hitWidthX"] = new TH1F("hitWidthX",
+	general_mapCombined1D[CombinedHist1D::hitWidthX] = new TH1F("hitWidthX",
 			";sigmaRunMittel ;entries", 50, 0, 3);
-	general_mapCombined1D["hitWidthY"] = new TH1F("hitWidthY",
+	general_mapCombined1D[CombinedHist1D::hitWidthY] = new TH1F("hitWidthY",
 			";sigmaRunMittel ;entries", 50, 0, 3);
 
-	general_mapCombined1D["timeDistributionXAfterTimeCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::timeDistributionXAfterTimeCut] = new TH1F(
 			"timeDistributionXAfterTimeCut", ";time section ;entries",
 			NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
-	general_mapCombined1D["timeDistributionYAfterTimeCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::timeDistributionYAfterTimeCut] = new TH1F(
 			"timeDistributionYAfterTimeCut", ";time section ;entries",
 			NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
-	general_mapCombined1D["timeDistributionYAfterTimeXCut"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::timeDistributionYAfterTimeXCut] = new TH1F(
 			"timeDistributionYAfterTimeXCut", ";time section ;entries",
 			NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
 
-	general_mapCombined1D["timeDistributionX"] = new TH1F("timeDistributionX",
+	general_mapCombined1D[CombinedHist1D::timeDistributionX] = new TH1F("timeDistributionX",
 			";time section ;entries", NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
-	general_mapCombined1D["timeDistributionY"] = new TH1F("timeDistributionY",
+	general_mapCombined1D[CombinedHist1D::timeDistributionY] = new TH1F("timeDistributionY",
 			";time section ;entries", NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
-	general_mapCombined1D["timeDistributionUncutX"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::timeDistributionUncutX] = new TH1F(
 			"timeDistributionUncutX", ";time section ;entries",
 			NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
-	general_mapCombined1D["timeDistributionUncutY"] = new TH1F(
+	general_mapCombined1D[CombinedHist1D::timeDistributionUncutY] = new TH1F(
 			"timeDistributionUncutY", ";time section ;entries",
 			NUMBER_OF_TIME_SLICES + 1, -1.5, 26.5);
 
-	general_mapCombined1D["timeCoincidence"] = new TH1F("timeCoincidence",
+	general_mapCombined1D[CombinedHist1D::timeCoincidence] = new TH1F("timeCoincidence",
 			";time x-y [25 ns] ;entries", 11, -5.5, 5.5);
 
-//	general_mapCombined1D["clusterx"] = new TH1F("clusterx",
+//	general_mapCombined1D[CombinedHist1D::clusterx] = new TH1F("clusterx",
 //			";x cluster size [strips]; entries", 30, 0, 30.);
-//	general_mapCombined1D["clustery"] = new TH1F("clustery",
+//	general_mapCombined1D[CombinedHist1D::clustery] = new TH1F("clustery",
 //			";y cluster size [strips]; entries", 30, 0, 30.);
-//	general_mapCombined1D["clusterxUncut"] = new TH1F("clusterxUncut",
+//	general_mapCombined1D[CombinedHist1D::clusterxUncut] = new TH1F("clusterxUncut",
 //			";x cluster size [strips]; entries", 30, 0, 30.);
-//	general_mapCombined1D["clusteryUncut"] = new TH1F("clusteryUncut",
+//	general_mapCombined1D[CombinedHist1D::clusteryUncut] = new TH1F("clusteryUncut",
 //			";y cluster size [strips]; entries", 30, 0, 30.);
+}
 
-	// limit the number of events to be processed to MAX_NUM...
-	int numberOfRunsToProcess = mapFile.size();
-	if (MAX_NUM_OF_RUNS_TO_BE_PROCESSED < numberOfRunsToProcess
+/**
+ * Returns the runs of MicroMegas to be processed (limited to MAX_NUM_OF_RUNS_TO_BE_PROCESSED)
+ */
+std::vector<string> getRunsToProcess(MapFile& MicroMegas) {
+	std::vector<string> runs = MicroMegas.getRunNames();
+
+	// limit the number of runs to be processed to MAX_NUM...
+	if (MAX_NUM_OF_RUNS_TO_BE_PROCESSED < (int) runs.size()
 			&& MAX_NUM_OF_RUNS_TO_BE_PROCESSED > 0) {
-		numberOfRunsToProcess = MAX_NUM_OF_RUNS_TO_BE_PROCESSED;
+		runs.resize(MAX_NUM_OF_RUNS_TO_BE_PROCESSED);
 	}
+	return runs;
+}
+
+/**
+ * Initializes the histograms of a single run
+ */
+void bookRunHistograms(AnalysisContext& context) {
+	context.mapHist1D[RunHist1D::mmhitx] = new FastHistogram1D("mmhitx", ";x [strips]; entries",
+			xStrips, 0, xStrips);
+	context.mapHist1D[RunHist1D::mmhity] = new FastHistogram1D("mmhity", ";y [strips]; entries",
+			yStrips, 0, yStrips);
+//	context.mapHist1D[RunHist1D::mmclusterx] = new FastHistogram1D("mmclusterx",
+//			";x cluster size [strips]; entries", 50, 0, 50.);
+//	context.mapHist1D[RunHist1D::mmclustery] = new FastHistogram1D("mmclustery",
+//			";y cluster size [strips]; entries", 50, 0, 50.);
+//	context.mapHist1D[RunHist1D::mmclusterxUncut] = new FastHistogram1D("mmclusterxUncut",
+//			";x cluster size [strips]; entries", 50, 0, 50.);
+//	context.mapHist1D[RunHist1D::mmclusteryUncut] = new FastHistogram1D("mmclusteryUncut",
+//			";y cluster size [strips]; entries", 50, 0, 50.);
+	context.mapHist1D[RunHist1D::mmchargex] = new FastHistogram1D("mmchargex",
+			";charge X; entries", 100, 0, 1000);
+	context.mapHist1D[RunHist1D::mmchargey] = new FastHistogram1D("mmchargey",
+			";charge Y; entries", 100, 0, 1000);
+	context.mapHist1D[RunHist1D::mmchargexUncut] = new FastHistogram1D("mmchargexUncut",
+			";charge X; entries", 100, 0, 1000);
+	context.mapHist1D[RunHist1D::mmchargeyUncut] = new FastHistogram1D("mmchargeyUncut",
+			";charge Y; entries", 100, 0, 1000);
+	context.mapHist1D[RunHist1D::mmtimex] = new FastHistogram1D("mmtimex", ";time [ns]; entries",
+			(TRGBURST + 1) * 3, 0, (TRGBURST + 1) * 3 * 25.);
+	context.mapHist1D[RunHist1D::mmtimey] = new FastHistogram1D("mmtimey", ";time [ns]; entries",
+			(TRGBURST + 1) * 3, 0, (TRGBURST + 1) * 3 * 25.);
+	context.mapHist1D[RunHist1D::mmdtime] = new FastHistogram1D("mmdtime",
+			";#Delta time [s]; entries", 500, 0, 50.);
+//	context.mapHist1D[RunHist1D::mmrate] = new FastHistogram1D("mmrate",
+//			";rate/10min [Hz]; entries", 200, 0, 2.);
+
+	context.mapHist1D[RunHist1D::mmhitWidthX] = new FastHistogram1D("mmhitWidthX",
+			";sigma; entries", 50, 0., 3.);
+	context.mapHist1D[RunHist1D::mmhitWidthY] = new FastHistogram1D("mmhitWidthY",
+			";sigma; entries", 50, 0., 3.);
+
+	context.mapHist2D[RunHist2D::mmhitmap] = new FastHistogram2D("mmhitmap",
+			";x [strips]; y [strips]", xStrips, 0, xStrips, yStrips, 0,
+			yStrips);
+}
+
+/**
+ * Restricts <event> to the events [firstEvent, lastEvent) of its run and sets the reading mode
+ * selected on the command line
+ */
+void setUpReader(MMQuickEvent* event, int firstEvent, int lastEvent) {
+	event->setEntryRange(firstEvent, lastEvent);
+	event->setStagedReading(STAGED_BRANCH_LOADING);
+	event->setCache(TREE_CACHE_SIZE, TREE_CACHE_LEARN_ENTRIES);
+	event->setPrefetching(PREFETCHED_EVENTS);
+}
+
+/**
+ * Runs analyseMMEvent for the remaining events of the range set by setUpReader. The event number
+ * passed to analyseMMEvent is the entry number within the run, independent of how the run is split.
+ */
+void processEvents(MMQuickEvent* event, AnalysisContext& context,
+		int firstEvent) {
+	StageTimeCollector stageTimeCollector(context.stageTimes);
+
 	/*
-	 * Data for graphs to plot the fit width vs the value of VD for every run
+	 * Main Loop processing all events
 	 */
-	std::vector<double> VDsForGraphsX;
-	std::vector<double> VAsForGraphsX;
-	std::vector<double> hitWidthsX;
-	std::vector<double> hitWidthsXErrors;
-	std::vector<double> VDsForGraphsY;
-	std::vector<double> VAsForGraphsY;
-	std::vector<double> hitWidthsY;
-	std::vector<double> hitWidthsYErrors;
+	int eventNumber = firstEvent;
+	while (event->getNextEvent()) {
+		if (analyseMMEvent(context, event, event->getView(), eventNumber,
+				TRGBURST) == true) {
+			context.numberOfAcceptedEvents++;
+		}
+		context.numberOfProcessedEvents++;
+		eventNumber++;
+	}
+	event->addIoStatistics(context.ioAudit);
+}
 
-// iterate of different runs in the map
-	int runNumber = 0;
-	for (map<string, TFile*>::const_iterator Fitr(mapFile.begin());
-			Fitr != mapFile.end(); ++Fitr) {
+/**
+ * A run opened by openRun: the files of the run, the split of its events into parts and the reader
+ * of the first part
+ */
+struct RunReader {
+	string runName;
+	vector<string> fileNames;
+	std::vector<int> firstEventOfPart; // numberOfParts + 1 elements, the last one is the end
+	MMQuickEvent* event;
+
+	int getNumberOfParts() const {
+		return firstEventOfPart.size() - 1;
+	}
+};
 
-		if (runNumber == MAX_NUM_OF_RUNS_TO_BE_PROCESSED) {
-			break;
+/**
+ * Opens the files of a run and starts reading its first events in the background (see
+ * MMQuickEvent::warmUp). Calling this for the next run while the current one is still being
+ * processed hides the time to open the chain and read the first baskets.
+ *
+ * With NUMBER_OF_THREADS_PER_RUN > 1 the events are split into equally sized consecutive parts.
+ * Only the reader of the first part is opened here, the ones of the other parts are created by
+ * processRun.
+ */
+RunReader* openRun(MapFile& MicroMegas, const string& runName) {
+	RunReader* reader = new RunReader();
+	reader->runName = runName;
+	reader->fileNames = MicroMegas.getFileName(runName);
+	reader->event = new MMQuickEvent(reader->fileNames, "raw", -1); //last number indicates number of events to be analysed, -1 for all events
+
+	int numberOfEvents = reader->event->getEventNumber();
+	if (MAX_NUM_OF_EVENTS_TO_BE_PROCESSED >= 0
+			&& numberOfEvents > MAX_NUM_OF_EVENTS_TO_BE_PROCESSED) {
+		numberOfEvents = MAX_NUM_OF_EVENTS_TO_BE_PROCESSED;
+	}
+
+	int numberOfParts = NUMBER_OF_THREADS_PER_RUN;
+	if (numberOfParts > numberOfEvents) {
+		numberOfParts = numberOfEvents > 0 ? numberOfEvents : 1;
+	}
+	for (int part = 0; part <= numberOfParts; part++) {
+		reader->firstEventOfPart.push_back(
+				(long long) numberOfEvents * part / numberOfParts);
+	}
+
+	setUpReader(reader->event, reader->firstEventOfPart[0],
+			reader->firstEventOfPart[1]);
+	reader->event->warmUp();
+	return reader;
+}
+
+/**
+ * Runs analyseMMEvent for all events of the run opened by <reader> and deletes the MMQuickEvent of
+ * the reader afterwards. Only touches the context, so different runs may be processed concurrently.
+ *
+ * Every part of the run (see openRun) is processed by its own thread with its own reader and a
+ * copy of the context. The copies are added to the context in the order of the parts, so the
+ * result is the same as reading the run in one go.
+ */
+void processRun(RunReader& reader, AnalysisContext& context,
+		bool showProgress) {
+	const int numberOfParts = reader.getNumberOfParts();
+	const std::vector<int>& firstEventOfPart = reader.firstEventOfPart;
+
+	if (numberOfParts == 1) {
+		reader.event->setShowProgress(showProgress);
+		processEvents(reader.event, context, firstEventOfPart[0]);
+
+		// closes the files of the run together with their TTreeCache
+		delete reader.event;
+		reader.event = NULL;
+		context.ioAudit.print(reader.runName, PRINT_IO_AUDIT);
+		if (PRINT_CUT_FLOW) {
+			cutFlow.print(reader.runName, context.cutFlowStatistics);
 		}
+		return;
+	}
 
-		std::cout << "Reading File " << ++runNumber << " out of "
-				<< numberOfRunsToProcess << std::endl;
-
-		int eventNumber = 0; //initialisation of counting variable for later use
-
-		// Initializing Global Histograms
-		general_mapHist1D["mmhitx"] = new TH1F("mmhitx", ";x [strips]; entries",
-				xStrips, 0, xStrips);
-		general_mapHist1D["mmhity"] = new TH1F("mmhity", ";y [strips]; entries",
-				yStrips, 0, yStrips);
-//		general_mapHist1D["mmclusterx"] = new TH1F("mmclusterx",
-//				";x cluster size [strips]; entries", 50, 0, 50.);
-//		general_mapHist1D["mmclustery"] = new TH1F("mmclustery",
-//				";y cluster size [strips]; entries", 50, 0, 50.);
-//		general_mapHist1D["mmclusterxUncut"] = new TH1F("mmclusterxUncut",
-//				";x cluster size [strips]; entries", 50, 0, 50.);
-//		general_mapHist1D["mmclusteryUncut"] = new TH1F("mmclusteryUncut",
-//				";y cluster size [strips]; entries", 50, 0, 50.);
-		general_mapHist1D["mmchargex"] = new TH1F("mmchargex",
-				";charge X; entries", 100, 0, 1000);
-		general_mapHist1D["mmchargey"] = new TH1F("mmchargey",
-				";charge Y; entries", 100, 0, 1000);
-		general_mapHist1D["mmchargexUncut"] = new TH1F("mmchargexUncut",
-				";charge X; entries", 100, 0, 1000);
-		general_mapHist1D["mmchargeyUncut"] = new TH1F("mmchargeyUncut",
-				";charge Y; entries", 100, 0, 1000);
-		general_mapHist1D["mmtimex"] = new TH1F("mmtimex",
-				";time [ns]; entries", (TRGBURST + 1) * 3, 0,
-				(TRGBURST + 1) * 3 * 25.);
-		general_mapHist1D["mmtimey"] = new TH1F("mmtimey",
-				";time [ns]; entries", (TRGBURST + 1) * 3, 0,
-				(TRGBURST + 1) * 3 * 25.);
-		general_mapHist1D["mmdtime"] = new TH1F("mmdtime",
-				";#Delta time [s]; entries", 500, 0, 50.);
-//		general_mapHist1D["mmrate"] = new TH1F("mmrate",
-//				";rate/10min [Hz]; entries", 200, 0, 2.);
-
-		general_mapHist1D["mmhitWidthX"] = new TH1F("mmhitWidthX",
-				";sigma; entries", 50, 0., 3.);
-		general_mapHist1D["mmhitWidthY"] = new TH1F("mmhitWidthY",
-				";sigma; entries", 50, 0., 3.);
-
-		general_mapHist2D["mmhitmap"] = new TH2F("mmhitmap",
-				";x [strips]; y [strips]", xStrips, 0, xStrips, yStrips, 0,
-				yStrips);
-
-		//initialize trees with structure defined above
-		TTree* fitTree = new TTree("T", "results of gauss fit");
-
-		fitTree->Branch("gauss", &(gauss.gaussXmean),
-				"gaussXmean/D:gaussXmeanError/D:gaussXsigma/D:gaussXcharge/D:gaussXchi/D:gaussXdof/D:gaussXchiRed/D:gaussYmean/D:gaussYmeanError:gaussYsigma/D:gaussYcharge/D:gaussYchi/D:gaussYdof/D:gaussYchiRed/D:number/I");
-		fitTree->Branch("maxi", &maxi.maxXmean,
-				"maxXmean/I:maxXcharge:maxXcluster:maxYmean:maxYcharge:maxYcluster:number");
-
-		general_mapTree["fits"] = fitTree;
-
-		// initialize the output file for analysis of each run
-		TFile *file0 = Fitr->second;
-
-		// Read NUTuple and execute events
-		vector<string> vec_Filenames = MicroMegas.getFileName(Fitr->first);
-		m_event = new MMQuickEvent(vec_Filenames, "raw", -1); //last number indicates number of events to be analysed, -1 for all events
-		m_TotalEventNumber = m_event->getEventNumber();
-		
-		/*
-		 * Main Loop processing all events 
-		 */
-		int numberOfAcceptedEvents = 0;
-		while (m_event->getNextEvent()
-				&& eventNumber != MAX_NUM_OF_EVENTS_TO_BE_PROCESSED) {
-			if (analyseMMEvent(m_event, eventNumber, TRGBURST) == true) {
-				numberOfAcceptedEvents++;
+	/*
+	 * The first part is processed by this thread directly into the context
+	 */
+	std::vector<AnalysisContext*> partContexts;
+	partContexts.push_back(&context);
+	for (int part = 1; part < numberOfParts; part++) {
+		partContexts.push_back(context.createEmptyCopy());
+		partContexts.back()->seedEventDisplays(reader.runName, part);
+	}
+
+	std::vector<std::thread> threads;
+	for (int part = 1; part < numberOfParts; part++) {
+		threads.push_back(std::thread([&, part]() {
+			MMQuickEvent* partEvent = new MMQuickEvent(reader.fileNames, "raw", -1);
+			partEvent->setShowProgress(false);
+			setUpReader(partEvent, firstEventOfPart[part],
+					firstEventOfPart[part + 1]);
+			processEvents(partEvent, *partContexts[part], firstEventOfPart[part]);
+			delete partEvent;
+		}));
+	}
+
+	reader.event->setShowProgress(false);
+	processEvents(reader.event, context, firstEventOfPart[0]);
+	delete reader.event;
+	reader.event = NULL;
+
+	for (int part = 1; part < numberOfParts; part++) {
+		threads[part - 1].join();
+		context.add(*partContexts[part]);
+		delete partContexts[part];
+	}
+	context.ioAudit.print(reader.runName, PRINT_IO_AUDIT);
+	if (PRINT_CUT_FLOW) {
+		cutFlow.print(reader.runName, context.cutFlowStatistics);
+	}
+}
+
+/**
+ * Fits, plots and stores the results of a processed run into its own output file and returns
+ * everything the combined plots need in summary. Only touches the per-run objects of the context.
+ *
+ * The output file is only opened for writing the results (see RunOutputFile). Returns false if it
+ * could not be written, summary is filled in any case.
+ */
+bool writeRun(MapFile& MicroMegas, const string& runName,
+		AnalysisContext& context, RunSummary& summary) {
+	StageTimeCollector stageTimeCollector(context.stageTimes);
+	summary.runName = runName;
+	summary.driftGap = MicroMegas.driftGap;
+	summary.VD = MicroMegas.getVDbyFileName(runName);
+	summary.VA = MicroMegas.getVAbyFileName(runName);
+	summary.numberOfAcceptedEvents = context.numberOfAcceptedEvents;
+
+	RunHistograms1D mapHist1D;
+	RunHistograms2D mapHist2D;
+	context.createRootHistograms(mapHist1D, mapHist2D);
+
+	/*
+	 * Fit hit width histogram. The workers may be fitting the events of the next runs meanwhile.
+	 */
+	std::unique_lock<std::mutex> fitLock(getFitMutex());
+	// fit histrogram maxChargeCrossSection with Gaussian distribution
+	mapHist1D[RunHist1D::mmhitWidthX]->Fit("gaus", "Sq");
+	TF1* hitWidthFitResultsX = mapHist1D[RunHist1D::mmhitWidthX]->GetFunction(
+			"gaus");
+	if (hitWidthFitResultsX) {
+		summary.hasHitWidthX = true;
+		summary.hitWidthX = hitWidthFitResultsX->GetParameter(1);
+		summary.hitWidthXError = hitWidthFitResultsX->GetParError(1);
+	}
+
+	mapHist1D[RunHist1D::mmhitWidthY]->Fit("gaus", "Sq");
+	TF1* hitWidthFitResultsY = mapHist1D[RunHist1D::mmhitWidthY]->GetFunction(
+			"gaus");
+	if (hitWidthFitResultsY) {
+		summary.hasHitWidthY = true;
+		summary.hitWidthY = hitWidthFitResultsY->GetParameter(1);
+		summary.hitWidthYError = hitWidthFitResultsY->GetParError(1);
+	}
+	fitLock.unlock();
+
+	/*
+	 * Store HitWidth histograms
+	 */
+	std::stringstream namePrefix;
+	namePrefix << "DG" << MapFile::driftGap << "-" << runName << "-";
+	if (PDF_PER_RUN) {
+		PdfRenderQueue::getInstance().beginDocument(
+				outPath + "RunPlots/" + namePrefix.str() + "plots.pdf");
+	}
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmhitWidthX], "HitWidthHistograms",
+			"", namePrefix.str());
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmhitWidthY], "HitWidthHistograms",
+			"", namePrefix.str());
+
+	/*
+	 * Store charge histograms
+	 */
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmchargex], "ChargeHistograms", "",
+			namePrefix.str());
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmchargey], "ChargeHistograms", "",
+			namePrefix.str());
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmchargexUncut], "ChargeHistograms",
+			"", namePrefix.str());
+	writeToPdf<TH1F>(mapHist1D[RunHist1D::mmchargeyUncut], "ChargeHistograms",
+			"", namePrefix.str());
+
+	/*
+	 * Store hitmap histogram
+	 */
+	writeToPdf<TH2F>(mapHist2D[RunHist2D::mmhitmap], "HitMapHistograms", "",
+			namePrefix.str());
+
+	/*
+	 * Store the plotted fits
+	 */
+	namePrefix.str("");
+	namePrefix << "DG" << MapFile::driftGap << "-";
+	for (auto& pair : context.mapPlotFit) {
+		writeToPdf<TH1F>(pair.second, "HitWidthFits", "", namePrefix.str());
+	}
+	if (PDF_PER_RUN) {
+		PdfRenderQueue::getInstance().endDocument();
+	}
+
+	vector<double>& eventTimes = context.eventTimes;
+	float lengthOfMeasurement = 0.;
+	if (!eventTimes.empty()) {
+		// fill dtime + rate hist
+		vector<double> ratesOverMeasurementTime(eventTimes.size() / 2);
+		sort(eventTimes.begin(), eventTimes.end());
+		float tempDeltaTime = 0.;
+		float timePeriod = 30.; // time period for rate hist (10 s)
+		int periodCount = 0;
+		int beginOfTimePeriod = 0;
+		double lastTime = eventTimes.at(0);
+		for (unsigned int e = 1; e < eventTimes.size(); e++) { // start at 1 because first is already loaded
+			float deltaTime = eventTimes.at(e) - lastTime;
+			if (deltaTime < 1000.) { // to get malformed events out
+				mapHist1D[RunHist1D::mmdtime]->Fill(deltaTime);
+				lengthOfMeasurement += deltaTime;
+				tempDeltaTime += deltaTime;
+				if (tempDeltaTime >= timePeriod) {
+					ratesOverMeasurementTime.push_back(e - beginOfTimePeriod);
+//					mapHist1D[RunHist1D::mmrate]->Fill(
+//							(e - beginOfTimePeriod) / tempDeltaTime);
+					periodCount++;
+					beginOfTimePeriod = e;
+					tempDeltaTime = 0.;
+				}
 			}
-			eventNumber++;
+			lastTime = eventTimes.at(e);
 		}
+		eventTimes.clear(); // clear vector for next measurement
+	}
+	summary.lengthOfMeasurement = lengthOfMeasurement;
+
+	summary.meanChargeX = mapHist1D[RunHist1D::mmchargex]->GetMean();
+	summary.meanChargeY = mapHist1D[RunHist1D::mmchargey]->GetMean();
+	summary.meanChargeXUncut = mapHist1D[RunHist1D::mmchargexUncut]->GetMean();
+	summary.meanChargeYUncut = mapHist1D[RunHist1D::mmchargeyUncut]->GetMean();
+
+	/// Saving Results
+	RunOutputFile outputFile(MicroMegas.getOutputFileName(runName));
+	if (!outputFile.isOpen()) {
+		std::cerr << "Unable to create the output file of run " << runName
+				<< std::endl;
+		mapHist1D.deleteAll();
+		mapHist2D.deleteAll();
+		return false;
+	}
+	outputFile.get()->cd();
 
-		/*
-		 * Fit hit width histogram
-		 */
-		int VD = MicroMegas.getVDbyFileName(Fitr->first);
-		int VA = MicroMegas.getVAbyFileName(Fitr->first);
-		double VE = VD / MicroMegas.driftGap;
-		TF1* hitWidthFitResultsX = fitHitWidhtHistogram(
-				general_mapHist1D["mmhitWidthX"],
-				general_mapCombined1D["hitWidthX"], VDsForGraphsX,
-				VAsForGraphsX, hitWidthsX, hitWidthsXErrors, VD, VA);
-
-		TF1* hitWidthFitResultsY = fitHitWidhtHistogram(
-				general_mapHist1D["mmhitWidthY"],
-				general_mapCombined1D["hitWidthY"], VDsForGraphsY,
-				VAsForGraphsY, hitWidthsY, hitWidthsYErrors, VD, VA);
+	/// loop over map of the plots for saving
+	for (auto& histogram : mapHist1D) {
+		histogram->SetOption("error");
+		histogram->Write();
+	}
+	for (auto& histogram : mapHist2D) {
+		histogram->SetOption("error");
+		histogram->Write();
+	}
+	gDirectory->cd("..");
+	gDirectory->mkdir("Fits");
+	gDirectory->cd("Fits");
+	for (map<string, TH1F*>::iterator iter = context.mapPlotFit.begin();
+			iter != context.mapPlotFit.end(); iter++) {
+		iter->second->SetName(iter->first.c_str());
+		iter->second->Write();
+	}
+	gDirectory->cd("..");
+	gDirectory->mkdir("Trees");
+	gDirectory->cd("Trees");
+
+	//initialize trees with structure defined in AnalysisContext.h
+	gauss_t gauss;
+	maxi_t maxi;
+	TTree* fitTree = new TTree("T", "results of gauss fit");
+
+	fitTree->Branch("gauss", &(gauss.gaussXmean),
+			"gaussXmean/D:gaussXmeanError/D:gaussXsigma/D:gaussXcharge/D:gaussXchi/D:gaussXdof/D:gaussXchiRed/D:gaussYmean/D:gaussYmeanError:gaussYsigma/D:gaussYcharge/D:gaussYchi/D:gaussYdof/D:gaussYchiRed/D:number/I");
+	fitTree->Branch("maxi", &maxi.maxXmean,
+			"maxXmean/I:maxXcharge:maxXcluster:maxYmean:maxYcharge:maxYcluster:number");
+
+	{
+		MM_TIME_STAGE(TREE_FILLS);
+		for (auto& fitResult : context.fitResults) {
+			gauss = fitResult.first;
+			maxi = fitResult.second;
+			fitTree->Fill();
+		}
+		fitTree->Write();
+		delete fitTree;
+	}
 
-		/*
-		 * Store HitWidth histograms
-		 */
-		std::stringstream namePrefix;
-		namePrefix << "DG" << MapFile::driftGap << "-" << Fitr->first << "-";
-		writeToPdf<TH1F>(general_mapHist1D["mmhitWidthX"], "HitWidthHistograms",
-				"", namePrefix.str());
-		writeToPdf<TH1F>(general_mapHist1D["mmhitWidthY"], "HitWidthHistograms",
-				"", namePrefix.str());
+	const bool isWritten = outputFile.commit();
+	mapHist1D.deleteAll();
+	mapHist2D.deleteAll();
+	return isWritten;
+}
 
-		/*
-		 * Store charge histograms
-		 */
-		namePrefix.str("");
-		namePrefix << "DG" << MapFile::driftGap << "-" << Fitr->first << "-";
-		writeToPdf<TH1F>(general_mapHist1D["mmchargex"], "ChargeHistograms", "",
-				namePrefix.str());
-		writeToPdf<TH1F>(general_mapHist1D["mmchargey"], "ChargeHistograms", "",
-				namePrefix.str());
-		writeToPdf<TH1F>(general_mapHist1D["mmchargexUncut"],
-				"ChargeHistograms", "", namePrefix.str());
-		writeToPdf<TH1F>(general_mapHist1D["mmchargeyUncut"],
-				"ChargeHistograms", "", namePrefix.str());
+/**
+ * Prints the time spent per stage while processing and writing the run and adds it to
+ * campaignStageTimes, and the events and bytes read to campaignBenchmark. Must be called by the
+ * main thread.
+ */
+void reportStageTimes(const string& runName, const AnalysisContext& context) {
+	context.stageTimes.print("run " + runName);
+	campaignStageTimes.add(context.stageTimes);
+	campaignBenchmark.addRun(runName, context.numberOfProcessedEvents,
+			context.numberOfAcceptedEvents, context.ioAudit);
+}
 
-		/*
-		 * Store hitmap histogram
-		 */
-		namePrefix.str("");
-		namePrefix << "DG" << MapFile::driftGap << "-" << Fitr->first << "-";
-		writeToPdf<TH2F>(general_mapHist2D["mmhitmap"], "HitMapHistograms", "",
-				namePrefix.str());
-
-		hitwidthsByEdbyVaByDgX[(int) (VE)][VA][MapFile::driftGap] =
-				std::make_pair(hitWidthFitResultsX->GetParameter(1),
-						hitWidthFitResultsX->GetParError(1));
-
-		hitwidthsByEdbyVaByDgY[(int) (VE)][VA][MapFile::driftGap] =
-				std::make_pair(hitWidthFitResultsY->GetParameter(1),
-						hitWidthFitResultsY->GetParError(1));
-
-		float lengthOfMeasurement = 0.;
-		if (!eventTimes.empty()) {
-			// fill dtime + rate hist
-			vector<double> ratesOverMeasurementTime(eventTimes.size() / 2);
-			sort(eventTimes.begin(), eventTimes.end());
-			float tempDeltaTime = 0.;
-			float timePeriod = 30.; // time period for rate hist (10 s)
-			int periodCount = 0;
-			int beginOfTimePeriod = 0;
-			double lastTime = eventTimes.at(0);
-			for (unsigned int e = 1; e < eventTimes.size(); e++) { // start at 1 because first is already loaded
-				float deltaTime = eventTimes.at(e) - lastTime;
-				if (deltaTime < 1000.) { // to get malformed events out
-					general_mapHist1D["mmdtime"]->Fill(deltaTime);
-					lengthOfMeasurement += deltaTime;
-					tempDeltaTime += deltaTime;
-					if (tempDeltaTime >= timePeriod) {
-						ratesOverMeasurementTime.push_back(
-								e - beginOfTimePeriod);
-//						general_mapHist1D["mmrate"]->Fill(
-//								(e - beginOfTimePeriod) / tempDeltaTime);
-						periodCount++;
-						beginOfTimePeriod = e;
-						tempDeltaTime = 0.;
+/*
+ * Prints campaignStageTimes including the time the main thread spent outside of the runs as the
+ * times of <title>, and the hardware counters of the analysis kernels if enabled via
+ * --perf-counters
+ */
+void printStageTimesAndCounters(const string& title) {
+	campaignStageTimes.add(StageTimer::getThreadTimes());
+	StageTimer::getThreadTimes().reset();
+	campaignStageTimes.print(title);
+	PerfCounters::print();
+}
+
+/*
+ * Prints the stage times and counters of the campaign (see printStageTimesAndCounters) and writes
+ * the benchmark results if enabled via --benchmark
+ */
+void printCampaignStageTimes() {
+	printStageTimesAndCounters("the campaign");
+	if (!BENCHMARK_FILE.empty()
+			&& !campaignBenchmark.write(BENCHMARK_FILE, campaignStageTimes)) {
+		numberOfFailedRuns++;
+	}
+}
+
+/**
+ * Adds the results of a run to the combined histograms, the hit width graphs and the global maps.
+ * Must be called by the main thread in the order of the runs. <context> only needs to contain the
+ * combined histograms and the cut statistics (see AnalysisContext::readPartial).
+ */
+void mergeRun(MapFile& MicroMegas, const RunSummary& summary,
+		AnalysisContext& context, TFile* fileCombined,
+		HitWidthGraphData& graphs,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgX,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgY) {
+
+	context.merge(general_mapCombined1D, general_mapCombined,
+			CutStatistic::instances);
+
+	const int VD = summary.VD;
+	const int VA = summary.VA;
+	const double VE = VD / MicroMegas.driftGap;
+
+	// Plot hit width vs VD
+	if (summary.hasHitWidthX) {
+		general_mapCombined1D[CombinedHist1D::hitWidthX]->Fill(summary.hitWidthX);
+		graphs.VDsForGraphsX.push_back(VD);
+		graphs.VAsForGraphsX.push_back(VA);
+		graphs.hitWidthsX.push_back(summary.hitWidthX);
+		graphs.hitWidthsXErrors.push_back(summary.hitWidthXError);
+	}
+	if (summary.hasHitWidthY) {
+		general_mapCombined1D[CombinedHist1D::hitWidthY]->Fill(summary.hitWidthY);
+		graphs.VDsForGraphsY.push_back(VD);
+		graphs.VAsForGraphsY.push_back(VA);
+		graphs.hitWidthsY.push_back(summary.hitWidthY);
+		graphs.hitWidthsYErrors.push_back(summary.hitWidthYError);
+	}
+
+	hitwidthsByEdbyVaByDgX[(int) (VE)][VA][MapFile::driftGap] = std::make_pair(
+			summary.hitWidthX, summary.hitWidthXError);
+
+	hitwidthsByEdbyVaByDgY[(int) (VE)][VA][MapFile::driftGap] = std::make_pair(
+			summary.hitWidthY, summary.hitWidthYError);
+
+	fileCombined->cd();
+	general_mapCombined[CombinedHist2D::rate]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
+			summary.getRate());
+
+	global_mapCombined2D["RateByVAED"]->Fill(VD / MicroMegas.driftGap, VA,
+			summary.getRate());
+
+	global_mapCombined2D["hitWidthYByVAED"]->Fill(VE, VA, summary.hitWidthY);
+	global_mapCombined2D["hitWidthXByVAED"]->Fill(VE, VA, summary.hitWidthX);
+	global_mapCombined2D["hitWidthByVAEDCounter"]->Fill(VE, VA, 1);
+
+	global_mapCombined2D["RateByVAEDCounter"]->Fill(VD / MicroMegas.driftGap,
+			VA, 1);
+
+	global_mapCombined2D["rateVsDriftGap"]->Fill(MicroMegas.getDriftGap(),
+			summary.getRate());
+
+	general_mapCombined[CombinedHist2D::chargeX]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
+			summary.meanChargeX);
+	general_mapCombined[CombinedHist2D::chargeY]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
+			summary.meanChargeY);
+
+	general_mapCombined[CombinedHist2D::chargeXfieldStrength]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
+			summary.meanChargeX);
+	general_mapCombined[CombinedHist2D::chargeYfieldStrength]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
+			summary.meanChargeY);
+	general_mapCombined[CombinedHist2D::chargeXuncut]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
+			summary.meanChargeXUncut);
+	general_mapCombined[CombinedHist2D::chargeYuncut]->SetBinContent(
+			(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
+			(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
+			summary.meanChargeXUncut);
+}
+
+/**
+ * Processes the runs in up to NUMBER_OF_PARALLEL_RUNS threads. The main thread writes and merges
+ * the runs strictly in the order of the run list. A worker does not start a run before the main
+ * thread has caught up, so at most 2*NUMBER_OF_PARALLEL_RUNS runs are kept in memory.
+ *
+ * With PIPELINE_RUNS the runs are processed by worker threads even if only one run is processed at
+ * a time: the main thread fits, plots and writes a run while the worker already processes the next
+ * one, and each worker opens the run it will process next while it is still busy with the current
+ * one (see openRun).
+ */
+void processRunsInThreads(MapFile& MicroMegas,
+		const std::vector<string>& runs,
+		TFile* fileCombined, HitWidthGraphData& graphs,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgX,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgY) {
+	/*
+	 * A context keeps its histograms and fit results until the run is written, so only the runs
+	 * [numberOfWrittenRuns, numberOfWrittenRuns + maxNumberOfContexts) may be in memory: one being
+	 * processed by each worker and at most one processed but not yet written run per worker.
+	 */
+	const unsigned int maxNumberOfContexts = 2 * NUMBER_OF_PARALLEL_RUNS;
+	unsigned int numberOfWrittenRuns = 0;
+
+	/*
+	 * The contexts are booked by the main thread before a worker may take their run so that the
+	 * worker threads only fill existing histograms
+	 */
+	std::vector<AnalysisContext*> contexts(runs.size(), NULL);
+	auto bookContext = [&](unsigned int run) {
+		contexts[run] = new AnalysisContext(general_mapCombined1D,
+				general_mapCombined, HIT_ESTIMATOR_TYPE);
+		contexts[run]->seedEventDisplays(runs[run], 0);
+		bookRunHistograms(*contexts[run]);
+	};
+	for (unsigned int run = 0; run < runs.size() && run < maxNumberOfContexts;
+			run++) {
+		bookContext(run);
+	}
+
+	/*
+	 * The workers take the next unprocessed run until all runs are done. The main thread finishes
+	 * the runs strictly in the order of the run list, waiting for each run to be processed
+	 */
+	std::atomic<unsigned int> nextRun(0);
+	std::vector<bool> isRunProcessed(runs.size(), false);
+	std::mutex runProcessedMutex;
+	std::condition_variable runProcessed;
+	std::condition_variable runWritten;
+
+	const bool parallel = (NUMBER_OF_PARALLEL_RUNS > 1 || PIPELINE_RUNS)
+			&& runs.size() > 1;
+	std::vector<std::thread> workers;
+	if (parallel) {
+		const bool showProgress = NUMBER_OF_PARALLEL_RUNS == 1;
+		for (unsigned int i = 0;
+				i < NUMBER_OF_PARALLEL_RUNS && i < runs.size(); i++) {
+			workers.push_back(std::thread([&, showProgress]() {
+				unsigned int run = nextRun++;
+				RunReader* reader = NULL;
+				if (PIPELINE_RUNS && run < runs.size()) {
+					reader = openRun(MicroMegas, runs[run]);
+				}
+				while (run < runs.size()) {
+					{
+						std::unique_lock<std::mutex> lock(runProcessedMutex);
+						runWritten.wait(lock, [&]() {
+									return run < numberOfWrittenRuns + maxNumberOfContexts;
+								});
 					}
+
+					/*
+					 * Open the following run in the background while this one is processed
+					 */
+					const unsigned int next = nextRun++;
+					std::thread opener;
+					RunReader* nextReader = NULL;
+					if (PIPELINE_RUNS && next < runs.size()) {
+						opener = std::thread([&, next]() {
+							nextReader = openRun(MicroMegas, runs[next]);
+						});
+					}
+					if (reader == NULL) {
+						reader = openRun(MicroMegas, runs[run]);
+					}
+
+					std::cout << "Reading File " << run + 1 << " out of "
+							<< runs.size() << std::endl;
+					processRun(*reader, *contexts[run], showProgress);
+					delete reader;
+					reader = NULL;
+
+					{
+						std::lock_guard<std::mutex> lock(runProcessedMutex);
+						isRunProcessed[run] = true;
+						runProcessed.notify_all();
+					}
+
+					if (opener.joinable()) {
+						opener.join();
+					}
+					reader = nextReader;
+					run = next;
 				}
-				lastTime = eventTimes.at(e);
-			}
-			eventTimes.clear(); // clear vector for next measurement
+			}));
 		}
+	}
 
-		//delete m_event to clear cache
-		delete m_event;
+	for (unsigned int run = 0; run < runs.size(); run++) {
+		if (parallel) {
+			std::unique_lock<std::mutex> lock(runProcessedMutex);
+			runProcessed.wait(lock, [&]() {return isRunProcessed[run];});
+		} else {
+			std::cout << "Reading File " << run + 1 << " out of "
+					<< runs.size() << std::endl;
+			RunReader* reader = openRun(MicroMegas, runs[run]);
+			processRun(*reader, *contexts[run], true);
+			delete reader;
+		}
 
-		fileCombined->cd();
-		general_mapCombined["rate"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,
-				numberOfAcceptedEvents / lengthOfMeasurement);
-
-		global_mapCombined2D["RateByVAED"]->Fill(VD / MicroMegas.driftGap, VA,
-				numberOfAcceptedEvents / lengthOfMeasurement);
-
-		global_mapCombined2D["hitWidthYByVAED"]->Fill(VE, VA,
-				hitWidthFitResultsY->GetParameter(1));
-		global_mapCombined2D["hitWidthXByVAED"]->Fill(VE, VA,
-				hitWidthFitResultsX->GetParameter(1));
-		global_mapCombined2D["hitWidthByVAEDCounter"]->Fill(VE, VA, 1);
-
-		global_mapCombined2D["RateByVAEDCounter"]->Fill(
-				VD / MicroMegas.driftGap, VA, 1);
-
-		global_mapCombined2D["rateVsDriftGap"]->Fill(MicroMegas.getDriftGap(),
-				numberOfAcceptedEvents / lengthOfMeasurement);
-
-		general_mapCombined["chargeX"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
-				general_mapHist1D["mmchargex"]->GetMean());
-		general_mapCombined["chargeY"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
-				general_mapHist1D["mmchargey"]->GetMean());
-
-		general_mapCombined["chargeXfieldStrength"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
-				general_mapHist1D["mmchargex"]->GetMean());
-		general_mapCombined["chargeYfieldStrength"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
-				general_mapHist1D["mmchargey"]->GetMean());
-		general_mapCombined["chargeXuncut"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of X here*/
-				general_mapHist1D["mmchargexUncut"]->GetMean());
-		general_mapCombined["chargeYuncut"]->SetBinContent(
-				(VD - MicroMegas.driftStart) / MicroMegas.driftSteps + 1,
-				(VA - MicroMegas.ampStart) / MicroMegas.ampSteps + 1,/*insert charge of Y here*/
-				general_mapHist1D["mmchargexUncut"]->GetMean());
-
-		/// Saving Results
-		file0->cd();
-
-		/// loop over map of the plots for saving
-		for (map<string, TH1F*>::iterator iter = general_mapHist1D.begin();
-				iter != general_mapHist1D.end(); iter++) {
-			iter->second->SetOption("error");
-			iter->second->Write();
-			delete iter->second;
+		RunSummary summary;
+		if (!writeRun(MicroMegas, runs[run], *contexts[run], summary)) {
+			numberOfFailedRuns++;
 		}
-		for (map<string, TH2F*>::iterator iter = general_mapHist2D.begin();
-				iter != general_mapHist2D.end(); iter++) {
-			iter->second->SetOption("error");
-			iter->second->Write();
-			delete iter->second;
+		reportStageTimes(runs[run], *contexts[run]);
+		mergeRun(MicroMegas, summary, *contexts[run], fileCombined, graphs,
+				hitwidthsByEdbyVaByDgX, hitwidthsByEdbyVaByDgY);
+		delete contexts[run];
+		contexts[run] = NULL;
+
+		if (run + maxNumberOfContexts < runs.size()) {
+			bookContext(run + maxNumberOfContexts);
 		}
-		gDirectory->cd("..");
-		gDirectory->mkdir("Fits");
-		gDirectory->cd("Fits");
-		for (map<string, TH1F*>::iterator iter = general_mapPlotFit.begin();
-				iter != general_mapPlotFit.end(); iter++) {
-			iter->second->SetName(iter->first.c_str());
-			iter->second->Write();
-			delete iter->second;
-			general_mapPlotFit.erase(iter->first);
+		{
+			std::lock_guard<std::mutex> lock(runProcessedMutex);
+			numberOfWrittenRuns++;
 		}
-		gDirectory->cd("..");
-		gDirectory->mkdir("Trees");
-		gDirectory->cd("Trees");
-		for (map<string, TTree*>::iterator iter = general_mapTree.begin();
-				iter != general_mapTree.end(); iter++) {
-			iter->second->Write();
-			delete iter->second;
+		runWritten.notify_all();
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+/**
+ * Name of the partial file of a run with the given extension (".root" for the histograms, ".summary"
+ * for the RunSummary) written in the multi-process mode
+ */
+std::string getPartialFileName(const string& runName, std::string extension) {
+	std::stringstream name;
+	name << outPath << "partial/DG" << MapFile::driftGap << "/" << runName
+			<< extension;
+	return name.str();
+}
+
+/**
+ * Settings that change the results of a run, stored with its partial files. Merging partial files
+ * written with other settings would mix the results of different analyses.
+ */
+std::string getAnalysisSettings() {
+	std::stringstream settings;
+	settings << "estimator=" << HitEstimator::getName(HIT_ESTIMATOR_TYPE)
+			<< ",maxEvents=" << MAX_NUM_OF_EVENTS_TO_BE_PROCESSED
+			<< ",eventDisplays=" << CutStatistic::numberOfEventDisplays
+			<< ",threadsPerRun=" << NUMBER_OF_THREADS_PER_RUN;
+	return settings.str();
+}
+
+/**
+ * Reads the partial files of a run written by writePartialFiles. <context> must be empty.
+ */
+bool readPartialFiles(const string& runName, AnalysisContext& context,
+		RunSummary& summary) {
+	if (!summary.read(getPartialFileName(runName, ".summary"))) {
+		return false;
+	}
+
+	TFile* partialFile = TFile::Open(
+			getPartialFileName(runName, ".root").c_str());
+	if (partialFile == NULL || partialFile->IsZombie()) {
+		delete partialFile;
+		return false;
+	}
+	bool success = context.readPartial(partialFile);
+	partialFile->Close();
+	delete partialFile;
+	return success;
+}
+
+bool writePartialFiles(const string& runName, AnalysisContext& context,
+		const RunSummary& summary) {
+	std::stringstream directory;
+	directory << outPath << "partial/DG" << MapFile::driftGap;
+	gSystem->mkdir(directory.str().c_str(), kTRUE);
+
+	RunOutputFile partialFile(getPartialFileName(runName, ".root"));
+	if (!partialFile.isOpen()) {
+		return false;
+	}
+	context.writePartial(partialFile.get());
+	if (!partialFile.commit()) {
+		return false;
+	}
+
+	// written last: a run without summary is not merged
+	return summary.write(getPartialFileName(runName, ".summary"));
+}
+
+/**
+ * Processes, plots and writes a single run like writeRun and stores what mergeRun needs in the
+ * partial files of the run. The partial files of a previous analysis of the run are removed first,
+ * so that a failed run is never merged with old results.
+ */
+bool processRunToPartialFiles(MapFile& MicroMegas, const string& runName) {
+	std::remove(getPartialFileName(runName, ".summary").c_str());
+	std::remove(getPartialFileName(runName, ".root").c_str());
+
+	AnalysisContext context(general_mapCombined1D, general_mapCombined,
+			HIT_ESTIMATOR_TYPE);
+	context.seedEventDisplays(runName, 0);
+	bookRunHistograms(context);
+	RunReader* reader = openRun(MicroMegas, runName);
+	processRun(*reader, context, true);
+	delete reader;
+
+	RunSummary summary;
+	const bool isWritten = writeRun(MicroMegas, runName, context, summary);
+	reportStageTimes(runName, context);
+	if (!isWritten) {
+		return false;
+	}
+	summary.settings = getAnalysisSettings();
+	return writePartialFiles(runName, context, summary);
+}
+
+/**
+ * Multi-process mode: every run is processed, plotted and written by a forked child process, at
+ * most NUMBER_OF_PROCESSES at the same time. ROOT's global state (gDirectory, gStyle, the list of
+ * files...) is never shared between concurrently running analyses this way. The children report
+ * via partial files (see writePartialFiles) and their output goes to <outPath>logs/.
+ *
+ * Returns for every run whether its child process was successful.
+ */
+std::vector<bool> processRunsInChildProcesses(MapFile& MicroMegas,
+		const std::vector<string>& runs) {
+	std::stringstream logDirectory;
+	logDirectory << outPath << "logs/";
+	gSystem->mkdir(logDirectory.str().c_str(), kTRUE);
+
+	/*
+	 * Nothing may be rendered while forking: a child would inherit whatever the rendering thread has
+	 * locked at that moment
+	 */
+	PdfRenderQueue::getInstance().flush();
+
+	std::vector<bool> isRunProcessed(runs.size(), false);
+	std::map<pid_t, unsigned int> runOfChild;
+	unsigned int nextRun = 0;
+	while (nextRun < runs.size() || !runOfChild.empty()) {
+		if (nextRun < runs.size() && runOfChild.size() < NUMBER_OF_PROCESSES) {
+			const unsigned int run = nextRun++;
+			const string& runName = runs[run];
+
+			std::stringstream logFileName;
+			logFileName << logDirectory.str() << "DG" << MapFile::driftGap << "-"
+					<< runName << ".log";
+			std::cout << "Processing run " << runName << " (" << run + 1
+					<< " out of " << runs.size() << ") in a new process, see "
+					<< logFileName.str() << std::endl;
+
+			std::cout.flush();
+			std::cerr.flush();
+			fflush(NULL);
+			pid_t pid = fork();
+			if (pid == 0) {
+				int logFile = open(logFileName.str().c_str(),
+						O_WRONLY | O_CREAT | O_TRUNC, 0644);
+				if (logFile >= 0) {
+					dup2(logFile, STDOUT_FILENO);
+					dup2(logFile, STDERR_FILENO);
+					close(logFile);
+				}
+
+				// the rendering thread of the parent does not exist in the child
+				PdfRenderQueue::getInstance().setAsynchronous(false);
+
+				// only the times of this run, not the ones of the parent up to the fork
+				campaignStageTimes.reset();
+				StageTimer::getThreadTimes().reset();
+				bool success = processRunToPartialFiles(MicroMegas, runName);
+				printStageTimesAndCounters("the process of run " + runName);
+
+				/*
+				 * _exit skips the atexit handlers: ROOT would close (and write) the files inherited
+				 * from the parent otherwise
+				 */
+				std::cout.flush();
+				std::cerr.flush();
+				fflush(NULL);
+				_exit(success ? 0 : 1);
+			} else if (pid < 0) {
+				std::cerr << "Unable to fork process for run " << runName
+						<< ": " << strerror(errno) << std::endl;
+				continue;
+			}
+			runOfChild[pid] = run;
+			continue;
 		}
-		file0->Close();
 
-		//end of processing of one run
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			std::cerr << "waitpid failed: " << strerror(errno) << std::endl;
+			break;
+		}
+		std::map<pid_t, unsigned int>::iterator child = runOfChild.find(pid);
+		if (child == runOfChild.end()) {
+			continue;
+		}
+		const unsigned int run = child->second;
+		isRunProcessed[run] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if (!isRunProcessed[run]) {
+			std::cerr << "Processing of run " << runs[run]
+					<< " failed, see the log file" << std::endl;
+		}
+		runOfChild.erase(child);
+	}
+	return isRunProcessed;
+}
+
+/**
+ * Shard mode (--shard i/N): processes the runs of all drift gaps (including the duck run) that
+ * belong to shard i into partial files without creating any combined output. The runs are numbered
+ * through the whole campaign in the order they are processed otherwise and shard i processes every
+ * run with i == number % N, so that every shard gets a mix of long and short drift gaps. The
+ * combined results are created afterwards by running once with the argument "merge".
+ */
+void processShard() {
+	std::vector<double> driftGaps = runCatalogue.getDriftGaps();
+	driftGaps.push_back(RunCatalogue::DUCK_RUNS);
+
+	unsigned int runNumber = 0;
+	for (auto& driftGap : driftGaps) {
+		MapFile MicroMegas(runCatalogue, INPUT_PATH, outPath, appendName, driftGap);
+		bookCombinedHistograms(MicroMegas);
+
+		std::vector<string> runs;
+		for (auto& run : getRunsToProcess(MicroMegas)) {
+			if (runNumber++ % NUMBER_OF_SHARDS == SHARD_INDEX) {
+				runs.push_back(run);
+			}
+		}
+
+		if (NUMBER_OF_PROCESSES > 1) {
+			for (bool isRunProcessed : processRunsInChildProcesses(MicroMegas,
+					runs)) {
+				if (!isRunProcessed) {
+					numberOfFailedRuns++;
+				}
+			}
+		} else {
+			for (auto& run : runs) {
+				std::cout << "Processing run " << run << " of drift gap "
+						<< driftGap << std::endl;
+				if (!processRunToPartialFiles(MicroMegas, run)) {
+					std::cerr << "Unable to write the partial files of run "
+							<< run << std::endl;
+					numberOfFailedRuns++;
+				}
+			}
+		}
+
+		general_mapCombined.deleteAll();
+		general_mapCombined1D.deleteAll();
+	}
+}
+
+// Main Program
+void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
+		std::vector<double>& averageHitwidthsY,
+		std::vector<double>& averageHitwidthsXError,
+		std::vector<double>& averageHitwidthsYError,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgX,
+		std::map<double/*ED*/,
+				std::map<int/*VA*/,
+						std::map<double/*DG*/,
+								std::pair<double/*HitWIDTHs*/, double/*Error*/>>>>& hitwidthsByEdbyVaByDgY) {
+
+	for (auto& cutStat : CutStatistic::instances) {
+		cutStat->reset();
+	}
+
+//initialize file and histograms for combined output of all runs
+	std::stringstream combinedFileName;
+	combinedFileName << outPath << MicroMegas.getDriftGap()
+			<< combinedPlotsFile;
+
+	TFile* fileCombined = new TFile(combinedFileName.str().c_str(),
+			(Option_t*) "RECREATE");
+	bookCombinedHistograms(MicroMegas);
+
+	std::vector<string> runs = getRunsToProcess(
+			MicroMegas);
+
+	/*
+	 * Data for graphs to plot the fit width vs the value of VD for every run
+	 */
+	HitWidthGraphData graphs;
+
+	if (MERGE_PARTIAL_FILES_ONLY || NUMBER_OF_PROCESSES > 1) {
+		std::vector<bool> isRunProcessed(runs.size(), true);
+		if (!MERGE_PARTIAL_FILES_ONLY) {
+			isRunProcessed = processRunsInChildProcesses(MicroMegas, runs);
+		}
+
+		for (unsigned int run = 0; run < runs.size(); run++) {
+			if (!isRunProcessed[run]) {
+				numberOfFailedRuns++;
+				continue;
+			}
+			AnalysisContext context(general_mapCombined1D, general_mapCombined,
+					HIT_ESTIMATOR_TYPE);
+			RunSummary summary;
+			if (!readPartialFiles(runs[run], context, summary)) {
+				std::cerr << "Unable to read the partial files of run "
+						<< runs[run] << std::endl;
+				numberOfFailedRuns++;
+				continue;
+			}
+			if (summary.settings != getAnalysisSettings()) {
+				std::cerr << "The partial files of run " << runs[run]
+						<< " were written with the settings " << summary.settings
+						<< " instead of " << getAnalysisSettings()
+						<< ", not merged" << std::endl;
+				numberOfFailedRuns++;
+				continue;
+			}
+			mergeRun(MicroMegas, summary, context, fileCombined, graphs,
+					hitwidthsByEdbyVaByDgX, hitwidthsByEdbyVaByDgY);
+		}
+	} else {
+		processRunsInThreads(MicroMegas, runs, fileCombined, graphs,
+				hitwidthsByEdbyVaByDgX, hitwidthsByEdbyVaByDgY);
 	}
 
 	/*
 	 * Store the average hit widths of all runs with the current driftGap
 	 */
-	averageHitwidthsX.push_back(general_mapCombined1D["hitWidthX"]->GetMean());
+	averageHitwidthsX.push_back(general_mapCombined1D[CombinedHist1D::hitWidthX]->GetMean());
 	averageHitwidthsXError.push_back(
-			general_mapCombined1D["hitWidthX"]->GetMeanError());
-	averageHitwidthsY.push_back(general_mapCombined1D["hitWidthY"]->GetMean());
+			general_mapCombined1D[CombinedHist1D::hitWidthX]->GetMeanError());
+	averageHitwidthsY.push_back(general_mapCombined1D[CombinedHist1D::hitWidthY]->GetMean());
 	averageHitwidthsYError.push_back(
-			general_mapCombined1D["hitWidthY"]->GetMeanError());
+			general_mapCombined1D[CombinedHist1D::hitWidthY]->GetMeanError());
 
 	/*
 	 * Print cut statistics
@@ -913,14 +1759,13 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 
 //save combined plots
 	fileCombined->cd();
-	for (map<string, TH2F*>::iterator iter = general_mapCombined.begin();
-			iter != general_mapCombined.end(); iter++) {
+	for (auto& histogram : general_mapCombined) {
 		std::stringstream subfolder;
 		subfolder << MicroMegas.driftGap;
-		writeTH2FToPdf(iter->second, subfolder.str(), "colz");
-		iter->second->Write();
-		delete iter->second;
+		writeTH2FToPdf(histogram, subfolder.str(), "colz");
+		histogram->Write();
 	}
+	general_mapCombined.deleteAll();
 
 	// Draw event displays for all cut states
 	if (DRAW_CUT_EVENT_DISPLAYS) {
@@ -944,10 +1789,14 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 
 				gDirectory->mkdir("Cut");
 				gDirectory->cd("Cut");
-				for (auto& display : cutStat->eventDisplaysCut) {
-					display->Write();
-					writeTH2FToPdf(display, subdir.str() + "cut", "colz");
-					delete display;
+				for (auto& snapshot : cutStat->eventDisplaysCut) {
+					TH2F *displayX, *displayY;
+					snapshot.createHistograms(displayX, displayY);
+					for (TH2F* display : { displayX, displayY }) {
+						display->Write();
+						writeTH2FToPdf(display, subdir.str() + "cut", "colz");
+						delete display;
+					}
 				}
 				cutStat->eventDisplaysCut.clear();
 				gDirectory->cd("..");
@@ -955,10 +1804,14 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 			{
 				gDirectory->mkdir("Accepted");
 				gDirectory->cd("Accepted");
-				for (auto& display : cutStat->eventDisplaysAccepted) {
-					display->Write();
-					writeTH2FToPdf(display, subdir.str() + "accepted", "colz");
-					delete display;
+				for (auto& snapshot : cutStat->eventDisplaysAccepted) {
+					TH2F *displayX, *displayY;
+					snapshot.createHistograms(displayX, displayY);
+					for (TH2F* display : { displayX, displayY }) {
+						display->Write();
+						writeTH2FToPdf(display, subdir.str() + "accepted", "colz");
+						delete display;
+					}
 				}
 				cutStat->eventDisplaysAccepted.clear();
 				gDirectory->cd("..");
@@ -971,18 +1824,17 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 	/*
 	 * Write every TH1F to the file and to pdf
 	 */
-	for (map<string, TH1F*>::iterator iter = general_mapCombined1D.begin();
-			iter != general_mapCombined1D.end(); iter++) {
-		iter->second->Write();
+	for (auto& histogram : general_mapCombined1D) {
+		histogram->Write();
 
 		/*
 		 * write PDF
 		 */
 		stringstream subfolder;
 		subfolder << MicroMegas.driftGap;
-		writeToPdf<TH1F>(iter->second, subfolder.str(), "colz");
-		delete iter->second;
+		writeToPdf<TH1F>(histogram, subfolder.str(), "colz");
 	}
+	general_mapCombined1D.deleteAll();
 
 	/*
 	 * Fit and write the graphs
@@ -990,33 +1842,35 @@ void readFiles(MapFile MicroMegas, std::vector<double>& averageHitwidthsX,
 	fileCombined->mkdir("Graphs");
 	fileCombined->cd("Graphs");
 	std::set<int> allVAs, allVDs; // TreeSet to make every entry stored only once
-	allVAs.insert(VAsForGraphsX.begin(), VAsForGraphsX.end());
-	allVDs.insert(VDsForGraphsX.begin(), VDsForGraphsX.end());
+	allVAs.insert(graphs.VAsForGraphsX.begin(),
+			graphs.VAsForGraphsX.end());
+	allVDs.insert(graphs.VDsForGraphsX.begin(),
+			graphs.VDsForGraphsX.end());
 
 	for (int VA : allVAs) {
 		std::stringstream name;
 		name << "hitWidthVsVDX-VA" << VA;
-		plotHitWidthGraph(name.str(), "VD [V]", VDsForGraphsX, hitWidthsX,
-				hitWidthsXErrors, VAsForGraphsX, VA, MicroMegas.driftGap,
-				20 * MicroMegas.driftGap, 2000); // Skip first bin as it's bad!
+		plotHitWidthGraph(name.str(), "VD [V]", graphs.VDsForGraphsX,
+				graphs.hitWidthsX, graphs.hitWidthsXErrors, graphs.VAsForGraphsX,
+				VA, MicroMegas.driftGap, 20 * MicroMegas.driftGap, 2000); // Skip first bin as it's bad!
 		name.str("");
 		name << "hitWidthVsVDY-VA" << VA;
-		plotHitWidthGraph(name.str(), "VD [V]", VDsForGraphsY, hitWidthsY,
-				hitWidthsYErrors, VAsForGraphsY, VA, MicroMegas.driftGap,
-				20 * MicroMegas.driftGap, 2000); // Skip first bin as it's bad!
+		plotHitWidthGraph(name.str(), "VD [V]", graphs.VDsForGraphsY,
+				graphs.hitWidthsY, graphs.hitWidthsYErrors, graphs.VAsForGraphsY,
+				VA, MicroMegas.driftGap, 20 * MicroMegas.driftGap, 2000); // Skip first bin as it's bad!
 	}
 
 	for (int VD : allVDs) {
 		std::stringstream name;
 		name << "hitWidthVsVAX-VD" << VD;
-		plotHitWidthGraph(name.str(), "VA [V]", VAsForGraphsX, hitWidthsX,
-				hitWidthsXErrors, VDsForGraphsX, VD, MicroMegas.driftGap, 0,
-				1000);
+		plotHitWidthGraph(name.str(), "VA [V]", graphs.VAsForGraphsX,
+				graphs.hitWidthsX, graphs.hitWidthsXErrors, graphs.VDsForGraphsX,
+				VD, MicroMegas.driftGap, 0, 1000);
 		name.str("");
 		name << "hitWidthVsVAY-VD" << VD;
-		plotHitWidthGraph(name.str(), "VA [V]", VAsForGraphsY, hitWidthsY,
-				hitWidthsYErrors, VDsForGraphsY, VD, MicroMegas.driftGap, 0,
-				1000);
+		plotHitWidthGraph(name.str(), "VA [V]", graphs.VAsForGraphsY,
+				graphs.hitWidthsY, graphs.hitWidthsYErrors, graphs.VDsForGraphsY,
+				VD, MicroMegas.driftGap, 0, 1000);
 	}
 
 	fileCombined->Close();
@@ -1067,15 +1921,237 @@ void initialize() {
 }
 // Main Program
 int main(int argc, char *argv[]) {
+	for (int i = 1; i < argc; i++) {
+		std::string argument(argv[i]);
+		if (argument.find("--estimator=") == 0) {
+			if (!HitEstimator::getTypeByName(
+					argument.substr(std::string("--estimator=").size()),
+					HIT_ESTIMATOR_TYPE)) {
+				std::cerr << "Unknown estimator in " << argument
+						<< " (use cog, 3point, wls or minuit)" << std::endl;
+				return 1;
+			}
+		} else if (argument.find("--jobs=") == 0) {
+			int jobs = atoi(
+					argument.substr(std::string("--jobs=").size()).c_str());
+			if (jobs < 1) {
+				std::cerr << "Invalid number of jobs in " << argument
+						<< std::endl;
+				return 1;
+			}
+			NUMBER_OF_PARALLEL_RUNS = jobs;
+		} else if (argument.find("--processes=") == 0) {
+			int processes = atoi(
+					argument.substr(std::string("--processes=").size()).c_str());
+			if (processes < 1) {
+				std::cerr << "Invalid number of processes in " << argument
+						<< std::endl;
+				return 1;
+			}
+			NUMBER_OF_PROCESSES = processes;
+		} else if (argument.find("--prefetch=") == 0) {
+			int events = atoi(
+					argument.substr(std::string("--prefetch=").size()).c_str());
+			if (events < 0) {
+				std::cerr << "Invalid number of events in " << argument
+						<< std::endl;
+				return 1;
+			}
+			PREFETCHED_EVENTS = events;
+		} else if (argument.find("--cache-size=") == 0) {
+			int megaBytes = atoi(
+					argument.substr(std::string("--cache-size=").size()).c_str());
+			if (megaBytes < 0) {
+				std::cerr << "Invalid cache size in " << argument << std::endl;
+				return 1;
+			}
+			TREE_CACHE_SIZE = (Long64_t) megaBytes * 1024 * 1024;
+		} else if (argument.find("--cache-learn-entries=") == 0) {
+			int entries = atoi(
+					argument.substr(std::string("--cache-learn-entries=").size()).c_str());
+			if (entries < 1) {
+				std::cerr << "Invalid number of entries in " << argument
+						<< std::endl;
+				return 1;
+			}
+			TREE_CACHE_LEARN_ENTRIES = entries;
+		} else if (argument.find("--event-displays=") == 0) {
+			int displays = atoi(
+					argument.substr(std::string("--event-displays=").size()).c_str());
+			if (displays < 0) {
+				std::cerr << "Invalid number of event displays in " << argument
+						<< std::endl;
+				return 1;
+			}
+			CutStatistic::setNumberOfEventDisplays(displays);
+		} else if (argument.find("--max-events=") == 0) {
+			int events = atoi(
+					argument.substr(std::string("--max-events=").size()).c_str());
+			if (events < 1) {
+				std::cerr << "Invalid number of events in " << argument
+						<< std::endl;
+				return 1;
+			}
+			MAX_NUM_OF_EVENTS_TO_BE_PROCESSED = events;
+		} else if (argument.find("--runs-per-drift-gap=") == 0) {
+			int runs = atoi(
+					argument.substr(std::string("--runs-per-drift-gap=").size()).c_str());
+			if (runs < 1) {
+				std::cerr << "Invalid number of runs in " << argument
+						<< std::endl;
+				return 1;
+			}
+			MAX_NUM_OF_RUNS_TO_BE_PROCESSED = runs;
+		} else if (argument.find("--benchmark=") == 0) {
+			BENCHMARK_FILE = argument.substr(std::string("--benchmark=").size());
+		} else if (argument.find("--threads-per-run=") == 0) {
+			int threads = atoi(
+					argument.substr(std::string("--threads-per-run=").size()).c_str());
+			if (threads < 1) {
+				std::cerr << "Invalid number of threads in " << argument
+						<< std::endl;
+				return 1;
+			}
+			NUMBER_OF_THREADS_PER_RUN = threads;
+		} else if (argument == "--shard" || argument.find("--shard=") == 0) {
+			std::string shard;
+			if (argument == "--shard") {
+				if (++i == argc) {
+					std::cerr << "Missing i/N after --shard" << std::endl;
+					return 1;
+				}
+				shard = argv[i];
+			} else {
+				shard = argument.substr(std::string("--shard=").size());
+			}
+			int index, numberOfShards;
+			char rest;
+			if (sscanf(shard.c_str(), "%d/%d%c", &index, &numberOfShards,
+					&rest) != 2 || numberOfShards < 1 || index < 0
+					|| index >= numberOfShards) {
+				std::cerr << "Invalid shard " << shard
+						<< " (use i/N with 0 <= i < N)" << std::endl;
+				return 1;
+			}
+			SHARD_INDEX = index;
+			NUMBER_OF_SHARDS = numberOfShards;
+		} else if (argument.find("--runs=") == 0) {
+			RUN_LIST_FILE = argument.substr(std::string("--runs=").size());
+		} else if (argument.find("--input-path=") == 0) {
+			INPUT_PATH = argument.substr(std::string("--input-path=").size());
+			if (!INPUT_PATH.empty() && INPUT_PATH[INPUT_PATH.size() - 1] != '/') {
+				INPUT_PATH += "/";
+			}
+		} else if (argument == "--no-pdf") {
+			PdfRenderQueue::getInstance().setEnabled(false);
+		} else if (argument == "--sync-pdf") {
+			ASYNCHRONOUS_PDF_RENDERING = false;
+		} else if (argument == "--pdf-per-run") {
+			PDF_PER_RUN = true;
+		} else if (argument == "--io-audit") {
+			PRINT_IO_AUDIT = true;
+		} else if (argument == "--cut-flow") {
+			PRINT_CUT_FLOW = true;
+		} else if (argument == "--perf-counters") {
+			PerfCounters::enable();
+		} else if (argument == "--no-pipeline") {
+			PIPELINE_RUNS = false;
+		} else if (argument == "--read-all-branches") {
+			STAGED_BRANCH_LOADING = false;
+		} else if (argument == "merge") {
+			MERGE_PARTIAL_FILES_ONLY = true;
+		} else {
+			std::cerr << "Unknown argument " << argument << std::endl;
+			return 1;
+		}
+	}
+	if (NUMBER_OF_SHARDS != 0 && MERGE_PARTIAL_FILES_ONLY) {
+		std::cerr << "--shard and merge can not be combined" << std::endl;
+		return 1;
+	}
+	if (!runCatalogue.load(RUN_LIST_FILE)) {
+		return 1;
+	}
+	std::cout << "Using hit estimator " << HitEstimator::getName(HIT_ESTIMATOR_TYPE)
+			<< std::endl;
+
+	if (MERGE_PARTIAL_FILES_ONLY) {
+		std::cout << "Merging the partial files in " << outPath << "partial/"
+				<< std::endl;
+		NUMBER_OF_PROCESSES = 1;
+		NUMBER_OF_PARALLEL_RUNS = 1;
+		NUMBER_OF_THREADS_PER_RUN = 1;
+	}
+	if (NUMBER_OF_PROCESSES > 1) {
+		std::cout << "Processing up to " << NUMBER_OF_PROCESSES
+				<< " runs in child processes" << std::endl;
+		NUMBER_OF_PARALLEL_RUNS = 1;
+	}
+	if (NUMBER_OF_PARALLEL_RUNS > 1 || NUMBER_OF_THREADS_PER_RUN > 1) {
+		std::cout << "Processing up to " << NUMBER_OF_PARALLEL_RUNS
+				<< " runs in parallel with " << NUMBER_OF_THREADS_PER_RUN
+				<< " threads per run" << std::endl;
+		ROOT::EnableThreadSafety();
+	}
+	if (NUMBER_OF_SHARDS != 0 || MERGE_PARTIAL_FILES_ONLY
+			|| NUMBER_OF_PROCESSES > 1) {
+		PIPELINE_RUNS = false; // runs are only pipelined by processRunsInThreads
+	}
+	if (PIPELINE_RUNS) {
+		std::cout << "Processing the next run while writing the current one"
+				<< std::endl;
+		ROOT::EnableThreadSafety();
+	}
+	if (PREFETCHED_EVENTS != 0) {
+		std::cout << "Reading up to " << PREFETCHED_EVENTS
+				<< " events ahead in a background thread" << std::endl;
+		ROOT::EnableThreadSafety();
+	}
+	if (ASYNCHRONOUS_PDF_RENDERING) {
+		ROOT::EnableThreadSafety();
+	}
+	PdfRenderQueue::getInstance().setAsynchronous(ASYNCHRONOUS_PDF_RENDERING);
+	// All histograms are written explicitly, none of them must be owned by the current directory
+	TH1::AddDirectory(kFALSE);
+
 	if (MAX_NUM_OF_EVENTS_TO_BE_PROCESSED == -1) {
 		MAX_NUM_OF_EVENTS_TO_BE_PROCESSED = 1E6; // Reduce memory consumption (only reduces duck run)
 	}
 
+	if (!BENCHMARK_FILE.empty()) {
+		campaignBenchmark.addParameter("runList", RUN_LIST_FILE);
+		campaignBenchmark.addParameter("inputPath", INPUT_PATH);
+		campaignBenchmark.addParameter("estimator",
+				HitEstimator::getName(HIT_ESTIMATOR_TYPE));
+		campaignBenchmark.addParameter("maxEventsPerRun",
+				std::to_string(MAX_NUM_OF_EVENTS_TO_BE_PROCESSED));
+		campaignBenchmark.addParameter("runsPerDriftGap",
+				std::to_string(MAX_NUM_OF_RUNS_TO_BE_PROCESSED));
+		campaignBenchmark.addParameter("parallelRuns",
+				std::to_string(NUMBER_OF_PARALLEL_RUNS));
+		campaignBenchmark.addParameter("threadsPerRun",
+				std::to_string(NUMBER_OF_THREADS_PER_RUN));
+		campaignBenchmark.addParameter("processes",
+				std::to_string(NUMBER_OF_PROCESSES));
+		campaignBenchmark.addParameter("pdfOutput",
+				PdfRenderQueue::getInstance().isEnabled() ? "true" : "false");
+		campaignBenchmark.startTimer();
+	}
+
 	// create outputpath if it doesn't already exists
 	std::stringstream mkdir; 
 	mkdir << "mkdir -p " << outPath;
 	system(mkdir.str().c_str());
 
+	if (NUMBER_OF_SHARDS != 0) {
+		std::cout << "Processing shard " << SHARD_INDEX << " of "
+				<< NUMBER_OF_SHARDS << std::endl;
+		processShard();
+		PdfRenderQueue::getInstance().finish();
+		printCampaignStageTimes();
+		return numberOfFailedRuns == 0 ? 0 : 1;
+	}
+
 	// initialize global variables
 	initialize();
 
@@ -1095,13 +2171,13 @@ int main(int argc, char *argv[]) {
 					std::map<double/*DG*/,
 							std::pair<double/*HitWIDTHs*/, double/*Error*/>>>> hitwidthsByDggyVaByEdY;
 
-	std::vector<double> driftGaps = MapFile::getAvailableDriftGaps();
+	std::vector<double> driftGaps = runCatalogue.getDriftGaps();
 
 	/*
 	 * Run over all days (drift gaps)
 	 */
 	for (auto& driftGap : driftGaps) {
-		MapFile MicroMegas(inPath, outPath, appendName, driftGap);
+		MapFile MicroMegas(runCatalogue, INPUT_PATH, outPath, appendName, driftGap);
 		readFiles(MicroMegas, averageHitwidthsX, averageHitwidthsY,
 				averageHitwidthsXError, averageHitwidthsYError,
 				hitwidthsByDggyVaByEdX, hitwidthsByDggyVaByEdY);
@@ -1147,7 +2223,9 @@ int main(int argc, char *argv[]) {
 			hitwidthsByDggyVaByEdY);
 
 	fileCombined->cd();
-	gStyle->SetOptStat(0);
+	PdfRenderQueue::getInstance().run([]() {
+		gStyle->SetOptStat(0);
+	});
 	for (auto& pair : global_mapCombined2D) {
 		pair.second->SetOption("error");
 		pair.second->Write();
@@ -1162,8 +2240,18 @@ int main(int argc, char *argv[]) {
 	 * Duck run
 	 */
 	initialize();
-	MapFile MicroMegas(inPath, outPath, appendName, -1);
+	MapFile MicroMegas(runCatalogue, INPUT_PATH, outPath, appendName,
+			RunCatalogue::DUCK_RUNS);
 	readFiles(MicroMegas, averageHitwidthsX, averageHitwidthsY,
 			averageHitwidthsXError, averageHitwidthsYError,
 			hitwidthsByDggyVaByEdX, hitwidthsByDggyVaByEdY);
+	PdfRenderQueue::getInstance().finish();
+	printCampaignStageTimes();
+
+	if (numberOfFailedRuns != 0) {
+		std::cerr << numberOfFailedRuns << " runs could not be processed"
+				<< std::endl;
+		return 1;
+	}
+	return 0;
 }
@@ -3,7 +3,21 @@
 
 #include "CCommonIncludes.h"
 #include "CutStatistic.h"
+#include "EventDisplaySnapshot.h"
+#include "FastHistogram.h"
 #include "MapFile.h"
+#include "MMEventView.h"
+#include "ChargeMatrix.h"
+#include "IoAudit.h"
+#include "SimdKernels.h"
+#include "StageTimer.h"
+
+#include <TTreeCache.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 using namespace std;
 
@@ -36,12 +50,40 @@ public:
 		m_tchain = new TChain(Tree_Name.c_str());
 		for (unsigned int i = 0; i < vecFilenames.size(); i++) {
 			m_tchain->Add(vecFilenames[i].c_str());
-			m_tchain->AddFriend("data", vecFilenames[i].c_str());
 		}
 
 		cleanVariables();
 		addBranches();
+
+		/*
+		 * The tree "data" of the same files used to be added as friend for every file. TTree
+		 * finds every branch in the raw tree first, so the friend only opened every file a second
+		 * time. It is only added if the raw tree really lacks one of the branches.
+		 */
+		if (!vecFilenames.empty()
+				&& !hasAllBranches(vecFilenames[0], Tree_Name)) {
+			cout << "[MMQuickEvent] Reading missing branches from tree data"
+					<< endl;
+			for (unsigned int i = 0; i < vecFilenames.size(); i++) {
+				m_tchain->AddFriend("data", vecFilenames[i].c_str());
+			}
+		}
+		setStagedReading(true);
 		m_actEventNumber = 0;
+		m_firstEvent = 0;
+		m_showProgress = true;
+		m_chargesLoaded = false;
+		m_localEntry = -1;
+		m_treeNumber = -1;
+		m_cacheSize = -1;
+		m_cacheLearnEntries = 0;
+		m_prefetchRingSize = 0;
+		m_prefetchHead = 0;
+		m_prefetchedEvents = 0;
+		m_isHoldingPrefetchedEvent = false;
+		m_isPrefetchingDone = false;
+		m_stopPrefetching = false;
+		m_warmedUpEntry = -1;
 		m_NumberOfEvents = m_tchain->GetEntries();
 		if (NumberOfEvents != -1)
 			m_NumberOfEvents = NumberOfEvents;
@@ -59,31 +101,185 @@ public:
 		numberOfYHits = 0;
 	}
 
+	~MMQuickEvent() {
+		stopPrefetching();
+		delete m_tchain;
+		for (auto& prefetchedEvent : m_prefetchRing) {
+			delete prefetchedEvent;
+		}
+	}
+
 	bool getNextEvent() {
+		MM_TIME_STAGE(ENTRY_LOADING);
 		if (m_actEventNumber >= m_NumberOfEvents) {
-			cout << endl;
+			if (m_showProgress)
+				cout << endl;
+			stopPrefetching();
 			return false;
 		}
-		if (m_actEventNumber == 0)
-			cout << "[MMQuickEvent] Looping over Events" << endl;
-		if (m_actEventNumber % (m_NumberOfEvents / 100) == 0) {
-			cout << '\r' << "[MMQuickEvent] "
-					<< TMath::Nint(
-							m_actEventNumber / ((float) m_NumberOfEvents)
-									* 100.) << "% done (Event "
-					<< m_actEventNumber << "/" << m_NumberOfEvents << ")...";
-			cout.flush();
-		} else if (m_actEventNumber == m_NumberOfEvents - 1) {
-			cout << '\r' << "[MMQuickEvent] Done!                              "
-					<< std::endl;
-			cout.flush();
+		if (m_showProgress) {
+			printProgress();
+		}
+		if (m_prefetchRingSize != 0) {
+			return getNextPrefetchedEvent();
+		}
+		loadEntry(m_actEventNumber);
+		if (m_actEventNumber != m_warmedUpEntry) {
+			readBranches(CHEAP_BRANCH);
 		}
-		m_tchain->GetEvent(m_actEventNumber);
 		m_actEventNumber++;
 
+		m_chargesLoaded = false;
+		updateView();
+		if (!m_stagedReading) {
+			readBranches(UNUSED_BRANCH);
+			loadCharges();
+		}
 		return true;
 	}
 
+	/**
+	 * Reads apv_q and mm_strip of the current event if they have not been read yet. In the staged
+	 * mode getNextEvent only reads the small branches the first cuts need (apv_id, apv_qmax,
+	 * apv_tbqmax and the time) and everything accessing the charges of the strips calls this
+	 * method first. Most events are cut before, so their largest branches are never decompressed.
+	 */
+	void loadCharges() {
+		if (m_chargesLoaded) {
+			return;
+		}
+		MM_TIME_STAGE(ENTRY_LOADING);
+		readBranches(CHARGE_BRANCH);
+		m_chargeMatrix.load(*apv_q);
+		m_chargesLoaded = true;
+		updateView();
+	}
+
+	/**
+	 * If staged reading is switched off every branch is read by getNextEvent (as with
+	 * TTree::GetEntry), including the ones never used by the analysis. Otherwise the unused
+	 * branches are disabled so that the TTreeCache does not prefetch them either.
+	 */
+	void setStagedReading(bool stagedReading) {
+		m_stagedReading = stagedReading;
+		for (auto& branch : m_branches) {
+			if (branch.stage == UNUSED_BRANCH) {
+				m_tchain->SetBranchStatus(branch.name.c_str(), !stagedReading);
+			}
+		}
+	}
+
+	/**
+	 * Sets the size of the TTreeCache in bytes (0 disables it, -1 keeps ROOT's default) and the
+	 * number of entries used to learn which branches are read. The branches read by the analysis
+	 * are added to the cache in any case: in the staged mode most events never read the charges,
+	 * so the learning phase would miss them. Must be called before the first event is read.
+	 */
+	void setCache(Long64_t cacheSize, int learnEntries) {
+		m_cacheSize = cacheSize;
+		m_cacheLearnEntries = learnEntries;
+		if (m_cacheSize >= 0) {
+			m_tchain->SetCacheSize(m_cacheSize);
+		}
+		if (m_cacheLearnEntries > 0) {
+			m_tchain->SetCacheLearnEntries(m_cacheLearnEntries);
+		}
+	}
+
+	/**
+	 * Reads the events in a background thread into a ring of <ringSize> events while the caller
+	 * analyses the previous ones, so that reading and decompressing overlaps with the analysis
+	 * (0 switches it off). The reader thread has to read the charges of every event as it can not
+	 * know which ones will pass the cuts. Must be called before the first event is read.
+	 */
+	void setPrefetching(unsigned int ringSize) {
+		m_prefetchRingSize = ringSize;
+	}
+
+	/**
+	 * Starts reading before the first call of getNextEvent so that opening the files and reading the
+	 * first baskets overlaps with whatever the caller is still doing. With prefetching the reader
+	 * thread is started, otherwise the first file is opened and the small branches of the first event
+	 * are read (filling the TTreeCache with the first cluster). Must be called after the entry range
+	 * and the reading mode have been set.
+	 */
+	void warmUp() {
+		if (m_actEventNumber >= m_NumberOfEvents) {
+			return;
+		}
+		if (m_prefetchRingSize != 0) {
+			startPrefetching();
+			return;
+		}
+		loadEntry(m_actEventNumber);
+		readBranches(CHEAP_BRANCH);
+		m_warmedUpEntry = m_actEventNumber;
+	}
+
+	/**
+	 * Adds what has been read so far from each branch and each file to <audit>. Should be called
+	 * once after the last event.
+	 */
+	void addIoStatistics(IoAudit& audit) const {
+		IoAudit statistics;
+		for (auto& branch : m_branches) {
+			statistics.branches[branch.name] = branch.statistics;
+		}
+		statistics.files = m_fileStatistics;
+		if (m_treeNumber >= 0) {
+			statistics.files.push_back(getCurrentFileStatistics());
+		}
+		audit.add(statistics);
+	}
+
+	/**
+	 * Restricts the events returned by getNextEvent to the entries [firstEvent, lastEvent) of the
+	 * chain. Used to process one run with several readers, each reading its own part of the run.
+	 */
+	void setEntryRange(int firstEvent, int lastEvent) {
+		m_actEventNumber = firstEvent;
+		m_firstEvent = firstEvent;
+		m_NumberOfEvents = lastEvent;
+	}
+
+	/**
+	 * The progress bar is printed with carriage returns and is unreadable if several events are
+	 * processed concurrently, so the parallel mode switches it off
+	 */
+	void setShowProgress(bool showProgress) {
+		m_showProgress = showProgress;
+	}
+
+	/**
+	 * Returns a read-only view of the current event. The view points directly into the branch
+	 * buffers and is invalidated by the next call of getNextEvent()
+	 */
+	const MMEventView& getView() const {
+		return m_view;
+	}
+
+	/**
+	 * Makes the given strips the current event instead of an entry of the chain, for events
+	 * generated in memory (see SyntheticEventGenerator). The vectors are not copied and must not be
+	 * changed while the event is analysed. Only meant for an MMQuickEvent without files, reading
+	 * an entry would overwrite the vectors.
+	 */
+	void setEvent(std::vector<unsigned int>& ids,
+			std::vector<unsigned int>& strips,
+			std::vector<std::vector<short> >& charges, std::vector<short>& qmax,
+			std::vector<short>& tbqmax) {
+		apv_evt = 0;
+		time_s = 0;
+		time_us = 0;
+		apv_id = &ids;
+		mm_strip = &strips;
+		apv_q = &charges;
+		apv_qmax = &qmax;
+		apv_tbqmax = &tbqmax;
+		m_chargesLoaded = false;
+		updateView();
+	}
+
 	void cleanVariables() {
 		apv_fecNo = 0;
 		apv_id = 0;
@@ -105,21 +301,68 @@ public:
 		return m_actEventNumber;
 	}
 
+	/**
+	 * Prints the progress within the entry range (see setEntryRange) in steps of one percent, or of
+	 * one event if the range has less than 100 events
+	 */
+	void printProgress() {
+		const int numberOfProcessedEvents = m_actEventNumber - m_firstEvent;
+		const int numberOfEventsInRange = m_NumberOfEvents - m_firstEvent;
+		if (numberOfProcessedEvents == 0)
+			cout << "[MMQuickEvent] Looping over Events" << endl;
+		if (numberOfProcessedEvents == numberOfEventsInRange - 1) {
+			cout << '\r' << "[MMQuickEvent] Done!                              "
+					<< std::endl;
+			cout.flush();
+		} else if (numberOfProcessedEvents
+				% std::max(1, numberOfEventsInRange / 100) == 0) {
+			cout << '\r' << "[MMQuickEvent] "
+					<< TMath::Nint(
+							numberOfProcessedEvents / ((float) numberOfEventsInRange)
+									* 100.) << "% done (Event "
+					<< numberOfProcessedEvents << "/" << numberOfEventsInRange
+					<< ")...";
+			cout.flush();
+		}
+	}
+
+	/**
+	 * The branch vectors may be reallocated by ROOT while reading an entry so the spans have to be
+	 * renewed after every read. apv_q is not exposed directly but via the flat charge matrix which
+	 * is refilled by loadCharges. As long as the charges of the current event are not loaded,
+	 * apv_q and mm_strip are empty.
+	 */
+	void updateView() {
+		m_view.apv_evt = apv_evt;
+		m_view.time_s = time_s;
+		m_view.time_us = time_us;
+		m_view.apv_id = ConstSpan<unsigned int>(*apv_id);
+		if (m_chargesLoaded) {
+			m_view.mm_strip = ConstSpan<unsigned int>(*mm_strip);
+			m_view.apv_q = m_chargeMatrix.getView();
+		} else {
+			m_view.mm_strip = ConstSpan<unsigned int>();
+			m_view.apv_q = ChargeMatrixView();
+		}
+		m_view.apv_qmax = ConstSpan<short>(*apv_qmax);
+		m_view.apv_tbqmax = ConstSpan<short>(*apv_tbqmax);
+	}
+
 	void addBranches() {
-		m_tchain->SetBranchAddress("apv_evt", &apv_evt);
-		m_tchain->SetBranchAddress("time_s", &time_s);
-		m_tchain->SetBranchAddress("time_us", &time_us);
-		m_tchain->SetBranchAddress("apv_fecNo", &apv_fecNo);
-		m_tchain->SetBranchAddress("apv_id", &apv_id);
-		m_tchain->SetBranchAddress("apv_ch", &apv_ch);
-		m_tchain->SetBranchAddress("mm_id", &mm_id);
-		m_tchain->SetBranchAddress("mm_readout", &mm_readout);
-		m_tchain->SetBranchAddress("mm_strip", &mm_strip);
-		m_tchain->SetBranchAddress("apv_q", &apv_q);
-		m_tchain->SetBranchAddress("apv_presamples", &apv_presamples);
-
-		m_tchain->SetBranchAddress("apv_qmax", &apv_qmax);
-		m_tchain->SetBranchAddress("apv_tbqmax", &apv_tbqmax);
+		addBranch("apv_evt", &apv_evt, CHEAP_BRANCH);
+		addBranch("time_s", &time_s, CHEAP_BRANCH);
+		addBranch("time_us", &time_us, CHEAP_BRANCH);
+		addBranch("apv_fecNo", &apv_fecNo, UNUSED_BRANCH);
+		addBranch("apv_id", &apv_id, CHEAP_BRANCH);
+		addBranch("apv_ch", &apv_ch, UNUSED_BRANCH);
+		addBranch("mm_id", &mm_id, UNUSED_BRANCH);
+		addBranch("mm_readout", &mm_readout, UNUSED_BRANCH);
+		addBranch("mm_strip", &mm_strip, CHARGE_BRANCH);
+		addBranch("apv_q", &apv_q, CHARGE_BRANCH);
+		addBranch("apv_presamples", &apv_presamples, UNUSED_BRANCH);
+
+		addBranch("apv_qmax", &apv_qmax, CHEAP_BRANCH);
+		addBranch("apv_tbqmax", &apv_tbqmax, CHEAP_BRANCH);
 	}
 
 	// functions to select if hit is in X or Y according to APV ID and mapping while data acquisition
@@ -139,10 +382,280 @@ public:
 		}
 	}
 
+private:
+	/*
+	 * When a branch is read in the staged mode
+	 */
+	enum ReadStage {
+		CHEAP_BRANCH, // by getNextEvent
+		CHARGE_BRANCH, // by loadCharges
+		UNUSED_BRANCH // never
+	};
+
+	struct EventBranch {
+		std::string name;
+		ReadStage stage;
+		TBranch* branch; // branch of the current tree of the chain
+		int lastReadBasket;
+		BranchReadStatistics statistics;
+	};
+
+	template<typename T>
+	void addBranch(std::string name, T* address, ReadStage stage) {
+		m_tchain->SetBranchAddress(name.c_str(), address);
+		EventBranch branch = { name, stage, NULL, -1, BranchReadStatistics() };
+		m_branches.push_back(branch);
+	}
+
+	/**
+	 * Returns false if the tree <treeName> of the given file does not contain all branches read
+	 * by this class
+	 */
+	bool hasAllBranches(std::string fileName, std::string treeName) const {
+		TFile* file = TFile::Open(fileName.c_str());
+		if (file == NULL || file->IsZombie()) {
+			delete file;
+			return true; // the chain reports the error
+		}
+		TTree* tree = NULL;
+		file->GetObject(treeName.c_str(), tree);
+		bool hasAllBranches = true;
+		for (auto& branch : m_branches) {
+			if (tree == NULL || tree->GetBranch(branch.name.c_str()) == NULL) {
+				hasAllBranches = false;
+			}
+		}
+		file->Close();
+		delete file;
+		return hasAllBranches;
+	}
+
+	FileReadStatistics getCurrentFileStatistics() const {
+		FileReadStatistics statistics;
+		TFile* file = m_tchain->GetCurrentFile();
+		if (file == NULL) {
+			return statistics;
+		}
+		statistics.fileName = file->GetName();
+		statistics.bytesRead = file->GetBytesRead();
+		statistics.readCalls = file->GetReadCalls();
+		TTreeCache* cache = dynamic_cast<TTreeCache*>(file->GetCacheRead(
+				m_tchain->GetTree()));
+		if (cache != NULL) {
+			statistics.hasCache = true;
+			statistics.cacheHitRate = cache->GetEfficiencyRel();
+			statistics.cacheEfficiency = cache->GetEfficiency();
+		}
+		return statistics;
+	}
+
+	/**
+	 * The TBranch objects belong to the tree currently loaded by the chain and have to be looked
+	 * up again whenever the chain switches to the next file
+	 */
+	void updateBranchPointers() {
+		m_treeNumber = m_tchain->GetTreeNumber();
+		for (auto& branch : m_branches) {
+			branch.branch = m_tchain->GetTree()->GetBranch(branch.name.c_str());
+			branch.lastReadBasket = -1;
+			if (m_cacheSize != 0 && branch.stage != UNUSED_BRANCH) {
+				m_tchain->AddBranchToCache(branch.name.c_str(), kTRUE);
+			}
+		}
+	}
+
+	/**
+	 * Loads the tree containing <entry> without reading any branch
+	 */
+	void loadEntry(Long64_t entry) {
+		if (m_treeNumber >= 0
+				&& entry >= m_tchain->GetTreeOffset()[m_treeNumber + 1]) {
+			// the chain closes the current file when loading the next one
+			m_fileStatistics.push_back(getCurrentFileStatistics());
+		}
+		m_localEntry = m_tchain->LoadTree(entry);
+		if (m_tchain->GetTreeNumber() != m_treeNumber) {
+			updateBranchPointers();
+		}
+	}
+
+	/*
+	 * Copy of everything the analysis needs from one event, filled by the reader thread
+	 */
+	struct PrefetchedEvent {
+		UInt_t apv_evt;
+		Int_t time_s;
+		Int_t time_us;
+		vector<unsigned int> apv_id;
+		vector<unsigned int> mm_strip;
+		vector<short> apv_qmax;
+		vector<short> apv_tbqmax;
+		ChargeMatrix charges;
+	};
+
+	/**
+	 * Reader thread: reads the entries [firstEvent, lastEvent) into the ring. The branch vectors are
+	 * swapped into the ring instead of copied, ROOT refills whatever vector the branch points to.
+	 */
+	void prefetchEvents(int firstEvent, int lastEvent) {
+		for (int entry = firstEvent; entry < lastEvent; entry++) {
+			unsigned int slot;
+			{
+				std::unique_lock<std::mutex> lock(m_prefetchMutex);
+				m_prefetchSlotFreed.wait(lock, [this]() {
+					return m_stopPrefetching
+					|| m_prefetchedEvents < m_prefetchRingSize;
+				});
+				if (m_stopPrefetching) {
+					break;
+				}
+				slot = (m_prefetchHead + m_prefetchedEvents) % m_prefetchRingSize;
+			}
+
+			loadEntry(entry);
+			readBranches(CHEAP_BRANCH);
+			readBranches(CHARGE_BRANCH);
+			if (!m_stagedReading) {
+				readBranches(UNUSED_BRANCH);
+			}
+
+			PrefetchedEvent& event = *m_prefetchRing[slot];
+			event.apv_evt = apv_evt;
+			event.time_s = time_s;
+			event.time_us = time_us;
+			event.apv_id.swap(*apv_id);
+			event.mm_strip.swap(*mm_strip);
+			event.apv_qmax.swap(*apv_qmax);
+			event.apv_tbqmax.swap(*apv_tbqmax);
+			event.charges.load(*apv_q);
+
+			std::lock_guard<std::mutex> lock(m_prefetchMutex);
+			m_prefetchedEvents++;
+			m_prefetchSlotFilled.notify_one();
+		}
+
+		std::lock_guard<std::mutex> lock(m_prefetchMutex);
+		m_isPrefetchingDone = true;
+		m_prefetchSlotFilled.notify_one();
+	}
+
+	/**
+	 * getNextEvent with prefetching: releases the event returned last time and waits for the next
+	 * one. The reader thread is started with the first call.
+	 */
+	bool getNextPrefetchedEvent() {
+		startPrefetching();
+
+		PrefetchedEvent* event;
+		{
+			std::unique_lock<std::mutex> lock(m_prefetchMutex);
+			if (m_isHoldingPrefetchedEvent) {
+				m_prefetchHead = (m_prefetchHead + 1) % m_prefetchRingSize;
+				m_prefetchedEvents--;
+				m_isHoldingPrefetchedEvent = false;
+				m_prefetchSlotFreed.notify_one();
+			}
+			m_prefetchSlotFilled.wait(lock, [this]() {
+				return m_prefetchedEvents != 0 || m_isPrefetchingDone;
+			});
+			if (m_prefetchedEvents == 0) {
+				return false;
+			}
+			m_isHoldingPrefetchedEvent = true;
+			event = m_prefetchRing[m_prefetchHead];
+		}
+		m_actEventNumber++;
+
+		m_view.apv_evt = event->apv_evt;
+		m_view.time_s = event->time_s;
+		m_view.time_us = event->time_us;
+		m_view.apv_id = ConstSpan<unsigned int>(event->apv_id);
+		m_view.mm_strip = ConstSpan<unsigned int>(event->mm_strip);
+		m_view.apv_q = event->charges.getView();
+		m_view.apv_qmax = ConstSpan<short>(event->apv_qmax);
+		m_view.apv_tbqmax = ConstSpan<short>(event->apv_tbqmax);
+		m_chargesLoaded = true;
+		return true;
+	}
+
+	void startPrefetching() {
+		if (m_prefetchThread.joinable()) {
+			return;
+		}
+		for (unsigned int i = m_prefetchRing.size(); i < m_prefetchRingSize;
+				i++) {
+			m_prefetchRing.push_back(new PrefetchedEvent());
+		}
+		m_prefetchHead = 0;
+		m_prefetchedEvents = 0;
+		m_isHoldingPrefetchedEvent = false;
+		m_isPrefetchingDone = false;
+		m_stopPrefetching = false;
+		m_prefetchThread = std::thread(&MMQuickEvent::prefetchEvents, this,
+				m_actEventNumber, m_NumberOfEvents);
+	}
+
+	void stopPrefetching() {
+		if (!m_prefetchThread.joinable()) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_prefetchMutex);
+			m_stopPrefetching = true;
+			m_prefetchSlotFreed.notify_one();
+		}
+		m_prefetchThread.join();
+	}
+
+	void readBranches(ReadStage stage) {
+		for (auto& branch : m_branches) {
+			if (branch.stage != stage || branch.branch == NULL) {
+				continue;
+			}
+			branch.statistics.bytesRead += branch.branch->GetEntry(m_localEntry);
+
+			const int basket = branch.branch->GetReadBasket();
+			if (basket != branch.lastReadBasket) {
+				branch.statistics.compressedBytesRead +=
+						branch.branch->GetBasketBytes()[basket];
+				branch.statistics.basketsRead++;
+				branch.lastReadBasket = basket;
+			}
+		}
+	}
+
+	std::vector<EventBranch> m_branches;
+	std::vector<FileReadStatistics> m_fileStatistics; // of the files already closed by the chain
+	Long64_t m_cacheSize;
+	int m_cacheLearnEntries;
+
+	/*
+	 * Ring of prefetched events: m_prefetchedEvents events starting at m_prefetchHead are filled,
+	 * the one at the head is the current event if m_isHoldingPrefetchedEvent
+	 */
+	unsigned int m_prefetchRingSize;
+	std::vector<PrefetchedEvent*> m_prefetchRing;
+	unsigned int m_prefetchHead;
+	unsigned int m_prefetchedEvents;
+	bool m_isHoldingPrefetchedEvent;
+	bool m_isPrefetchingDone;
+	bool m_stopPrefetching;
+	std::thread m_prefetchThread;
+	std::mutex m_prefetchMutex;
+	std::condition_variable m_prefetchSlotFreed;
+	std::condition_variable m_prefetchSlotFilled;
+	bool m_stagedReading;
+	bool m_chargesLoaded;
+	Long64_t m_localEntry; // entry of the current event in the current tree of the chain
+	int m_warmedUpEntry; // entry whose small branches have already been read by warmUp
+	int m_treeNumber;
+
 public:
 	TChain *m_tchain;
 	int m_actEventNumber;
-	int m_NumberOfEvents;
+	int m_firstEvent; // first entry of the range set by setEntryRange
+	int m_NumberOfEvents; // end of the entry range
+	bool m_showProgress;
 
 	/// Event Information
 	// Declaration of leaf types
@@ -161,6 +674,9 @@ public:
 	vector<short> *apv_qmax;
 	vector<short> *apv_tbqmax;
 
+	ChargeMatrix m_chargeMatrix; // flat copy of apv_q, reused for every event
+	MMEventView m_view;
+
 	short maxChargeX;
 	int stripWithMaxChargeX;
 	int timeSliceOfMaxChargeX;
@@ -181,28 +697,31 @@ public:
 	 * Returns true if the neighbour strips of the strip with maximum charge are within a given range
 	 */
 	void generateFixedTimeCrossSections() {
+		loadCharges();
+		const MMEventView& event = m_view;
+
 		/*
 		 * Store the charge values of every strip number for the time section with
 		 * the maximum charge found in one event for X and Y separately (cross section
 		 * for time sections with max charge)
 		 */
-		stripAndChargeAtMaxChargeTimeX.clear();
-		stripAndChargeAtMaxChargeTimeY.clear();
-
-		const unsigned int numberOfStrips = (*apv_q).size();
-		// Iterate through all strips
-		for (unsigned int strip = 0; strip != numberOfStrips; strip++) {
-			unsigned int apvID = (*apv_id)[strip];
-			if (MMQuickEvent::isX(apvID)) { // X axis
-				stripAndChargeAtMaxChargeTimeX.push_back(
-						std::make_pair((*mm_strip)[strip]/*Strip number*/,
-								(*apv_q)[strip][timeSliceOfMaxChargeX]/*Charge*/));
-			} else { // Y axis
-				stripAndChargeAtMaxChargeTimeY.push_back(
-						std::make_pair((*mm_strip)[strip]/*Strip number*/,
-								(*apv_q)[strip][timeSliceOfMaxChargeY]/*Charge*/));
-			}
+		const unsigned int numberOfStrips = event.getNumberOfStrips();
+		stripAndChargeAtMaxChargeTimeX.resize(numberOfStrips);
+		stripAndChargeAtMaxChargeTimeY.resize(numberOfStrips);
+
+		// Gather the charges of all strips at the time section with maximum charge of their axis
+		unsigned int numberOfXStrips = 0;
+		unsigned int numberOfYStrips = 0;
+		if (numberOfStrips != 0) {
+			SimdKernels::gatherCrossSections(event.apv_id.data(),
+					event.mm_strip.data(), event.apv_q.data(),
+					event.apv_q.getStride(), numberOfStrips,
+					timeSliceOfMaxChargeX, timeSliceOfMaxChargeY,
+					&stripAndChargeAtMaxChargeTimeX[0], numberOfXStrips,
+					&stripAndChargeAtMaxChargeTimeY[0], numberOfYStrips);
 		}
+		stripAndChargeAtMaxChargeTimeX.resize(numberOfXStrips);
+		stripAndChargeAtMaxChargeTimeY.resize(numberOfYStrips);
 
 		// Sort cross section by absolute strip numbers (first entry in pairs)
 		std::sort(stripAndChargeAtMaxChargeTimeX.begin(),
@@ -215,8 +734,6 @@ public:
 		/*
 		 * Now the array is sorted, the position of the maximal charge strip is unknown -> search for it again
 		 */
-		const unsigned int numberOfXStrips =
-				stripAndChargeAtMaxChargeTimeX.size();
 		for (positionOfMaxChargeInCrossSectionX = 0;
 				positionOfMaxChargeInCrossSectionX != numberOfXStrips;
 				positionOfMaxChargeInCrossSectionX++) {
@@ -226,8 +743,6 @@ public:
 			}
 		}
 
-		const unsigned int numberOfYStrips =
-				stripAndChargeAtMaxChargeTimeY.size();
 		for (positionOfMaxChargeInCrossSectionY = 0;
 				positionOfMaxChargeInCrossSectionY != numberOfYStrips;
 				positionOfMaxChargeInCrossSectionY++) {
@@ -238,28 +753,34 @@ public:
 		}
 	}
 
-	void generateTimeShape(TH2F* histo, short maxCharge, int stripWithMaxCharge,
-			int timeSliceOfMaxCharge) {
+	void generateTimeShape(FastHistogram2D* histo, short maxCharge,
+			int stripWithMaxCharge, int timeSliceOfMaxCharge) {
+		loadCharges();
+		const MMEventView& event = m_view;
+
 		/*
 		 * Store the charge values of every strip number for the time section with
 		 * the maximum charge found in one event for X and Y separately (cross section
 		 * for time sections with max charge)
 		 */
-		const unsigned int numberOfTimeSlices = (*apv_q)[0].size();
+		const short* chargeOfTime = event.apv_q.row(stripWithMaxCharge);
+		const unsigned int numberOfTimeSlices =
+				event.apv_q.getNumberOfTimeSlices();
 		// Iterate through all strips
 		for (unsigned int time = 0; time != numberOfTimeSlices; time++) {
 			int distanceToMax = time - timeSliceOfMaxCharge;
 			if (distanceToMax != 0) {
 				double chargeProportion = 100
-									* (double) (*apv_q)[stripWithMaxCharge][time] / maxCharge;
+									* (double) chargeOfTime[time] / maxCharge;
 				histo->Fill(distanceToMax, chargeProportion);
 			}
 		}
 	}
 
-	bool runProportionCut(TH2F* maxNeighbourHisto,
-			vector<std::pair<int, short> > stripAndChargeAtMaxChargeTime,
-			short maxCharge, std::vector<std::pair<int, int> > proportionLimits,
+	bool runProportionCut(FastHistogram2D* maxNeighbourHisto,
+			const vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTime,
+			short maxCharge,
+			const std::vector<std::pair<int, int> >& proportionLimits,
 			CutStatistic& absolutePositionCuts, CutStatistic& proportionCuts,
 			bool lastProportionCut, int positionOfMaxCharge) {
 
@@ -348,7 +869,7 @@ public:
 	}
 
 	int calculateClusterSize(
-			vector<std::pair<unsigned int, short> > stripAndChargeAtMaxChargeTime,
+			const vector<std::pair<int, short> >& stripAndChargeAtMaxChargeTime,
 			int positionOfMaxCharge) {
 
 		int clusterStart = 0;
@@ -383,105 +904,65 @@ public:
 		return clusterEnd - clusterStart + 1;
 	}
 
-	void findMaxCharge() {
-
-		vector<unsigned int> apvIDofStrip = *apv_id; // isX(apvIDofStrip[i]) returns true if the i-th strip is X-layer
-		vector<unsigned int> stripNumShowingSignal = *mm_strip; // stripNumShowingSignal[i] is absolute strip number (strips without charge are not stored anywhere)
-		vector<vector<short> > chargeOfStripOfTime = *apv_q; // chargeOfStripOfTime[i][j] is the charge of strip i in time section j (matrix of whole event)
-		vector<short> maxChargeOfStrip = *apv_qmax; // maxChargeOfStrip[i] is the maxmimal measured charge of strip i of all time sections
-		vector<short> timeSliceOfMaxChargeOfStrip = *apv_tbqmax; // timeSliceOfMaxChargeOfStrip[i] is the time section of the corresponding maximum charge (see above)
-
-		maxChargeX = -1;
-		stripWithMaxChargeX = -1;
-		timeSliceOfMaxChargeX = -1;
-		maxChargeY = -1;
-		stripWithMaxChargeY = -1;
-		timeSliceOfMaxChargeY = -1;
-
-		numberOfXHits = -1;
-		numberOfYHits = -1;
+	void findMaxCharge(const MMEventView& event) {
 
 		/*
 		 * Iterate through all strips and check if it is X or Y data. Compare the maximum charge
 		 * of the strip with the maximum charge found so far for the current axis. Store current charge, strip number
 		 * and time section with the maximum charge if the current charge is larger than before.
+		 * (vectorized, see SimdKernels)
 		 */
-		const unsigned int numberOfStrips = maxChargeOfStrip.size();
-		for (unsigned int strip = 0; strip != numberOfStrips; strip++) {
-			unsigned int apvID = apvIDofStrip[strip];
-			if (isX(apvID)) { // X axis
-				numberOfXHits++;
-				if (maxChargeOfStrip[strip] > maxChargeX) {
-					maxChargeX = maxChargeOfStrip[strip];
-					stripWithMaxChargeX = strip;
-					timeSliceOfMaxChargeX = timeSliceOfMaxChargeOfStrip[strip];
-				}
-			} else { // Y axis
-				numberOfYHits++;
-				if (maxChargeOfStrip[strip] > maxChargeY) {
-					maxChargeY = maxChargeOfStrip[strip];
-					stripWithMaxChargeY = strip;
-					timeSliceOfMaxChargeY = timeSliceOfMaxChargeOfStrip[strip];
-				}
-			}
-		}
+		MaxChargeResult result;
+		SimdKernels::findMaxCharge(event.apv_id.data(), event.apv_qmax.data(),
+				event.apv_tbqmax.data(), event.getNumberOfStrips(), result);
+
+		maxChargeX = result.maxChargeX;
+		stripWithMaxChargeX = result.stripWithMaxChargeX;
+		timeSliceOfMaxChargeX = result.timeSliceOfMaxChargeX;
+		maxChargeY = result.maxChargeY;
+		stripWithMaxChargeY = result.stripWithMaxChargeY;
+		timeSliceOfMaxChargeY = result.timeSliceOfMaxChargeY;
+
+		numberOfXHits = result.numberOfXHits;
+		numberOfYHits = result.numberOfYHits;
 	}
 
 	/**
-	 * Generates a new 2D histogram (heatmap) showing all measured charges in all strips of x or y direction of all times sections.
-	 * The histogram will be stored at general_mapHist2DEvent[eventNumber+"nameOfHistogram"]
+	 * Replaces the content of <snapshot> by the charges of all strips of the current event for a
+	 * later event display (see EventDisplaySnapshot::createHistograms)
 	 */
-	void generateEventDisplay(TH2F* &eventDisplayX, TH2F* &eventDisplayY,
+	void takeEventDisplaySnapshot(EventDisplaySnapshot& snapshot,
 			std::string suffix = "") {
-		vector<vector<short> > chargeOfTimeOfStrip = *apv_q;
-		unsigned int numberOfTimeSlices = chargeOfTimeOfStrip[0].size();
-
-		/*
-		 * Generate a new 2D histogram for the event display (x=strip, y=timesection, z=charge)
-		 */
+		loadCharges();
+		const MMEventView& event = m_view;
 
-		// Generate the title of the histogram
-		stringstream histoName;
-		histoName.str("");
-		histoName << getCurrentEventNumber() << "-Eventdisplay";
+		const ChargeMatrixView& chargeOfStripOfTime = event.apv_q;
+		unsigned int numberOfTimeSlices =
+				chargeOfStripOfTime.getNumberOfTimeSlices();
 
-		string histoNameX = histoName.str() + "_X" + suffix;
-		string histoNameY = histoName.str() + "_Y" + suffix;
+		snapshot.eventNumber = getCurrentEventNumber();
+		snapshot.suffix = suffix;
+		snapshot.numberOfTimeSlices = numberOfTimeSlices;
+		snapshot.stripsX.clear();
+		snapshot.chargesX.clear();
+		snapshot.stripsY.clear();
+		snapshot.chargesY.clear();
 
 		/*
-		 * Initialize a new root TH2F histogram with the right title, labels and bining:
-		 *
+		 * Only fired strips are stored in the event, so each row of the charge matrix is appended
+		 * to the X or Y charges depending on the apvID
 		 */
-		eventDisplayX = new TH2F(histoNameX.c_str(),
-				";strip number; time [25 ns]; charge", xStrips, 0, xStrips - 1,
-				numberOfTimeSlices, 0, numberOfTimeSlices - 1);
-
-		eventDisplayY = new TH2F(histoNameY.c_str(),
-				";strip number; time [25 ns]; charge", yStrips, 0, yStrips - 1,
-				numberOfTimeSlices, 0, numberOfTimeSlices - 1);
-
-		/*
-		 * Fill eventDisplay with all measured charges at all strips for all times;
-		 * for all timeSlices, we iterate through all Strips (X and Y). Depending
-		 * on the apvID, the corresponding histogram is filled (X resp. Y).
-		 */
-		for (unsigned int timeSlice = 0; timeSlice != numberOfTimeSlices;
-				timeSlice++) {
-			for (unsigned int stripNum = 0;
-					stripNum != chargeOfTimeOfStrip.size(); stripNum++) {
-				short charge = chargeOfTimeOfStrip[stripNum][timeSlice];
-				unsigned int apvID = (*apv_id)[stripNum];
-				if (MMQuickEvent::isX(apvID)) {
-
-					// store charge of current strip in bin corresponding to absolute strip number
-					eventDisplayX->SetBinContent(
-							mm_strip->at(stripNum) + 1/*x*/, timeSlice + 1/*y*/,
-							charge/*z*/);
-				} else {
-					eventDisplayY->SetBinContent(
-							mm_strip->at(stripNum) + 1/*x*/, timeSlice + 1/*y*/,
-							charge/*z*/);
-				}
+		for (unsigned int stripNum = 0; stripNum != chargeOfStripOfTime.size();
+				stripNum++) {
+			const short* chargeOfTime = chargeOfStripOfTime.row(stripNum);
+			if (MMQuickEvent::isX(event.apv_id[stripNum])) {
+				snapshot.stripsX.push_back(event.mm_strip[stripNum]);
+				snapshot.chargesX.insert(snapshot.chargesX.end(), chargeOfTime,
+						chargeOfTime + numberOfTimeSlices);
+			} else {
+				snapshot.stripsY.push_back(event.mm_strip[stripNum]);
+				snapshot.chargesY.insert(snapshot.chargesY.end(), chargeOfTime,
+						chargeOfTime + numberOfTimeSlices);
 			}
 		}
 	}
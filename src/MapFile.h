@@ -3,7 +3,9 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <TH1.h>
 #include <TH2.h>
@@ -14,6 +16,8 @@
 #include <TLorentzVector.h>
 #include <TFile.h>
 
+#include "RunCatalogue.h"
+
 using namespace std;
 
 #define RUN_WITH_HIGHES_VAVD true
@@ -32,50 +36,24 @@ public:
 	static int ampEnd;
 	static int ampSteps;
 
-	static std::vector<double> getAvailableDriftGaps() {
-		std::vector<double> gaps;
-		gaps.push_back(4.5);
-		gaps.push_back(8.0);
-		gaps.push_back(10.5);
-		gaps.push_back(15.5);
-		return gaps;
-	}
-
 	/**
 	 * returns a vector storing at position N the minimal proportion of the N+1-th neighbour strip of the strip with the maximum charge
 	 *
 	 * 100*charge[max+d]/charge[max]>getMinimalMaxHitNeighbourProportion()[d-1]
 	 */
-	static std::vector<std::pair<int, int> > getProportionLimitsOfMaxHitNeighboursX() {
+	static const std::vector<std::pair<int, int> >& getProportionLimitsOfMaxHitNeighboursX() {
 		return neighbourStripeLimitsX;
 	}
 
-	static std::vector<std::pair<int, int> > getProportionLimitsOfMaxHitNeighboursY() {
+	static const std::vector<std::pair<int, int> >& getProportionLimitsOfMaxHitNeighboursY() {
 		return neighbourStripeLimitsY;
 	}
 
-	int getVDbyFileName(std::string fileName) {
-		/*
-		 * VD275VA500.root -> 3 digits
-		 * VD50VA550.root  -> 2 digits
-		 * VD1205VA500.root-> 4 digits
-		 */
-		int numberOfDigits = 3;
-		if (fileName.at(4) == 'V') {
-			numberOfDigits = 2;
-		} else if (fileName.at(6) == 'V') {
-			numberOfDigits = 4;
-		}
-		int vd = atoi(fileName.substr(2, numberOfDigits).c_str());
-
-		return vd;
-	}
-	int getVAbyFileName(std::string fileName) {
-		return atoi(fileName.substr(fileName.size() - 3, 3).c_str());
-	}
-
-private:
-	void createFile() {
+	/**
+	 * Sets the limits returned by getProportionLimitsOfMaxHitNeighboursX/Y. Called when the
+	 * MapFile is created, the benchmarks call it directly.
+	 */
+	static void setProportionLimits() {
 		neighbourStripeLimitsX.clear();
 		neighbourStripeLimitsY.clear();
 
@@ -87,247 +65,48 @@ private:
 		neighbourStripeLimitsY.push_back(std::make_pair(30, 100));
 		neighbourStripeLimitsY.push_back(std::make_pair(10, 90));
 		neighbourStripeLimitsY.push_back(std::make_pair(-5, 55));
+	}
 
-		// define driftgap specific parameters
-		if (driftGap == 4.5) {
-			driftStart = 50;
-			driftEnd = 350;
-			driftSteps = 75;
-			ampStart = 500;
-			ampEnd = 550;
-			ampSteps = 25;
-
-			m_mapFile["VD50VA500"] = new TFile(
-					(path + appendName + "_VD50VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD125VA500"] = new TFile(
-					(path + appendName + "_VD125VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD200VA500"] = new TFile(
-					(path + appendName + "_VD200VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD275VA500"] = new TFile(
-					(path + appendName + "_VD275VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD350VA500"] = new TFile(
-					(path + appendName + "_VD350VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD50VA525"] = new TFile(
-					(path + appendName + "_VD50VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD125VA525"] = new TFile(
-					(path + appendName + "_VD125VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD200VA525"] = new TFile(
-					(path + appendName + "_VD200VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD275VA525"] = new TFile(
-					(path + appendName + "_VD275VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD350VA525"] = new TFile(
-					(path + appendName + "_VD350VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD50VA550"] = new TFile(
-					(path + appendName + "_VD50VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD125VA550"] = new TFile(
-					(path + appendName + "_VD125VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD200VA550"] = new TFile(
-					(path + appendName + "_VD200VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD275VA550"] = new TFile(
-					(path + appendName + "_VD275VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			if (RUN_WITH_HIGHES_VAVD) {
-				m_mapFile["VD350VA550"] = new TFile(
-						(path + appendName + "_VD350VA550.root").c_str(),
-						(Option_t*) "RECREATE");
-			}
-		} else if (driftGap == 15.5) {
-// Zweiter Tag
-			driftStart = 172;
-			driftEnd = 1205;
-			driftSteps = 258;
-			ampStart = 500;
-			ampEnd = 550;
-			ampSteps = 25;
-
-			m_mapFile["VD172VA500"] = new TFile(
-					(path + appendName + "_VD172VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD430VA500"] = new TFile(
-					(path + appendName + "_VD430VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD688VA500"] = new TFile(
-					(path + appendName + "_VD688VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD947VA500"] = new TFile(
-					(path + appendName + "_VD947VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD1205VA500"] = new TFile(
-					(path + appendName + "_VD1205VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD172VA525"] = new TFile(
-					(path + appendName + "_VD172VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD430VA525"] = new TFile(
-					(path + appendName + "_VD430VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD688VA525"] = new TFile(
-					(path + appendName + "_VD688VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD947VA525"] = new TFile(
-					(path + appendName + "_VD947VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD1205VA525"] = new TFile(
-					(path + appendName + "_VD1205VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD172VA550"] = new TFile(
-					(path + appendName + "_VD172VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD430VA550"] = new TFile(
-					(path + appendName + "_VD430VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD688VA550"] = new TFile(
-					(path + appendName + "_VD688VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD947VA550"] = new TFile(
-					(path + appendName + "_VD947VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-		} else if (driftGap == 10.5) {
-			driftStart = 117;
-			driftEnd = 817;
-			driftSteps = 175;
-			ampStart = 500;
-			ampEnd = 550;
-			ampSteps = 25;
-
-			m_mapFile["VD117VA500"] = new TFile(
-					(path + appendName + "_VD117VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD292VA500"] = new TFile(
-					(path + appendName + "_VD292VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD467VA500"] = new TFile(
-					(path + appendName + "_VD467VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD642VA500"] = new TFile(
-					(path + appendName + "_VD642VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD817VA500"] = new TFile(
-					(path + appendName + "_VD817VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD117VA525"] = new TFile(
-					(path + appendName + "_VD117VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD292VA525"] = new TFile(
-					(path + appendName + "_VD292VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD467VA525"] = new TFile(
-					(path + appendName + "_VD467VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD642VA525"] = new TFile(
-					(path + appendName + "_VD642VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD817VA525"] = new TFile(
-					(path + appendName + "_VD817VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD117VA550"] = new TFile(
-					(path + appendName + "_VD117VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD292VA550"] = new TFile(
-					(path + appendName + "_VD292VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD467VA550"] = new TFile(
-					(path + appendName + "_VD467VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD642VA550"] = new TFile(
-					(path + appendName + "_VD642VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			if (RUN_WITH_HIGHES_VAVD) {
-				m_mapFile["VD817VA550"] = new TFile(
-						(path + appendName + "_VD817VA550.root").c_str(),
-						(Option_t*) "RECREATE");
-			}
-		} else if (driftGap == 8.0) {
-			driftStart = 89;
-			driftEnd = 622;
-			driftSteps = 133;
-			ampStart = 500;
-			ampEnd = 550;
-			ampSteps = 25;
+	int getVDbyFileName(std::string fileName) {
+		const CatalogueRun* run = catalogue->findRun(fileName);
+		return run == NULL ? 0 : run->VD;
+	}
+	int getVAbyFileName(std::string fileName) {
+		const CatalogueRun* run = catalogue->findRun(fileName);
+		return run == NULL ? 0 : run->VA;
+	}
 
+private:
+	/**
+	 * Adds a run to the list of runs. Its output file is only created when the run is written (see
+	 * RunOutputFile).
+	 */
+	void addRun(string runName) {
+		m_runNames.insert(runName);
+	}
 
-			m_mapFile["VD89VA500"] = new TFile(
-					(path + appendName + "_VD89VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA500"] = new TFile(
-					(path + appendName + "_VD222VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD355VA500"] = new TFile(
-					(path + appendName + "_VD355VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD488VA500"] = new TFile(
-					(path + appendName + "_VD488VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD622VA500"] = new TFile(
-					(path + appendName + "_VD622VA500.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD89VA525"] = new TFile(
-					(path + appendName + "_VD89VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA525"] = new TFile(
-					(path + appendName + "_VD222VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD355VA525"] = new TFile(
-					(path + appendName + "_VD355VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD488VA525"] = new TFile(
-					(path + appendName + "_VD488VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD622VA525"] = new TFile(
-					(path + appendName + "_VD622VA525.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD89VA550"] = new TFile(
-					(path + appendName + "_VD89VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA550"] = new TFile(
-					(path + appendName + "_VD222VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD355VA550"] = new TFile(
-					(path + appendName + "_VD355VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD488VA550"] = new TFile(
-					(path + appendName + "_VD488VA550.root").c_str(),
-					(Option_t*) "RECREATE");
-			if (RUN_WITH_HIGHES_VAVD) {
-				m_mapFile["VD622VA550"] = new TFile(
-						(path + appendName + "_VD622VA550.root").c_str(),
-						(Option_t*) "RECREATE");
-			}
-		} else if (driftGap == -1) {
-			driftStart = 89;
-			driftEnd = 622;
-			driftSteps = 133;
-			ampStart = 500;
-			ampEnd = 550;
-			ampSteps = 25;
+	void createFile() {
+		setProportionLimits();
 
-			m_mapFile["VD222VA525-run528"] = new TFile(
-					(path + appendName + "_VD222VA525-run528.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA525-run534"] = new TFile(
-					(path + appendName + "_VD222VA525-run534.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA525-run535"] = new TFile(
-					(path + appendName + "_VD222VA525-run535.root").c_str(),
-					(Option_t*) "RECREATE");
-			m_mapFile["VD222VA525-run536"] = new TFile(
-					(path + appendName + "_VD222VA525-run536.root").c_str(),
-					(Option_t*) "RECREATE");
-		} else {
+		// define driftgap specific parameters
+		VoltageRange range;
+		if (!catalogue->getVoltageRange(driftGap, range)) {
 			std::cerr << "Unknown driftgap" << driftGap << std::endl;
+		} else {
+			driftStart = range.driftStart;
+			driftEnd = range.driftEnd;
+			driftSteps = range.driftSteps;
+			ampStart = range.ampStart;
+			ampEnd = range.ampEnd;
+			ampSteps = range.ampSteps;
+
+			for (const CatalogueRun* run : catalogue->getRuns(driftGap)) {
+				if (!RUN_WITH_HIGHES_VAVD && run->VD == driftEnd
+						&& run->VA == ampEnd) {
+					continue;
+				}
+				addRun(run->name);
+			}
 		}
 		/*
 		 * Add more non-limiting entries to show more bins on the histogram later on
@@ -340,9 +119,12 @@ private:
 
 public:
 	/**
-	 * Constructor
+	 * Constructor, adding the runs of <_driftGap> in <catalogue> (RunCatalogue::DUCK_RUNS for the duck
+	 * runs)
 	 */
-	MapFile(string data_dir, string path, string appendName, double _driftGap) {
+	MapFile(const RunCatalogue& catalogue, string data_dir, string path,
+			string appendName, double _driftGap) {
+		this->catalogue = &catalogue;
 		this->data_dir = data_dir;
 		this->path = path;
 		this->appendName = appendName;
@@ -353,8 +135,15 @@ public:
 	~MapFile() {
 	}
 
-	map<string, TFile*> getFile() {
-		return m_mapFile;
+	/**
+	 * Names of the runs sorted alphabetically, the order in which they are processed
+	 */
+	vector<string> getRunNames() {
+		return vector<string>(m_runNames.begin(), m_runNames.end());
+	}
+
+	string getOutputFileName(string runName) {
+		return path + appendName + "_" + runName + ".root";
 	}
 
 	double getDriftGap() {
@@ -372,139 +161,21 @@ public:
 				<< "======================================================================"
 				<< endl;
 
-		if (type == "VD50VA500") {
-			vec_filename.push_back(data_dir + "run373.root");
-		} else if (type == "VD125VA500") {
-			vec_filename.push_back(data_dir + "run376.root");
-		} else if (type == "VD200VA500") {
-			vec_filename.push_back(data_dir + "run378.root");
-		} else if (type == "VD275VA500") {
-			vec_filename.push_back(data_dir + "run380.root");
-		} else if (type == "VD350VA500") {
-			vec_filename.push_back(data_dir + "run382.root");
-		} else if (type == "VD50VA525") {
-			vec_filename.push_back(data_dir + "run384.root");
-		} else if (type == "VD125VA525") {
-			vec_filename.push_back(data_dir + "run387.root");
-		} else if (type == "VD200VA525") {
-			vec_filename.push_back(data_dir + "run389.root");
-		} else if (type == "VD275VA525") {
-			vec_filename.push_back(data_dir + "run391.root");
-		} else if (type == "VD350VA525") {
-			vec_filename.push_back(data_dir + "run393.root");
-		} else if (type == "VD50VA550") {
-			vec_filename.push_back(data_dir + "run395.root");
-		} else if (type == "VD125VA550") {
-			vec_filename.push_back(data_dir + "run397.root");
-		} else if (type == "VD200VA550") {
-			vec_filename.push_back(data_dir + "run399.root");
-		} else if (type == "VD275VA550") {
-			vec_filename.push_back(data_dir + "run401.root");
-		} else if (type == "VD350VA550") {
-			vec_filename.push_back(data_dir + "run407.root");
-		} else if (type == "VD172VA500") {
-			vec_filename.push_back(data_dir + "run411.root");
-		} else if (type == "VD430VA500") {
-			vec_filename.push_back(data_dir + "run413.root");
-		} else if (type == "VD688VA500") {
-			vec_filename.push_back(data_dir + "run415.root");
-		} else if (type == "VD947VA500") {
-			vec_filename.push_back(data_dir + "run417.root");
-		} else if (type == "VD1205VA500") {
-			vec_filename.push_back(data_dir + "run419.root");
-		} else if (type == "VD172VA525") {
-			vec_filename.push_back(data_dir + "run424.root");
-		} else if (type == "VD430VA525") {
-			vec_filename.push_back(data_dir + "run426.root");
-		} else if (type == "VD688VA525") {
-			vec_filename.push_back(data_dir + "run428.root");
-		} else if (type == "VD947VA525") {
-			vec_filename.push_back(data_dir + "run430.root");
-		} else if (type == "VD1205VA525") {
-			vec_filename.push_back(data_dir + "run432.root");
-		} else if (type == "VD172VA550") {
-			vec_filename.push_back(data_dir + "run434.root");
-		} else if (type == "VD430VA550") {
-			vec_filename.push_back(data_dir + "run442.root");
-		} else if (type == "VD688VA550") {
-			vec_filename.push_back(data_dir + "run445.root");
-		} else if (type == "VD947VA550") {
-			vec_filename.push_back(data_dir + "run450.root");
-		} else if (type == "VD117VA500") {
-			vec_filename.push_back(data_dir + "run453.root");
-		} else if (type == "VD292VA500") {
-			vec_filename.push_back(data_dir + "run455.root");
-		} else if (type == "VD467VA500") {
-			vec_filename.push_back(data_dir + "run457.root");
-		} else if (type == "VD642VA500") {
-			vec_filename.push_back(data_dir + "run459.root");
-		} else if (type == "VD817VA500") {
-			vec_filename.push_back(data_dir + "run461.root");
-		} else if (type == "VD117VA525") {
-			vec_filename.push_back(data_dir + "run463.root");
-		} else if (type == "VD292VA525") {
-			vec_filename.push_back(data_dir + "run465.root");
-		} else if (type == "VD467VA525") {
-			vec_filename.push_back(data_dir + "run467.root");
-		} else if (type == "VD642VA525") {
-			vec_filename.push_back(data_dir + "run469.root");
-		} else if (type == "VD817VA525") {
-			vec_filename.push_back(data_dir + "run472.root");
-		} else if (type == "VD117VA550") {
-			vec_filename.push_back(data_dir + "run475.root");
-		} else if (type == "VD292VA550") {
-			vec_filename.push_back(data_dir + "run477.root");
-		} else if (type == "VD467VA550") {
-			vec_filename.push_back(data_dir + "run480.root");
-		} else if (type == "VD642VA550") {
-			vec_filename.push_back(data_dir + "run482.root");
-		} else if (type == "VD817VA550") {
-			vec_filename.push_back(data_dir + "run484.root");
-		} else if (type == "VD89VA500") {
-			vec_filename.push_back(data_dir + "run487.root");
-		} else if (type == "VD222VA500") {
-			vec_filename.push_back(data_dir + "run490.root");
-		} else if (type == "VD355VA500") {
-			vec_filename.push_back(data_dir + "run492.root");
-		} else if (type == "VD488VA500") {
-			vec_filename.push_back(data_dir + "run494.root");
-		} else if (type == "VD622VA500") {
-			vec_filename.push_back(data_dir + "run496.root");
-		} else if (type == "VD89VA525") {
-			vec_filename.push_back(data_dir + "run505.root");
-		} else if (type == "VD222VA525") {
-			vec_filename.push_back(data_dir + "run507.root");
-		} else if (type == "VD355VA525") {
-			vec_filename.push_back(data_dir + "run509.root");
-		} else if (type == "VD488VA525") {
-			vec_filename.push_back(data_dir + "run511.root");
-		} else if (type == "VD622VA525") {
-			vec_filename.push_back(data_dir + "run513.root");
-		} else if (type == "VD89VA550") {
-			vec_filename.push_back(data_dir + "run515.root");
-		} else if (type == "VD222VA550") {
-			vec_filename.push_back(data_dir + "run518.root");
-		} else if (type == "VD355VA550") {
-			vec_filename.push_back(data_dir + "run520.root");
-		} else if (type == "VD488VA550") {
-			vec_filename.push_back(data_dir + "run522.root");
-		} else if (type == "VD622VA550") {
-			vec_filename.push_back(data_dir + "run524.root");
-		} else if (type == "VD222VA525-run528") {
-			vec_filename.push_back(data_dir + "run528.root");
-		} else if (type == "VD222VA525-run534") {
-			vec_filename.push_back(data_dir + "run534.root");
-		} else if (type == "VD222VA525-run535") {
-			vec_filename.push_back(data_dir + "run535.root");
-		} else if (type == "VD222VA525-run536") {
-			vec_filename.push_back(data_dir + "run536.root");
+		const CatalogueRun* run = catalogue->findRun(type);
+		if (run != NULL) {
+			std::stringstream fileName;
+			fileName << data_dir << "run" << run->runNumber << ".root";
+			vec_filename.push_back(fileName.str());
+		} else {
+			std::cerr << "Run " << type << " is not in the run list" << std::endl;
 		}
 		return vec_filename;
 	}
 
 	static double driftGap;
 private:
-	map<string, TFile*> m_mapFile;
+	const RunCatalogue* catalogue;
+	set<string> m_runNames;
 	string data_dir; // was "../../PhD/Detector/micromega_data/" before
 	string path;
 	string appendName;
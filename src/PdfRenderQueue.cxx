@@ -0,0 +1,166 @@
+/*
+ * PdfRenderQueue.cxx
+ */
+
+#include "PdfRenderQueue.h"
+
+#include <TCanvas.h>
+#include <TObject.h>
+#include <TROOT.h>
+#include <TSystem.h>
+
+PdfRenderQueue& PdfRenderQueue::getInstance() {
+	static PdfRenderQueue instance;
+	return instance;
+}
+
+PdfRenderQueue::PdfRenderQueue() :
+		asynchronous(true), enabled(true), isExecutingJob(false), stopRendering(
+				false) {
+}
+
+PdfRenderQueue::~PdfRenderQueue() {
+	finish();
+}
+
+void PdfRenderQueue::setAsynchronous(bool _asynchronous) {
+	if (!_asynchronous) {
+		flush();
+	}
+	asynchronous = _asynchronous;
+}
+
+void PdfRenderQueue::render(const std::string& fileName, TObject* object,
+		std::function<void(TCanvas&)> draw) {
+	if (!enabled) {
+		delete object;
+		return;
+	}
+	Job job;
+	job.fileName = fileName;
+	job.object = object;
+	job.draw = draw;
+	submit(job);
+}
+
+void PdfRenderQueue::run(std::function<void()> command) {
+	Job job;
+	job.object = NULL;
+	job.command = command;
+	submit(job);
+}
+
+void PdfRenderQueue::beginDocument(const std::string& fileName) {
+	if (!enabled) {
+		return;
+	}
+	run([this, fileName]() {
+		createDirectoryOf(fileName);
+		TCanvas canvas("c", "data", 200, 10, 700, 500);
+		canvas.Print((fileName + "[").c_str(), "pdf");
+		currentDocument = fileName;
+	});
+}
+
+void PdfRenderQueue::endDocument() {
+	if (!enabled) {
+		return;
+	}
+	run([this]() {
+		TCanvas canvas("c", "data", 200, 10, 700, 500);
+		canvas.Print((currentDocument + "]").c_str(), "pdf");
+		currentDocument = "";
+	});
+}
+
+void PdfRenderQueue::flush() {
+	std::unique_lock<std::mutex> lock(jobsMutex);
+	jobsDone.wait(lock, [this]() {
+		return jobs.empty() && !isExecutingJob;
+	});
+}
+
+void PdfRenderQueue::finish() {
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		stopRendering = true;
+		jobQueued.notify_one();
+	}
+	if (renderer.joinable()) {
+		renderer.join();
+	}
+	stopRendering = false;
+}
+
+void PdfRenderQueue::submit(Job job) {
+	if (!asynchronous) {
+		execute(job);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(jobsMutex);
+	if (!renderer.joinable()) {
+		// canvases must never open a window outside of the main thread
+		gROOT->SetBatch(kTRUE);
+		renderer = std::thread(&PdfRenderQueue::renderQueuedJobs, this);
+	}
+	jobs.push_back(job);
+	jobQueued.notify_one();
+}
+
+void PdfRenderQueue::execute(Job& job) {
+	if (job.command) {
+		job.command();
+		return;
+	}
+
+	{
+		TCanvas canvas("c", "data", 200, 10, 700, 500);
+		job.draw(canvas);
+		if (currentDocument.empty()) {
+			createDirectoryOf(job.fileName);
+			canvas.Print(job.fileName.c_str(), "pdf");
+		} else {
+			canvas.Print(currentDocument.c_str(), "pdf");
+		}
+	}
+	// the canvas still references the object until it is destroyed
+	delete job.object;
+}
+
+/*
+ * Rendering thread: executes the jobs until finish() is called and the queue is empty
+ */
+void PdfRenderQueue::renderQueuedJobs() {
+	std::unique_lock<std::mutex> lock(jobsMutex);
+	while (true) {
+		jobQueued.wait(lock, [this]() {
+			return !jobs.empty() || stopRendering;
+		});
+		if (jobs.empty()) {
+			return;
+		}
+
+		Job job = jobs.front();
+		jobs.pop_front();
+		isExecutingJob = true;
+		lock.unlock();
+
+		execute(job);
+
+		lock.lock();
+		isExecutingJob = false;
+		if (jobs.empty()) {
+			jobsDone.notify_all();
+		}
+	}
+}
+
+void PdfRenderQueue::createDirectoryOf(const std::string& fileName) {
+	const std::string directory = fileName.substr(0, fileName.rfind('/') + 1);
+	if (directory.empty() || createdDirectories.count(directory) != 0) {
+		return;
+	}
+	gSystem->mkdir(directory.c_str(), kTRUE);
+	createdDirectories.insert(directory);
+}
@@ -0,0 +1,123 @@
+/*
+ * PdfRenderQueue.h
+ */
+
+#ifndef PDFRENDERQUEUE_H_
+#define PDFRENDERQUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+class TCanvas;
+class TObject;
+
+/**
+ * Writes the PDFs of writeToPdf and writeTH2FToPdf (Helper.h). The callers hand over a copy of
+ * the object to be plotted, and a single rendering thread draws and prints it, so the analysis
+ * never waits for the PDF output. The plots are rendered in the order they were queued.
+ *
+ * Only the rendering thread touches gStyle and the canvases, which is why style changes have to
+ * be queued with run() as well. In the synchronous mode everything is done directly by the calling
+ * thread instead.
+ *
+ * Output directories are created once with gSystem->mkdir instead of a "mkdir -p" per plot.
+ */
+class PdfRenderQueue {
+public:
+	static PdfRenderQueue& getInstance();
+
+	/**
+	 * Switches between rendering in the background thread (default) and in the calling thread.
+	 * Waits for all queued plots when switching to the synchronous mode.
+	 */
+	void setAsynchronous(bool asynchronous);
+
+	bool isAsynchronous() const {
+		return asynchronous;
+	}
+
+	/**
+	 * Switches the PDF output off (e.g. for benchmarks): plots and documents are dropped without
+	 * being cloned or rendered, queued commands are still run
+	 */
+	void setEnabled(bool _enabled) {
+		enabled = _enabled;
+	}
+
+	bool isEnabled() const {
+		return enabled;
+	}
+
+	/**
+	 * Queues a plot: <draw> draws <object> onto the canvas, which is then printed to <fileName> or
+	 * appended to the current document (see beginDocument). The queue owns <object>, a copy made by
+	 * the caller, and deletes it once the canvas is gone.
+	 */
+	void render(const std::string& fileName, TObject* object,
+			std::function<void(TCanvas&)> draw);
+
+	/**
+	 * Queues <command> to be run in the rendering thread after everything queued before
+	 */
+	void run(std::function<void()> command);
+
+	/**
+	 * All plots queued until endDocument are written as pages of the PDF <fileName> instead of their
+	 * own files
+	 */
+	void beginDocument(const std::string& fileName);
+	void endDocument();
+
+	/**
+	 * Waits until all queued plots are written
+	 */
+	void flush();
+
+	/**
+	 * Writes the queued plots and stops the rendering thread. Must be called before ROOT is torn
+	 * down at exit.
+	 */
+	void finish();
+
+private:
+	PdfRenderQueue();
+	~PdfRenderQueue();
+
+	/*
+	 * A queued plot (fileName, object and draw set) or command (only command set)
+	 */
+	struct Job {
+		std::string fileName;
+		TObject* object;
+		std::function<void(TCanvas&)> draw;
+		std::function<void()> command;
+	};
+
+	void submit(Job job);
+	void execute(Job& job);
+	void renderQueuedJobs();
+	void createDirectoryOf(const std::string& fileName);
+
+	bool asynchronous;
+	bool enabled;
+	std::thread renderer;
+	std::deque<Job> jobs;
+	bool isExecutingJob;
+	bool stopRendering;
+	std::mutex jobsMutex;
+	std::condition_variable jobQueued;
+	std::condition_variable jobsDone;
+
+	/*
+	 * Only used by the thread executing the jobs
+	 */
+	std::set<std::string> createdDirectories;
+	std::string currentDocument;
+};
+
+#endif /* PDFRENDERQUEUE_H_ */
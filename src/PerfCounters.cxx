@@ -0,0 +1,269 @@
+/*
+ * PerfCounters.cxx
+ */
+
+#include "PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+bool PerfCounters::enabled = false;
+
+namespace {
+
+const char* counterNames[PerfCounters::NUMBER_OF_COUNTERS] = { "cycles",
+		"instructions", "L1D misses", "LLC misses", "branch misses" };
+
+const char* regionNames[(int) PerfRegion::NUMBER_OF_REGIONS] = {
+		"findMaxCharge", "runProportionCut", "hit fit" };
+
+struct RegionStatistics {
+	uint64_t calls;
+	uint64_t nanoseconds;
+	uint64_t counters[PerfCounters::NUMBER_OF_COUNTERS];
+};
+
+/*
+ * Statistics of one thread. They are owned by the registry and outlive the thread, so that they
+ * can be printed after the workers are gone.
+ */
+struct ThreadStatistics {
+	RegionStatistics regions[(int) PerfRegion::NUMBER_OF_REGIONS];
+	bool available[PerfCounters::NUMBER_OF_COUNTERS];
+	uint64_t failedReads;
+};
+
+std::mutex registryMutex;
+std::vector<ThreadStatistics*> registry;
+
+/*
+ * Counter group of the calling thread: the first counter that could be opened is the group
+ * leader, a single read of the leader returns the values of all members in the order they were
+ * opened
+ */
+class ThreadCounters {
+public:
+	ThreadCounters() :
+			leader(-1), numberOfOpenCounters(0) {
+		statistics = new ThreadStatistics();
+		std::memset(statistics, 0, sizeof(ThreadStatistics));
+		for (int counter = 0; counter < PerfCounters::NUMBER_OF_COUNTERS;
+				counter++) {
+			fds[counter] = open((PerfCounters::Counter) counter);
+			if (fds[counter] != -1) {
+				if (leader == -1) {
+					leader = fds[counter];
+				}
+				openCounters[numberOfOpenCounters++] = counter;
+				statistics->available[counter] = true;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		registry.push_back(statistics);
+	}
+
+	~ThreadCounters() {
+#ifdef __linux__
+		for (int counter = 0; counter < PerfCounters::NUMBER_OF_COUNTERS;
+				counter++) {
+			if (fds[counter] != -1) {
+				close(fds[counter]);
+			}
+		}
+#endif
+	}
+
+	bool read(uint64_t values[PerfCounters::NUMBER_OF_COUNTERS]) {
+#ifdef __linux__
+		if (leader == -1) {
+			return true;
+		}
+		uint64_t buffer[1 + PerfCounters::NUMBER_OF_COUNTERS];
+		const ssize_t size = (1 + numberOfOpenCounters) * sizeof(uint64_t);
+		if (::read(leader, buffer, size) != size) {
+			statistics->failedReads++;
+			return false;
+		}
+		for (int i = 0; i < numberOfOpenCounters; i++) {
+			values[openCounters[i]] = buffer[1 + i];
+		}
+#endif
+		return true;
+	}
+
+	ThreadStatistics* statistics;
+
+private:
+	int open(PerfCounters::Counter counter) {
+#ifdef __linux__
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = PERF_TYPE_HARDWARE;
+		switch (counter) {
+		case PerfCounters::CYCLES:
+			attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfCounters::INSTRUCTIONS:
+			attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfCounters::L1D_MISSES:
+			attributes.type = PERF_TYPE_HW_CACHE;
+			attributes.config = PERF_COUNT_HW_CACHE_L1D
+					| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+					| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+		case PerfCounters::LLC_MISSES:
+			attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		default:
+			attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		}
+		attributes.read_format = PERF_FORMAT_GROUP;
+		// user space only, which is allowed with the default perf_event_paranoid setting
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+
+		// this thread on any CPU
+		const long fd = syscall(__NR_perf_event_open, &attributes, 0, -1,
+				leader, 0);
+		if (fd == -1) {
+			reportUnavailable(counter);
+		}
+		return fd;
+#else
+		reportUnavailable(counter);
+		return -1;
+#endif
+	}
+
+	/*
+	 * Prints once per counter why it is not measured
+	 */
+	static void reportUnavailable(PerfCounters::Counter counter) {
+		static bool isReported[PerfCounters::NUMBER_OF_COUNTERS] = { false };
+		const int error = errno;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		if (!isReported[counter]) {
+			isReported[counter] = true;
+			std::cerr << "Hardware counter " << counterNames[counter]
+					<< " not available (" << strerror(error)
+					<< "), only the available counters and the wall time are measured"
+					<< std::endl;
+		}
+	}
+
+	int fds[PerfCounters::NUMBER_OF_COUNTERS];
+	int leader;
+	int openCounters[PerfCounters::NUMBER_OF_COUNTERS];
+	int numberOfOpenCounters;
+};
+
+ThreadCounters& getThreadCounters() {
+	static thread_local ThreadCounters counters;
+	return counters;
+}
+
+}
+
+void PerfCounters::enable() {
+	enabled = true;
+}
+
+bool PerfCounters::read(uint64_t values[NUMBER_OF_COUNTERS]) {
+	return getThreadCounters().read(values);
+}
+
+void PerfCounters::add(PerfRegion region, const uint64_t begin[NUMBER_OF_COUNTERS],
+		const uint64_t end[NUMBER_OF_COUNTERS], uint64_t nanoseconds) {
+	ThreadStatistics* thread = getThreadCounters().statistics;
+	RegionStatistics& statistics = thread->regions[(int) region];
+	statistics.calls++;
+	statistics.nanoseconds += nanoseconds;
+	for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+		if (thread->available[counter]) {
+			statistics.counters[counter] += end[counter] - begin[counter];
+		}
+	}
+}
+
+void PerfCounters::print() {
+	if (!enabled) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+	RegionStatistics total[(int) PerfRegion::NUMBER_OF_REGIONS];
+	std::memset(total, 0, sizeof(total));
+	bool available[NUMBER_OF_COUNTERS];
+	for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+		available[counter] = !registry.empty();
+	}
+	uint64_t failedReads = 0;
+	for (ThreadStatistics* thread : registry) {
+		failedReads += thread->failedReads;
+		for (int region = 0; region < (int) PerfRegion::NUMBER_OF_REGIONS;
+				region++) {
+			total[region].calls += thread->regions[region].calls;
+			total[region].nanoseconds += thread->regions[region].nanoseconds;
+			for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+				total[region].counters[counter] +=
+						thread->regions[region].counters[counter];
+			}
+		}
+		for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+			available[counter] &= thread->available[counter];
+		}
+	}
+
+	std::stringstream report;
+	report << "Hardware counters per region (region, calls, ns/call";
+	for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+		if (available[counter]) {
+			report << ", " << counterNames[counter] << "/call";
+		}
+	}
+	if (available[CYCLES] && available[INSTRUCTIONS]) {
+		report << ", IPC";
+	}
+	report << "):" << std::endl;
+
+	for (int region = 0; region < (int) PerfRegion::NUMBER_OF_REGIONS;
+			region++) {
+		const RegionStatistics& statistics = total[region];
+		const double calls = statistics.calls == 0 ? 1 : statistics.calls;
+		report << "  " << regionNames[region] << "\t" << statistics.calls
+				<< "\t" << statistics.nanoseconds / calls;
+		for (int counter = 0; counter < NUMBER_OF_COUNTERS; counter++) {
+			if (available[counter]) {
+				report << "\t" << statistics.counters[counter] / calls;
+			}
+		}
+		if (available[CYCLES] && available[INSTRUCTIONS]) {
+			report << "\t"
+					<< (statistics.counters[CYCLES] == 0 ?
+							0 :
+							(double) statistics.counters[INSTRUCTIONS]
+									/ statistics.counters[CYCLES]);
+		}
+		report << std::endl;
+	}
+	if (failedReads != 0) {
+		report << "  (" << failedReads
+				<< " region executions not counted as the counters could not be read)"
+				<< std::endl;
+	}
+	std::cout << report.str();
+}
@@ -0,0 +1,113 @@
+/*
+ * PerfCounters.h
+ */
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Code regions measured with the hardware counters (see ScopedPerfRegion)
+ */
+enum class PerfRegion {
+	FIND_MAX_CHARGE,
+	PROPORTION_CUT, // both runProportionCut calls of an event
+	HIT_FIT, // HitEstimator::estimate
+	NUMBER_OF_REGIONS
+};
+
+/**
+ * Hardware counters of the analysis kernels read via the Linux perf_event_open interface (enabled
+ * via --perf-counters): cycles, instructions, L1D and last level cache misses and branch misses of
+ * the thread executing a region.
+ *
+ * Every thread opens its own counters the first time it enters a region. Counters the kernel does
+ * not allow (perf_event_paranoid, virtual machines without a PMU, other operating systems) are
+ * skipped, in the worst case only the wall time of the regions is measured. Executions during which
+ * the counters could not be read are not counted at all.
+ *
+ * Only the threads of the calling process are measured: with --processes every child prints its
+ * own table to its log in <outPath>logs/, the one of the parent does not include the children.
+ */
+class PerfCounters {
+public:
+	enum Counter {
+		CYCLES,
+		INSTRUCTIONS,
+		L1D_MISSES,
+		LLC_MISSES,
+		BRANCH_MISSES,
+		NUMBER_OF_COUNTERS
+	};
+
+	/**
+	 * Switches the measurement on. Must be called before any thread enters a region.
+	 */
+	static void enable();
+
+	static bool isEnabled() {
+		return enabled;
+	}
+
+	/**
+	 * Reads the current counter values of the calling thread into <values>. Unavailable counters
+	 * are left untouched. Returns false if the counters are open but could not be read.
+	 */
+	static bool read(uint64_t values[NUMBER_OF_COUNTERS]);
+
+	/**
+	 * Adds one execution of <region> with the given counter differences and wall time to the
+	 * statistics of the calling thread
+	 */
+	static void add(PerfRegion region,
+			const uint64_t begin[NUMBER_OF_COUNTERS],
+			const uint64_t end[NUMBER_OF_COUNTERS], uint64_t nanoseconds);
+
+	/**
+	 * Prints a table with the counters per region summed over all threads
+	 */
+	static void print();
+
+private:
+	static bool enabled;
+};
+
+/**
+ * Measures the enclosing scope as <region> if PerfCounters are enabled
+ */
+class ScopedPerfRegion {
+public:
+	explicit ScopedPerfRegion(PerfRegion _region) :
+			region(_region), active(PerfCounters::isEnabled()), begin() {
+		if (active) {
+			active = PerfCounters::read(begin);
+			start = std::chrono::steady_clock::now();
+		}
+	}
+
+	~ScopedPerfRegion() {
+		if (active) {
+			const std::chrono::steady_clock::time_point stop =
+					std::chrono::steady_clock::now();
+			uint64_t end[PerfCounters::NUMBER_OF_COUNTERS] = { 0 };
+			if (PerfCounters::read(end)) {
+				PerfCounters::add(region, begin, end,
+						std::chrono::duration_cast<std::chrono::nanoseconds>(
+								stop - start).count());
+			}
+		}
+	}
+
+private:
+	PerfRegion region;
+	bool active; // enabled and the counters at the beginning have been read
+	uint64_t begin[PerfCounters::NUMBER_OF_COUNTERS];
+	std::chrono::steady_clock::time_point start;
+
+	ScopedPerfRegion(const ScopedPerfRegion&);
+	ScopedPerfRegion& operator=(const ScopedPerfRegion&);
+};
+
+#endif /* PERFCOUNTERS_H_ */
@@ -0,0 +1,195 @@
+/*
+ * RawEventGenerator.cxx
+ *
+ * Writes synthetic detector data (see SyntheticEventGenerator) as <output>/run<number>.root for the
+ * physics and duck runs of a run list, to be analysed with MMPlots --input-path=<output>. Each file
+ * contains the tree "raw" with the branches read by MMQuickEvent and the tree "truth" with the true
+ * hit parameters of the same entries.
+ *
+ * Usage: RawEventGenerator [--output=DIR] [--runs=FILE] [--run=NUMBER] [--events=N] [--seed=S]
+ *     [--rate=HZ] [--additional-hits=MEAN] [--cluster-width-x=STRIPS] [--cluster-width-y=STRIPS]
+ *     [--amplitude-x=ADC] [--amplitude-y=ADC] [--noise=ADC] [--noise-strips=N]
+ *     [--pulse-order=N] [--shaping-time=SLICES]
+ */
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TSystem.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Helper.h"
+#include "RunCatalogue.h"
+#include "SyntheticEventGenerator.h"
+
+/*
+ * Writes <numberOfEvents> events of <generator> to <fileName>. Returns false if the file could not
+ * be written.
+ */
+static bool writeRun(const std::string& fileName,
+		SyntheticEventGenerator& generator, int numberOfEvents) {
+	TFile file(fileName.c_str(), (Option_t*) "RECREATE");
+	if (file.IsZombie()) {
+		return false;
+	}
+
+	SyntheticEvent event;
+	std::vector<unsigned int>* apv_fecNo = &event.apv_fecNo;
+	std::vector<unsigned int>* apv_id = &event.apv_id;
+	std::vector<unsigned int>* apv_ch = &event.apv_ch;
+	std::vector<std::string>* mm_id = &event.mm_id;
+	std::vector<unsigned int>* mm_readout = &event.mm_readout;
+	std::vector<unsigned int>* mm_strip = &event.mm_strip;
+	std::vector<std::vector<short> >* apv_q = &event.apv_q;
+	std::vector<short>* apv_qmax = &event.apv_qmax;
+	std::vector<short>* apv_tbqmax = &event.apv_tbqmax;
+
+	// same names and types as read by MMQuickEvent::addBranches
+	TTree* raw = new TTree("raw", "synthetic raw data");
+	raw->Branch("apv_evt", &event.apv_evt, "apv_evt/i");
+	raw->Branch("time_s", &event.time_s, "time_s/I");
+	raw->Branch("time_us", &event.time_us, "time_us/I");
+	raw->Branch("apv_fecNo", &apv_fecNo);
+	raw->Branch("apv_id", &apv_id);
+	raw->Branch("apv_ch", &apv_ch);
+	raw->Branch("mm_id", &mm_id);
+	raw->Branch("mm_readout", &mm_readout);
+	raw->Branch("mm_strip", &mm_strip);
+	raw->Branch("apv_q", &apv_q);
+	raw->Branch("apv_presamples", &event.apv_presamples, "apv_presamples/i");
+	raw->Branch("apv_qmax", &apv_qmax);
+	raw->Branch("apv_tbqmax", &apv_tbqmax);
+
+	std::vector<double>* positionX = &event.truth.positionX;
+	std::vector<double>* amplitudeX = &event.truth.amplitudeX;
+	std::vector<double>* positionY = &event.truth.positionY;
+	std::vector<double>* amplitudeY = &event.truth.amplitudeY;
+	std::vector<double>* peakTime = &event.truth.peakTime;
+
+	TTree* truth = new TTree("truth", "true hit parameters of the raw events");
+	truth->Branch("positionX", &positionX);
+	truth->Branch("amplitudeX", &amplitudeX);
+	truth->Branch("positionY", &positionY);
+	truth->Branch("amplitudeY", &amplitudeY);
+	truth->Branch("peakTime", &peakTime);
+
+	for (int i = 0; i < numberOfEvents; i++) {
+		generator.generate(event);
+		raw->Fill();
+		truth->Fill();
+	}
+
+	file.Write();
+	file.Close();
+	return true;
+}
+
+/*
+ * Sets <value> if <argument> is --<name>=<value>
+ */
+static bool parseOption(const std::string& argument, const std::string& name,
+		double& value) {
+	const std::string prefix = "--" + name + "=";
+	if (argument.find(prefix) != 0) {
+		return false;
+	}
+	value = atof(argument.substr(prefix.size()).c_str());
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	std::string outputPath = "synthetic/";
+	std::string runListFileName = runListFile;
+	int runNumber = -1;
+	double numberOfEvents = 10000;
+	double seed = 1;
+	double numberOfNoiseStrips = -1;
+	double pulseShapeOrder = -1;
+	SyntheticEventParameters parameters;
+	for (int i = 1; i < argc; i++) {
+		std::string argument(argv[i]);
+		double value;
+		if (argument.find("--output=") == 0) {
+			outputPath = argument.substr(std::string("--output=").size());
+			if (!outputPath.empty() && outputPath[outputPath.size() - 1] != '/') {
+				outputPath += "/";
+			}
+		} else if (argument.find("--runs=") == 0) {
+			runListFileName = argument.substr(std::string("--runs=").size());
+		} else if (parseOption(argument, "run", value)) {
+			runNumber = value;
+		} else if (parseOption(argument, "events", numberOfEvents)
+				|| parseOption(argument, "seed", seed)
+				|| parseOption(argument, "rate", parameters.rate)
+				|| parseOption(argument, "additional-hits",
+						parameters.additionalHits)
+				|| parseOption(argument, "cluster-width-x",
+						parameters.x.clusterWidth)
+				|| parseOption(argument, "cluster-width-y",
+						parameters.y.clusterWidth)
+				|| parseOption(argument, "amplitude-x", parameters.x.amplitude)
+				|| parseOption(argument, "amplitude-y", parameters.y.amplitude)
+				|| parseOption(argument, "noise", parameters.noiseSigma)
+				|| parseOption(argument, "noise-strips", numberOfNoiseStrips)
+				|| parseOption(argument, "pulse-order", pulseShapeOrder)
+				|| parseOption(argument, "shaping-time",
+						parameters.shapingTime)) {
+		} else {
+			std::cerr << "Unknown argument " << argument << std::endl;
+			return 1;
+		}
+	}
+	if (numberOfNoiseStrips >= 0) {
+		parameters.x.numberOfNoiseStrips = numberOfNoiseStrips;
+		parameters.y.numberOfNoiseStrips = numberOfNoiseStrips;
+	}
+	if (pulseShapeOrder >= 0) {
+		parameters.pulseShapeOrder = pulseShapeOrder;
+	}
+	if (numberOfEvents < 1 || parameters.rate <= 0
+			|| parameters.additionalHits < 0 || parameters.x.clusterWidth <= 0
+			|| parameters.y.clusterWidth <= 0 || parameters.x.amplitude <= 0
+			|| parameters.y.amplitude <= 0 || parameters.noiseSigma <= 0
+			|| parameters.pulseShapeOrder < 1 || parameters.shapingTime <= 0) {
+		std::cerr << "Invalid parameters, all of them have to be positive"
+				<< std::endl;
+		return 1;
+	}
+
+	RunCatalogue catalogue;
+	if (!catalogue.load(runListFileName)) {
+		return 1;
+	}
+	gSystem->mkdir(outputPath.c_str(), kTRUE);
+
+	std::vector<double> driftGaps = catalogue.getDriftGaps();
+	driftGaps.push_back(RunCatalogue::DUCK_RUNS);
+	int numberOfFailedRuns = 0;
+	for (auto& driftGap : driftGaps) {
+		for (const CatalogueRun* run : catalogue.getRuns(driftGap)) {
+			if (runNumber != -1 && run->runNumber != runNumber) {
+				continue;
+			}
+
+			/*
+			 * Every run has its own seed so that its file does not depend on which other runs are
+			 * generated
+			 */
+			SyntheticEventGenerator generator(parameters,
+					(unsigned int) seed + run->runNumber);
+			std::stringstream fileName;
+			fileName << outputPath << "run" << run->runNumber << ".root";
+			std::cout << "Writing " << (int) numberOfEvents << " events of run "
+					<< run->name << " to " << fileName.str() << std::endl;
+			if (!writeRun(fileName.str(), generator, numberOfEvents)) {
+				std::cerr << "Unable to write " << fileName.str() << std::endl;
+				numberOfFailedRuns++;
+			}
+		}
+	}
+	return numberOfFailedRuns == 0 ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/*
+ * ReservoirSample.h
+ */
+
+#ifndef RESERVOIRSAMPLE_H_
+#define RESERVOIRSAMPLE_H_
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Seed of the sample <name> of the part <part> of the run <runName>. The samples of different runs
+ * and parts draw independent random numbers, so that they do not sample the events at the same
+ * positions. Without a run name the seed only depends on <name> (used for the global samples).
+ */
+inline unsigned int getSampleSeed(const std::string& name,
+		const std::string& runName = "", unsigned int part = 0) {
+	if (runName.empty()) {
+		return std::hash<std::string>()(name);
+	}
+	std::stringstream stream;
+	stream << name << "/" << runName << "/" << part;
+	return std::hash<std::string>()(stream.str());
+}
+
+/**
+ * Uniform random sample of at most <capacity> of all items offered, independent of their order
+ * (reservoir sampling, Li's algorithm L). The number of items to be skipped until the next one is
+ * sampled is drawn in advance, so offer() only increments and compares a counter for the items that
+ * are not sampled.
+ *
+ * Every thread fills its own sample, the samples are combined with merge(). The sample only
+ * depends on the seed, the offered items and the order of the merges.
+ */
+template<typename T>
+class ReservoirSample {
+public:
+	ReservoirSample(unsigned int _capacity, unsigned int seed) :
+			random(seed) {
+		setCapacity(_capacity);
+	}
+
+	/**
+	 * Clears the sample and sets its maximum size
+	 */
+	void setCapacity(unsigned int _capacity) {
+		capacity = _capacity;
+		clear();
+	}
+
+	unsigned int getCapacity() const {
+		return capacity;
+	}
+
+	/**
+	 * Restarts the random numbers with <seed> and clears the sample
+	 */
+	void seed(unsigned int seed) {
+		random.seed(seed);
+		clear();
+	}
+
+	/**
+	 * Offers one item: returns the slot the item has to be stored in, or NULL if it is not part of
+	 * the sample. The slot may contain a previously sampled item that is replaced.
+	 */
+	T* offer() {
+		numberOfOfferedItems++;
+		if (numberOfOfferedItems < nextSampledItem) {
+			return NULL;
+		}
+
+		if (items.size() < capacity) {
+			items.push_back(T());
+			if (items.size() == capacity) {
+				logW = std::log(drawUniform()) / capacity;
+				drawNextSampledItem();
+			}
+			return &items.back();
+		}
+
+		T* slot = &items[std::uniform_int_distribution<unsigned int>(0,
+				capacity - 1)(random)];
+		logW += std::log(drawUniform()) / capacity;
+		drawNextSampledItem();
+		return slot;
+	}
+
+	/**
+	 * Replaces this sample by a uniform sample of the items offered to this one and to <other>, as
+	 * if all items had been offered to this sample. <other> is cleared.
+	 *
+	 * If nothing has been offered to this sample it takes over the items of <other> unchanged
+	 * without drawing any random number. Merging a run into an empty context therefore does not
+	 * change the result, so that merging partial files gives the same sample as a single process.
+	 */
+	void merge(ReservoirSample& other) {
+		if (other.numberOfOfferedItems == 0) {
+			return;
+		}
+		if (numberOfOfferedItems == 0 && other.items.size() <= capacity) {
+			items = std::move(other.items);
+			numberOfOfferedItems = other.numberOfOfferedItems;
+			nextSampledItem = other.nextSampledItem;
+			logW = other.logW;
+			other.clear();
+			return;
+		}
+
+		/*
+		 * Draw <capacity> of all offered items without replacement: each draw comes from this
+		 * sample with the probability of its share of the remaining offered items, and the
+		 * item is taken randomly from the ones of that sample (which are a uniform sample of its
+		 * offered items themselves)
+		 */
+		std::vector<T> merged;
+		uint64_t remaining = numberOfOfferedItems;
+		uint64_t remainingOther = other.numberOfOfferedItems;
+		while (merged.size() < capacity
+				&& !(items.empty() && other.items.empty())) {
+			const bool fromThis = std::uniform_int_distribution<uint64_t>(0,
+					remaining + remainingOther - 1)(random) < remaining;
+			std::vector<T>& source = fromThis ? items : other.items;
+			const unsigned int index = std::uniform_int_distribution<
+					unsigned int>(0, source.size() - 1)(random);
+			merged.push_back(std::move(source[index]));
+			source[index] = std::move(source.back());
+			source.pop_back();
+			(fromThis ? remaining : remainingOther)--;
+		}
+
+		assign(std::move(merged),
+				numberOfOfferedItems + other.numberOfOfferedItems);
+		other.clear();
+	}
+
+	/**
+	 * Sets the sample to <sampledItems>, a uniform sample of <offeredItems> items (e.g. a sample read
+	 * from a file), so that further items or merges are sampled correctly
+	 */
+	void assign(std::vector<T> sampledItems, uint64_t offeredItems) {
+		items = std::move(sampledItems);
+		numberOfOfferedItems = offeredItems;
+		if (items.size() < capacity) {
+			nextSampledItem = 0;
+			logW = 0;
+		} else {
+			/*
+			 * W of algorithm L is the largest of the smallest <capacity> of <offeredItems> random
+			 * keys, which follows a beta(capacity, offeredItems - capacity + 1) distribution
+			 */
+			const double x = std::gamma_distribution<double>(capacity)(random);
+			const double y = std::gamma_distribution<double>(
+					offeredItems - capacity + 1)(random);
+			logW = std::log(x / (x + y));
+			drawNextSampledItem();
+		}
+	}
+
+	void clear() {
+		items.clear();
+		numberOfOfferedItems = 0;
+		nextSampledItem = capacity == 0 ? std::numeric_limits<uint64_t>::max() : 0;
+		logW = 0;
+	}
+
+	const std::vector<T>& getItems() const {
+		return items;
+	}
+
+	typename std::vector<T>::const_iterator begin() const {
+		return items.begin();
+	}
+
+	typename std::vector<T>::const_iterator end() const {
+		return items.end();
+	}
+
+	uint64_t getNumberOfOfferedItems() const {
+		return numberOfOfferedItems;
+	}
+
+private:
+	double drawUniform() {
+		return std::uniform_real_distribution<double>(
+				std::numeric_limits<double>::min(), 1)(random);
+	}
+
+	void drawNextSampledItem() {
+		const double skipped = std::floor(
+				std::log(drawUniform()) / std::log1p(-std::exp(logW)));
+		if (!(skipped < std::numeric_limits<uint64_t>::max()
+				- numberOfOfferedItems - 1)) {
+			nextSampledItem = std::numeric_limits<uint64_t>::max();
+		} else {
+			nextSampledItem = numberOfOfferedItems + (uint64_t) skipped + 1;
+		}
+	}
+
+	unsigned int capacity;
+	std::vector<T> items;
+	uint64_t numberOfOfferedItems;
+
+	/*
+	 * Index (counted from 1) of the next offered item that is sampled once the sample is full
+	 */
+	uint64_t nextSampledItem;
+	double logW;
+	std::mt19937 random;
+};
+
+#endif /* RESERVOIRSAMPLE_H_ */
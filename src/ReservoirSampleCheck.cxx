@@ -0,0 +1,201 @@
+/*
+ * ReservoirSampleCheck.cxx
+ *
+ * Checks that the event displays merged from partial files (MMPlots --merge and --processes) are
+ * the same as the ones of a single process. Both ways are simulated with ReservoirSamples seeded
+ * like the ones of a CutStatistic:
+ *
+ * single process: the samples of the threads of a run are merged into the sample of the run
+ *     context, which is merged into the global sample
+ * partial files: the items and the number of offered items of the run sample are written, read
+ *     into a new sample via assign (CutStatistic::setEventDisplays), merged into the sample of an
+ *     empty context (AnalysisContext::readPartial) and then into the global sample
+ *
+ * Also checks that the samples of different runs and of different parts of a run, seeded via
+ * getSampleSeed, do not pick the events at the same positions.
+ *
+ * Returns 1 if the global samples differ after any run or if two runs or parts pick the same
+ * positions.
+ *
+ * Usage: ReservoirSampleCheck [--runs=N] [--capacity=N] [--seed=S]
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ReservoirSample.h"
+
+typedef ReservoirSample<unsigned int> Sample;
+
+static std::string getRunName(unsigned int run) {
+	std::stringstream runName;
+	runName << "run" << run;
+	return runName.str();
+}
+
+/*
+ * Offers the events of <run> split into <numberOfThreads> parts to the samples of the threads and
+ * merges them into <runSample>. The samples are seeded like the ones of the contexts of the parts
+ * (see AnalysisContext::seedEventDisplays).
+ */
+static void sampleRun(const std::string& name, unsigned int run,
+		unsigned int numberOfEvents, unsigned int numberOfThreads,
+		unsigned int capacity, Sample& runSample) {
+	const unsigned int eventsPerThread = numberOfEvents / numberOfThreads + 1;
+	for (unsigned int thread = 0; thread != numberOfThreads; thread++) {
+		Sample threadSample(capacity,
+				getSampleSeed(name, getRunName(run), thread));
+		for (unsigned int event = thread * eventsPerThread;
+				event < numberOfEvents && event < (thread + 1) * eventsPerThread;
+				event++) {
+			unsigned int* slot = threadSample.offer();
+			if (slot != NULL) {
+				*slot = run * 1000000 + event;
+			}
+		}
+		runSample.merge(threadSample);
+	}
+}
+
+/*
+ * Returns the sorted positions of the items a sample of <name> for <part> of <run> picks of
+ * <numberOfEvents> offered ones
+ */
+static std::vector<unsigned int> getSampledPositions(const std::string& name,
+		unsigned int run, unsigned int part, unsigned int numberOfEvents,
+		unsigned int capacity) {
+	Sample sample(capacity, getSampleSeed(name, getRunName(run), part));
+	for (unsigned int event = 0; event != numberOfEvents; event++) {
+		unsigned int* slot = sample.offer();
+		if (slot != NULL) {
+			*slot = event;
+		}
+	}
+	std::vector<unsigned int> positions = sample.getItems();
+	std::sort(positions.begin(), positions.end());
+	return positions;
+}
+
+static void print(const std::string& name, const Sample& sample) {
+	std::cerr << "  " << name << " (" << sample.getNumberOfOfferedItems()
+			<< " offered):";
+	for (unsigned int item : sample) {
+		std::cerr << " " << item;
+	}
+	std::cerr << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	unsigned int numberOfRuns = 20;
+	unsigned int capacity = 5;
+	unsigned int seed = 1;
+	for (int i = 1; i < argc; i++) {
+		std::string argument(argv[i]);
+		if (argument.find("--runs=") == 0) {
+			numberOfRuns = atoi(argument.substr(7).c_str());
+		} else if (argument.find("--capacity=") == 0) {
+			capacity = atoi(argument.substr(11).c_str());
+		} else if (argument.find("--seed=") == 0) {
+			seed = atoi(argument.substr(7).c_str());
+		} else {
+			std::cerr << "Unknown argument " << argument << std::endl;
+			return 1;
+		}
+	}
+
+	/*
+	 * Runs with fewer events than displays, without any event and with many events, processed by a
+	 * varying number of threads
+	 */
+	std::mt19937 random(seed);
+	std::vector<unsigned int> numberOfEvents;
+	std::vector<unsigned int> numberOfThreads;
+	for (unsigned int run = 0; run != numberOfRuns; run++) {
+		const unsigned int kind = run % 4;
+		numberOfEvents.push_back(
+				kind == 0 ? 0 :
+				kind == 1 ?
+						std::uniform_int_distribution<unsigned int>(1, capacity)(
+								random) :
+						std::uniform_int_distribution<unsigned int>(capacity,
+								100000)(random));
+		numberOfThreads.push_back(
+				std::uniform_int_distribution<unsigned int>(1, 4)(random));
+	}
+
+	// the name of the cut statistic the samples belong to
+	std::stringstream nameStream;
+	nameStream << "check" << seed;
+	const std::string name = nameStream.str();
+
+	/*
+	 * Runs and parts with the same number of events must pick different positions (with 1000
+	 * events and 5 displays two of them pick the same ones with a probability of about 1e-13)
+	 */
+	const unsigned int eventsPerPart = std::max(1000u, 20 * capacity);
+	for (unsigned int run = 0; run != numberOfRuns; run++) {
+		for (unsigned int part = 0; part != 4; part++) {
+			const std::vector<unsigned int> positions = getSampledPositions(name,
+					run, part, eventsPerPart, capacity);
+			for (unsigned int otherRun = 0; otherRun <= run; otherRun++) {
+				for (unsigned int otherPart = 0;
+						otherPart != (otherRun == run ? part : 4); otherPart++) {
+					if (positions
+							== getSampledPositions(name, otherRun, otherPart,
+									eventsPerPart, capacity)) {
+						std::cerr << "Part " << part << " of run " << run
+								<< " and part " << otherPart << " of run "
+								<< otherRun << " sample the same positions"
+								<< std::endl;
+						return 1;
+					}
+				}
+			}
+		}
+	}
+
+	Sample singleProcess(capacity, getSampleSeed(name));
+	Sample partialFiles(capacity, getSampleSeed(name));
+	for (unsigned int run = 0; run != numberOfRuns; run++) {
+		Sample runSample(capacity, getSampleSeed(name, getRunName(run), 0));
+		sampleRun(name, run, numberOfEvents[run], numberOfThreads[run],
+				capacity, runSample);
+
+		// written and read again, the seeds of the partial file sample and the context do not matter
+		Sample writtenSample(capacity, getSampleSeed(name, getRunName(run), 0));
+		sampleRun(name, run, numberOfEvents[run], numberOfThreads[run],
+				capacity, writtenSample);
+		Sample partialSample(capacity, getSampleSeed(name));
+		partialSample.assign(writtenSample.getItems(),
+				writtenSample.getNumberOfOfferedItems());
+		Sample emptyContextSample(capacity, getSampleSeed(name));
+		emptyContextSample.merge(partialSample);
+
+		singleProcess.merge(runSample);
+		partialFiles.merge(emptyContextSample);
+
+		if (singleProcess.getItems() != partialFiles.getItems()
+				|| singleProcess.getNumberOfOfferedItems()
+						!= partialFiles.getNumberOfOfferedItems()) {
+			std::cerr << "The samples differ after run " << run << ":"
+					<< std::endl;
+			print("single process", singleProcess);
+			print("partial files", partialFiles);
+			return 1;
+		}
+	}
+
+	std::cout << "The samples of " << numberOfRuns
+			<< " runs are the same for a single process and partial files: ";
+	for (unsigned int item : singleProcess) {
+		std::cout << item << " ";
+	}
+	std::cout << std::endl;
+	return 0;
+}
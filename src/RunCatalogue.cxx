@@ -0,0 +1,180 @@
+/*
+ * RunCatalogue.cxx
+ */
+
+#include "RunCatalogue.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+/*
+ * Smallest and largest value of <values> and the smallest distance between two of them (1 if
+ * there is only one value)
+ */
+static void getRange(const std::set<int>& values, int& start, int& end,
+		int& steps) {
+	start = *values.begin();
+	end = *values.rbegin();
+	steps = 0;
+	int previous = start;
+	for (int value : values) {
+		if (value != previous && (steps == 0 || value - previous < steps)) {
+			steps = value - previous;
+		}
+		previous = value;
+	}
+	if (steps == 0) {
+		steps = 1;
+	}
+}
+
+int RunCatalogue::getDriftGapKey(double driftGap) {
+	return (int) std::lround(driftGap * 10);
+}
+
+bool RunCatalogue::load(const std::string& fileName) {
+	std::ifstream file(fileName.c_str());
+	if (!file.is_open()) {
+		std::cerr << "Unable to open the run list " << fileName << std::endl;
+		return false;
+	}
+
+	runs.clear();
+	runIndexByName.clear();
+	runIndexByVoltages.clear();
+	runIndexByNumber.clear();
+	runIndicesByDriftGap.clear();
+
+	std::unordered_map<long long, int> lastPedestalRunByVoltages;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		std::stringstream stream(line);
+		std::string firstWord;
+		if (!(stream >> firstWord) || firstWord[0] == '#') {
+			continue;
+		}
+
+		CatalogueRun run;
+		std::stringstream fields(line);
+		std::string rest;
+		if (!(fields >> run.runNumber >> run.VA >> run.VD >> run.type
+				>> run.driftGap) || (fields >> rest)
+				|| (run.type != "phy" && run.type != "ped"
+						&& run.type != "duck")) {
+			std::cerr << fileName << ":" << lineNumber
+					<< ": expected \"run VA VD phy|ped|duck driftgap\" but got \""
+					<< line << "\"" << std::endl;
+			return false;
+		}
+		if (runIndexByNumber.count(run.runNumber) != 0) {
+			std::cerr << fileName << ":" << lineNumber << ": run "
+					<< run.runNumber << " is listed twice" << std::endl;
+			return false;
+		}
+
+		std::stringstream name;
+		name << "VD" << run.VD << "VA" << run.VA;
+		if (run.type == "duck") {
+			name << "-run" << run.runNumber;
+		}
+		run.name = name.str();
+
+		const long long voltageKey = getVoltageKey(
+				getDriftGapKey(run.driftGap), run.VD, run.VA);
+		run.pedestalRunNumber = -1;
+		if (run.type == "phy" && lastPedestalRunByVoltages.count(voltageKey)) {
+			run.pedestalRunNumber = lastPedestalRunByVoltages[voltageKey];
+		}
+
+		const unsigned int index = runs.size();
+		if (run.type == "ped") {
+			lastPedestalRunByVoltages[voltageKey] = run.runNumber;
+		} else {
+			if (runIndexByName.count(run.name) != 0) {
+				std::cerr << fileName << ":" << lineNumber
+						<< ": there is already a run called " << run.name
+						<< std::endl;
+				return false;
+			}
+			runIndexByName[run.name] = index;
+			if (run.type == "phy") {
+				runIndexByVoltages[voltageKey] = index;
+				runIndicesByDriftGap[getDriftGapKey(run.driftGap)].push_back(
+						index);
+			} else {
+				runIndicesByDriftGap[getDriftGapKey(DUCK_RUNS)].push_back(
+						index);
+			}
+		}
+		runIndexByNumber[run.runNumber] = index;
+		runs.push_back(run);
+	}
+	return true;
+}
+
+std::vector<double> RunCatalogue::getDriftGaps() const {
+	std::vector<double> driftGaps;
+	for (auto& pair : runIndicesByDriftGap) {
+		if (pair.first != getDriftGapKey(DUCK_RUNS)) {
+			driftGaps.push_back(pair.first / 10.);
+		}
+	}
+	return driftGaps;
+}
+
+std::vector<const CatalogueRun*> RunCatalogue::getRuns(double driftGap) const {
+	std::vector<const CatalogueRun*> result;
+	auto indices = runIndicesByDriftGap.find(getDriftGapKey(driftGap));
+	if (indices != runIndicesByDriftGap.end()) {
+		for (unsigned int index : indices->second) {
+			result.push_back(&runs[index]);
+		}
+	}
+	return result;
+}
+
+const CatalogueRun* RunCatalogue::findRun(const std::string& name) const {
+	auto index = runIndexByName.find(name);
+	return index == runIndexByName.end() ? NULL : &runs[index->second];
+}
+
+const CatalogueRun* RunCatalogue::findRun(double driftGap, int VD,
+		int VA) const {
+	auto index = runIndexByVoltages.find(
+			getVoltageKey(getDriftGapKey(driftGap), VD, VA));
+	return index == runIndexByVoltages.end() ? NULL : &runs[index->second];
+}
+
+const CatalogueRun* RunCatalogue::getPedestalRun(
+		const CatalogueRun& run) const {
+	auto index = runIndexByNumber.find(run.pedestalRunNumber);
+	return index == runIndexByNumber.end() ? NULL : &runs[index->second];
+}
+
+bool RunCatalogue::getVoltageRange(double driftGap, VoltageRange& range) const {
+	std::vector<const CatalogueRun*> gapRuns = getRuns(driftGap);
+	if (gapRuns.empty()) {
+		return false;
+	}
+	if (getDriftGapKey(driftGap) == getDriftGapKey(DUCK_RUNS)) {
+		// the combined histograms of the duck runs are binned like the ones of their drift gap
+		gapRuns = getRuns(gapRuns[0]->driftGap);
+		if (gapRuns.empty()) {
+			return false;
+		}
+	}
+
+	std::set<int> VDs, VAs;
+	for (const CatalogueRun* run : gapRuns) {
+		VDs.insert(run->VD);
+		VAs.insert(run->VA);
+	}
+	getRange(VDs, range.driftStart, range.driftEnd, range.driftSteps);
+	getRange(VAs, range.ampStart, range.ampEnd, range.ampSteps);
+	return true;
+}
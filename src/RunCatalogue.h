@@ -0,0 +1,116 @@
+/*
+ * RunCatalogue.h
+ */
+
+#ifndef RUNCATALOGUE_H_
+#define RUNCATALOGUE_H_
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * One line of the run list (runs.txt)
+ */
+struct CatalogueRun {
+	int runNumber;
+	int VA;
+	int VD;
+	std::string type; // "phy", "ped" or "duck"
+	double driftGap;
+
+	/*
+	 * Name of the run in the analysis and in the output files: "VD<VD>VA<VA>", duck runs share the
+	 * voltages and get "-run<runNumber>" appended
+	 */
+	std::string name;
+
+	/*
+	 * Last pedestal run taken before this run with the same drift gap and voltages, -1 if there is
+	 * none
+	 */
+	int pedestalRunNumber;
+};
+
+/**
+ * Voltages of the runs of one drift gap as needed for the binning of the combined histograms:
+ * smallest and largest value and the smallest distance between two values
+ */
+struct VoltageRange {
+	int driftStart;
+	int driftEnd;
+	int driftSteps;
+	int ampStart;
+	int ampEnd;
+	int ampSteps;
+};
+
+/**
+ * All runs of the campaign, read from the run list at startup. Each line of the list contains the
+ * run number, VA, VD, the type (phy, ped or duck) and the drift gap; lines starting with # are
+ * comments. Adding the runs of a new day only requires new lines in the list.
+ *
+ * The physics runs are indexed by their name and by (drift gap, VD, VA). The duck runs are the ones
+ * processed with the drift gap DUCK_RUNS (-1), their voltage ranges are the ones of the drift gap
+ * they were taken at.
+ */
+class RunCatalogue {
+public:
+	static const int DUCK_RUNS = -1;
+
+	/**
+	 * Reads the run list <fileName>. Returns false and prints the offending line if the file can not
+	 * be read or contains an invalid line.
+	 */
+	bool load(const std::string& fileName);
+
+	/**
+	 * Drift gaps with physics runs in ascending order, without the duck runs
+	 */
+	std::vector<double> getDriftGaps() const;
+
+	/**
+	 * Physics runs of <driftGap> (or the duck runs if it is DUCK_RUNS) in the order of the run list
+	 */
+	std::vector<const CatalogueRun*> getRuns(double driftGap) const;
+
+	/**
+	 * Returns the physics run with the given name or NULL if there is none
+	 */
+	const CatalogueRun* findRun(const std::string& name) const;
+
+	/**
+	 * Returns the physics run taken with the given drift gap and voltages or NULL if there is none
+	 */
+	const CatalogueRun* findRun(double driftGap, int VD, int VA) const;
+
+	/**
+	 * Returns the pedestal run belonging to <run> or NULL if there is none
+	 */
+	const CatalogueRun* getPedestalRun(const CatalogueRun& run) const;
+
+	/**
+	 * Writes the voltage range of the runs of <driftGap> to <range>. Returns false if there are no
+	 * runs with this drift gap.
+	 */
+	bool getVoltageRange(double driftGap, VoltageRange& range) const;
+
+private:
+	/*
+	 * Drift gaps are compared in units of 0.1 mm
+	 */
+	static int getDriftGapKey(double driftGap);
+
+	static long long getVoltageKey(int driftGapKey, int VD, int VA) {
+		return ((long long) driftGapKey << 40) | ((long long) VD << 20) | VA;
+	}
+
+	std::vector<CatalogueRun> runs;
+	std::unordered_map<std::string, unsigned int> runIndexByName;
+	std::unordered_map<long long, unsigned int> runIndexByVoltages;
+	std::unordered_map<int, unsigned int> runIndexByNumber;
+	std::map<int/*drift gap key*/, std::vector<unsigned int> > runIndicesByDriftGap;
+};
+
+#endif /* RUNCATALOGUE_H_ */
@@ -0,0 +1,73 @@
+/*
+ * RunOutputFile.h
+ */
+
+#ifndef RUNOUTPUTFILE_H_
+#define RUNOUTPUTFILE_H_
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <TFile.h>
+
+/**
+ * Output file of a single run. It is created under a temporary name next to the final one and only
+ * renamed to <fileName> by commit() once everything has been written. The rename replaces an
+ * existing result atomically, so a run that fails or crashes leaves the result of the previous
+ * analysis untouched instead of an empty or truncated file.
+ *
+ * If commit() is never called, the destructor removes the temporary file.
+ */
+class RunOutputFile {
+public:
+	explicit RunOutputFile(const std::string& _fileName) :
+			fileName(_fileName), temporaryFileName(_fileName + ".tmp") {
+		file = TFile::Open(temporaryFileName.c_str(), "RECREATE");
+	}
+
+	~RunOutputFile() {
+		if (file != NULL) {
+			file->Close();
+			delete file;
+			std::remove(temporaryFileName.c_str());
+		}
+	}
+
+	bool isOpen() const {
+		return file != NULL && !file->IsZombie();
+	}
+
+	TFile* get() {
+		return file;
+	}
+
+	/**
+	 * Closes the file and moves it to its final name. Returns false if the file could not be renamed,
+	 * in which case the temporary file is removed.
+	 */
+	bool commit() {
+		file->Close();
+		delete file;
+		file = NULL;
+		if (std::rename(temporaryFileName.c_str(), fileName.c_str()) != 0) {
+			std::cerr << "Unable to rename " << temporaryFileName << " to "
+					<< fileName << ": " << strerror(errno) << std::endl;
+			std::remove(temporaryFileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string fileName;
+	std::string temporaryFileName;
+	TFile* file;
+
+	RunOutputFile(const RunOutputFile&);
+	RunOutputFile& operator=(const RunOutputFile&);
+};
+
+#endif /* RUNOUTPUTFILE_H_ */
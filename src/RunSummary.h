@@ -0,0 +1,140 @@
+/*
+ * RunSummary.h
+ */
+
+#ifndef RUNSUMMARY_H_
+#define RUNSUMMARY_H_
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+/**
+ * Results of a single run needed for the combined plots of all runs (see mergeRun in MMPlots.cxx).
+ * Stored as small text file ("key value" per line) if the run is processed by another process.
+ */
+struct RunSummary {
+	std::string runName;
+	double driftGap;
+	int VD;
+	int VA;
+
+	int numberOfAcceptedEvents;
+	double lengthOfMeasurement; // [s]
+
+	// Parameters of the Gaussians fitted to the hit width histograms (only valid if hasHitWidth)
+	bool hasHitWidthX;
+	double hitWidthX;
+	double hitWidthXError;
+	bool hasHitWidthY;
+	double hitWidthY;
+	double hitWidthYError;
+
+	double meanChargeX;
+	double meanChargeY;
+	double meanChargeXUncut;
+	double meanChargeYUncut;
+
+	/*
+	 * Settings the run was analysed with (see getAnalysisSettings in MMPlots.cxx), without spaces.
+	 * Partial files are only merged if they were written with the settings of the merge.
+	 */
+	std::string settings;
+
+	RunSummary() :
+			driftGap(0), VD(0), VA(0), numberOfAcceptedEvents(0), lengthOfMeasurement(
+					0), hasHitWidthX(false), hitWidthX(0), hitWidthXError(0), hasHitWidthY(
+					false), hitWidthY(0), hitWidthYError(0), meanChargeX(0), meanChargeY(
+					0), meanChargeXUncut(0), meanChargeYUncut(0) {
+	}
+
+	/**
+	 * The length of the measurement is summed up in single precision
+	 */
+	float getRate() const {
+		return numberOfAcceptedEvents / (float) lengthOfMeasurement;
+	}
+
+	bool write(std::string fileName) const {
+		std::ofstream file(fileName.c_str());
+		file.precision(17);
+		file << "runName " << runName << std::endl;
+		file << "driftGap " << driftGap << std::endl;
+		file << "VD " << VD << std::endl;
+		file << "VA " << VA << std::endl;
+		file << "numberOfAcceptedEvents " << numberOfAcceptedEvents
+				<< std::endl;
+		file << "lengthOfMeasurement " << lengthOfMeasurement << std::endl;
+		file << "hasHitWidthX " << hasHitWidthX << std::endl;
+		file << "hitWidthX " << hitWidthX << std::endl;
+		file << "hitWidthXError " << hitWidthXError << std::endl;
+		file << "hasHitWidthY " << hasHitWidthY << std::endl;
+		file << "hitWidthY " << hitWidthY << std::endl;
+		file << "hitWidthYError " << hitWidthYError << std::endl;
+		file << "meanChargeX " << meanChargeX << std::endl;
+		file << "meanChargeY " << meanChargeY << std::endl;
+		file << "meanChargeXUncut " << meanChargeXUncut << std::endl;
+		file << "meanChargeYUncut " << meanChargeYUncut << std::endl;
+		file << "settings " << settings << std::endl;
+		return file.good();
+	}
+
+	/**
+	 * Returns false if the file does not exist or is incomplete (also if it has been written before
+	 * the settings were stored)
+	 */
+	bool read(std::string fileName) {
+		std::ifstream file(fileName.c_str());
+		std::string line;
+		int numberOfValues = 0;
+		while (std::getline(file, line)) {
+			std::stringstream stream(line);
+			std::string key;
+			stream >> key;
+			if (key == "runName") {
+				stream >> runName;
+			} else if (key == "driftGap") {
+				stream >> driftGap;
+			} else if (key == "VD") {
+				stream >> VD;
+			} else if (key == "VA") {
+				stream >> VA;
+			} else if (key == "numberOfAcceptedEvents") {
+				stream >> numberOfAcceptedEvents;
+			} else if (key == "lengthOfMeasurement") {
+				stream >> lengthOfMeasurement;
+			} else if (key == "hasHitWidthX") {
+				stream >> hasHitWidthX;
+			} else if (key == "hitWidthX") {
+				stream >> hitWidthX;
+			} else if (key == "hitWidthXError") {
+				stream >> hitWidthXError;
+			} else if (key == "hasHitWidthY") {
+				stream >> hasHitWidthY;
+			} else if (key == "hitWidthY") {
+				stream >> hitWidthY;
+			} else if (key == "hitWidthYError") {
+				stream >> hitWidthYError;
+			} else if (key == "meanChargeX") {
+				stream >> meanChargeX;
+			} else if (key == "meanChargeY") {
+				stream >> meanChargeY;
+			} else if (key == "meanChargeXUncut") {
+				stream >> meanChargeXUncut;
+			} else if (key == "meanChargeYUncut") {
+				stream >> meanChargeYUncut;
+			} else if (key == "settings") {
+				stream >> settings;
+			} else {
+				continue;
+			}
+			if (stream.fail()) {
+				return false;
+			}
+			numberOfValues++;
+		}
+		return numberOfValues == 17;
+	}
+};
+
+#endif /* RUNSUMMARY_H_ */
@@ -0,0 +1,426 @@
+/*
+ * SimdKernels.cxx
+ */
+
+#include "SimdKernels.h"
+
+#include <climits>
+
+#include "MMQuickEvent.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Scalar implementations (reference for all vectorized kernels)
+ */
+static void findMaxChargeScalar(const unsigned int* apvIDofStrip,
+		const short* maxChargeOfStrip, const short* timeSliceOfMaxChargeOfStrip,
+		unsigned int numberOfStrips, MaxChargeResult& result) {
+	result.maxChargeX = -1;
+	result.stripWithMaxChargeX = -1;
+	result.timeSliceOfMaxChargeX = -1;
+	result.maxChargeY = -1;
+	result.stripWithMaxChargeY = -1;
+	result.timeSliceOfMaxChargeY = -1;
+
+	result.numberOfXHits = -1;
+	result.numberOfYHits = -1;
+
+	for (unsigned int strip = 0; strip != numberOfStrips; strip++) {
+		if (MMQuickEvent::isX(apvIDofStrip[strip])) { // X axis
+			result.numberOfXHits++;
+			if (maxChargeOfStrip[strip] > result.maxChargeX) {
+				result.maxChargeX = maxChargeOfStrip[strip];
+				result.stripWithMaxChargeX = strip;
+				result.timeSliceOfMaxChargeX = timeSliceOfMaxChargeOfStrip[strip];
+			}
+		} else { // Y axis
+			result.numberOfYHits++;
+			if (maxChargeOfStrip[strip] > result.maxChargeY) {
+				result.maxChargeY = maxChargeOfStrip[strip];
+				result.stripWithMaxChargeY = strip;
+				result.timeSliceOfMaxChargeY = timeSliceOfMaxChargeOfStrip[strip];
+			}
+		}
+	}
+}
+
+/**
+ * Appends (strip number, charge) to the X or the Y cross section without branching on the axis:
+ * Both arrays are written and only the index of the right one is incremented
+ */
+static inline void appendToCrossSection(bool isX, int stripNumber,
+		short charge, std::pair<int, short>* crossSectionX,
+		unsigned int& numberOfXStrips, std::pair<int, short>* crossSectionY,
+		unsigned int& numberOfYStrips) {
+	crossSectionX[numberOfXStrips] = std::make_pair(stripNumber, charge);
+	crossSectionY[numberOfYStrips] = std::make_pair(stripNumber, charge);
+	numberOfXStrips += isX;
+	numberOfYStrips += !isX;
+}
+
+static void gatherCrossSectionsScalar(const unsigned int* apvIDofStrip,
+		const unsigned int* stripNumber, const short* chargeMatrix,
+		unsigned int stride, unsigned int numberOfStrips, int timeSliceX,
+		int timeSliceY, std::pair<int, short>* crossSectionX,
+		unsigned int& numberOfXStrips, std::pair<int, short>* crossSectionY,
+		unsigned int& numberOfYStrips) {
+	numberOfXStrips = 0;
+	numberOfYStrips = 0;
+	for (unsigned int strip = 0; strip != numberOfStrips; strip++) {
+		const bool isX = MMQuickEvent::isX(apvIDofStrip[strip]);
+		const int timeSlice = isX ? timeSliceX : timeSliceY;
+		appendToCrossSection(isX, stripNumber[strip],
+				chargeMatrix[strip * stride + timeSlice], crossSectionX,
+				numberOfXStrips, crossSectionY, numberOfYStrips);
+	}
+}
+
+#ifdef SIMD_KERNELS_X86
+
+/**
+ * Reduces the per lane maxima and their strip indices of a vectorized argmax. Ties are resolved
+ * in favour of the lower strip index as the scalar loop only replaces the maximum if the new
+ * charge is strictly larger.
+ */
+static inline void reduceLanes(const int* laneMax, const int* laneStrip,
+		unsigned int numberOfLanes, int& maxCharge, int& stripWithMaxCharge) {
+	for (unsigned int lane = 0; lane != numberOfLanes; lane++) {
+		if (laneMax[lane] > maxCharge
+				|| (laneMax[lane] == maxCharge
+						&& laneStrip[lane] < stripWithMaxCharge)) {
+			maxCharge = laneMax[lane];
+			stripWithMaxCharge = laneStrip[lane];
+		}
+	}
+}
+
+/**
+ * Continues the scalar argmax for the strips [firstStrip, numberOfStrips) and stores the result
+ */
+static inline void finishFindMaxCharge(const unsigned int* apvIDofStrip,
+		const short* maxChargeOfStrip, const short* timeSliceOfMaxChargeOfStrip,
+		unsigned int firstStrip, unsigned int numberOfStrips, int maxChargeX,
+		int stripWithMaxChargeX, int maxChargeY, int stripWithMaxChargeY,
+		int numberOfXHits, int numberOfYHits, MaxChargeResult& result) {
+	for (unsigned int strip = firstStrip; strip != numberOfStrips; strip++) {
+		if (MMQuickEvent::isX(apvIDofStrip[strip])) {
+			numberOfXHits++;
+			if (maxChargeOfStrip[strip] > maxChargeX) {
+				maxChargeX = maxChargeOfStrip[strip];
+				stripWithMaxChargeX = strip;
+			}
+		} else {
+			numberOfYHits++;
+			if (maxChargeOfStrip[strip] > maxChargeY) {
+				maxChargeY = maxChargeOfStrip[strip];
+				stripWithMaxChargeY = strip;
+			}
+		}
+	}
+
+	result.maxChargeX = maxChargeX;
+	result.stripWithMaxChargeX = stripWithMaxChargeX;
+	result.timeSliceOfMaxChargeX =
+			stripWithMaxChargeX == -1 ?
+					-1 : timeSliceOfMaxChargeOfStrip[stripWithMaxChargeX];
+	result.maxChargeY = maxChargeY;
+	result.stripWithMaxChargeY = stripWithMaxChargeY;
+	result.timeSliceOfMaxChargeY =
+			stripWithMaxChargeY == -1 ?
+					-1 : timeSliceOfMaxChargeOfStrip[stripWithMaxChargeY];
+	result.numberOfXHits = numberOfXHits;
+	result.numberOfYHits = numberOfYHits;
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i isXMaskSSE4(__m128i apvID) {
+	return _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(apvID, _mm_set1_epi32(APVIDMM_X0)),
+					_mm_cmpeq_epi32(apvID, _mm_set1_epi32(APVIDMM_X1))),
+			_mm_cmpeq_epi32(apvID, _mm_set1_epi32(APVIDMM_X2)));
+}
+
+__attribute__((target("sse4.1")))
+static void findMaxChargeSSE4(const unsigned int* apvIDofStrip,
+		const short* maxChargeOfStrip, const short* timeSliceOfMaxChargeOfStrip,
+		unsigned int numberOfStrips, MaxChargeResult& result) {
+	const __m128i masked = _mm_set1_epi32(INT_MIN); // never larger than any charge
+	__m128i maxX = _mm_set1_epi32(-1);
+	__m128i maxY = _mm_set1_epi32(-1);
+	__m128i stripX = _mm_set1_epi32(-1);
+	__m128i stripY = _mm_set1_epi32(-1);
+	__m128i strip = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i stripIncrement = _mm_set1_epi32(4);
+	int numberOfXHits = -1;
+	int numberOfYHits = -1;
+
+	unsigned int i = 0;
+	for (; i + 4 <= numberOfStrips; i += 4) {
+		const __m128i isX = isXMaskSSE4(
+				_mm_loadu_si128((const __m128i*) (apvIDofStrip + i)));
+		const __m128i charge = _mm_cvtepi16_epi32(
+				_mm_loadl_epi64((const __m128i*) (maxChargeOfStrip + i)));
+
+		const __m128i chargeX = _mm_blendv_epi8(masked, charge, isX);
+		const __m128i chargeY = _mm_blendv_epi8(charge, masked, isX);
+
+		const __m128i largerX = _mm_cmpgt_epi32(chargeX, maxX);
+		const __m128i largerY = _mm_cmpgt_epi32(chargeY, maxY);
+		maxX = _mm_blendv_epi8(maxX, chargeX, largerX);
+		maxY = _mm_blendv_epi8(maxY, chargeY, largerY);
+		stripX = _mm_blendv_epi8(stripX, strip, largerX);
+		stripY = _mm_blendv_epi8(stripY, strip, largerY);
+		strip = _mm_add_epi32(strip, stripIncrement);
+
+		const int xStripsInBlock = __builtin_popcount(
+				_mm_movemask_ps(_mm_castsi128_ps(isX)));
+		numberOfXHits += xStripsInBlock;
+		numberOfYHits += 4 - xStripsInBlock;
+	}
+
+	int laneMax[4], laneStrip[4];
+	int maxChargeX = -1, stripWithMaxChargeX = -1;
+	int maxChargeY = -1, stripWithMaxChargeY = -1;
+	_mm_storeu_si128((__m128i*) laneMax, maxX);
+	_mm_storeu_si128((__m128i*) laneStrip, stripX);
+	reduceLanes(laneMax, laneStrip, 4, maxChargeX, stripWithMaxChargeX);
+	_mm_storeu_si128((__m128i*) laneMax, maxY);
+	_mm_storeu_si128((__m128i*) laneStrip, stripY);
+	reduceLanes(laneMax, laneStrip, 4, maxChargeY, stripWithMaxChargeY);
+
+	finishFindMaxCharge(apvIDofStrip, maxChargeOfStrip,
+			timeSliceOfMaxChargeOfStrip, i, numberOfStrips, maxChargeX,
+			stripWithMaxChargeX, maxChargeY, stripWithMaxChargeY, numberOfXHits,
+			numberOfYHits, result);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i isXMaskAVX2(__m256i apvID) {
+	return _mm256_or_si256(
+			_mm256_or_si256(
+					_mm256_cmpeq_epi32(apvID, _mm256_set1_epi32(APVIDMM_X0)),
+					_mm256_cmpeq_epi32(apvID, _mm256_set1_epi32(APVIDMM_X1))),
+			_mm256_cmpeq_epi32(apvID, _mm256_set1_epi32(APVIDMM_X2)));
+}
+
+__attribute__((target("avx2")))
+static void findMaxChargeAVX2(const unsigned int* apvIDofStrip,
+		const short* maxChargeOfStrip, const short* timeSliceOfMaxChargeOfStrip,
+		unsigned int numberOfStrips, MaxChargeResult& result) {
+	const __m256i masked = _mm256_set1_epi32(INT_MIN); // never larger than any charge
+	__m256i maxX = _mm256_set1_epi32(-1);
+	__m256i maxY = _mm256_set1_epi32(-1);
+	__m256i stripX = _mm256_set1_epi32(-1);
+	__m256i stripY = _mm256_set1_epi32(-1);
+	__m256i strip = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i stripIncrement = _mm256_set1_epi32(8);
+	int numberOfXHits = -1;
+	int numberOfYHits = -1;
+
+	unsigned int i = 0;
+	for (; i + 8 <= numberOfStrips; i += 8) {
+		const __m256i isX = isXMaskAVX2(
+				_mm256_loadu_si256((const __m256i*) (apvIDofStrip + i)));
+		const __m256i charge = _mm256_cvtepi16_epi32(
+				_mm_loadu_si128((const __m128i*) (maxChargeOfStrip + i)));
+
+		const __m256i chargeX = _mm256_blendv_epi8(masked, charge, isX);
+		const __m256i chargeY = _mm256_blendv_epi8(charge, masked, isX);
+
+		const __m256i largerX = _mm256_cmpgt_epi32(chargeX, maxX);
+		const __m256i largerY = _mm256_cmpgt_epi32(chargeY, maxY);
+		maxX = _mm256_blendv_epi8(maxX, chargeX, largerX);
+		maxY = _mm256_blendv_epi8(maxY, chargeY, largerY);
+		stripX = _mm256_blendv_epi8(stripX, strip, largerX);
+		stripY = _mm256_blendv_epi8(stripY, strip, largerY);
+		strip = _mm256_add_epi32(strip, stripIncrement);
+
+		const int xStripsInBlock = __builtin_popcount(
+				_mm256_movemask_ps(_mm256_castsi256_ps(isX)));
+		numberOfXHits += xStripsInBlock;
+		numberOfYHits += 8 - xStripsInBlock;
+	}
+
+	int laneMax[8], laneStrip[8];
+	int maxChargeX = -1, stripWithMaxChargeX = -1;
+	int maxChargeY = -1, stripWithMaxChargeY = -1;
+	_mm256_storeu_si256((__m256i*) laneMax, maxX);
+	_mm256_storeu_si256((__m256i*) laneStrip, stripX);
+	reduceLanes(laneMax, laneStrip, 8, maxChargeX, stripWithMaxChargeX);
+	_mm256_storeu_si256((__m256i*) laneMax, maxY);
+	_mm256_storeu_si256((__m256i*) laneStrip, stripY);
+	reduceLanes(laneMax, laneStrip, 8, maxChargeY, stripWithMaxChargeY);
+
+	finishFindMaxCharge(apvIDofStrip, maxChargeOfStrip,
+			timeSliceOfMaxChargeOfStrip, i, numberOfStrips, maxChargeX,
+			stripWithMaxChargeX, maxChargeY, stripWithMaxChargeY, numberOfXHits,
+			numberOfYHits, result);
+}
+
+/*
+ * SSE4.1 has no gather instruction: the matrix offsets of the charges are computed vectorized
+ * and the charges are loaded one by one
+ */
+__attribute__((target("sse4.1")))
+static void gatherCrossSectionsSSE4(const unsigned int* apvIDofStrip,
+		const unsigned int* stripNumber, const short* chargeMatrix,
+		unsigned int stride, unsigned int numberOfStrips, int timeSliceX,
+		int timeSliceY, std::pair<int, short>* crossSectionX,
+		unsigned int& numberOfXStrips, std::pair<int, short>* crossSectionY,
+		unsigned int& numberOfYStrips) {
+	numberOfXStrips = 0;
+	numberOfYStrips = 0;
+
+	const __m128i timeSlicesX = _mm_set1_epi32(timeSliceX);
+	const __m128i timeSlicesY = _mm_set1_epi32(timeSliceY);
+	const __m128i strides = _mm_set1_epi32(stride);
+	__m128i strip = _mm_setr_epi32(0, 1, 2, 3);
+	const __m128i stripIncrement = _mm_set1_epi32(4);
+
+	int offset[4], isX[4];
+	unsigned int i = 0;
+	for (; i + 4 <= numberOfStrips; i += 4) {
+		const __m128i isXMask = isXMaskSSE4(
+				_mm_loadu_si128((const __m128i*) (apvIDofStrip + i)));
+		const __m128i timeSlice = _mm_blendv_epi8(timeSlicesY, timeSlicesX,
+				isXMask);
+		_mm_storeu_si128((__m128i*) offset,
+				_mm_add_epi32(_mm_mullo_epi32(strip, strides), timeSlice));
+		_mm_storeu_si128((__m128i*) isX, isXMask);
+		strip = _mm_add_epi32(strip, stripIncrement);
+
+		for (unsigned int lane = 0; lane != 4; lane++) {
+			appendToCrossSection(isX[lane] != 0, stripNumber[i + lane],
+					chargeMatrix[offset[lane]], crossSectionX, numberOfXStrips,
+					crossSectionY, numberOfYStrips);
+		}
+	}
+
+	for (; i != numberOfStrips; i++) {
+		const bool isXStrip = MMQuickEvent::isX(apvIDofStrip[i]);
+		appendToCrossSection(isXStrip, stripNumber[i],
+				chargeMatrix[i * stride + (isXStrip ? timeSliceX : timeSliceY)],
+				crossSectionX, numberOfXStrips, crossSectionY, numberOfYStrips);
+	}
+}
+
+/*
+ * The charges are gathered as 32 bit integers starting at the 16 bit charge. The upper half
+ * belongs to the next time slice which is always inside the row as the time slices are smaller
+ * than stride-1.
+ */
+__attribute__((target("avx2")))
+static void gatherCrossSectionsAVX2(const unsigned int* apvIDofStrip,
+		const unsigned int* stripNumber, const short* chargeMatrix,
+		unsigned int stride, unsigned int numberOfStrips, int timeSliceX,
+		int timeSliceY, std::pair<int, short>* crossSectionX,
+		unsigned int& numberOfXStrips, std::pair<int, short>* crossSectionY,
+		unsigned int& numberOfYStrips) {
+	numberOfXStrips = 0;
+	numberOfYStrips = 0;
+
+	const __m256i timeSlicesX = _mm256_set1_epi32(timeSliceX);
+	const __m256i timeSlicesY = _mm256_set1_epi32(timeSliceY);
+	const __m256i strides = _mm256_set1_epi32(stride);
+	__m256i strip = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i stripIncrement = _mm256_set1_epi32(8);
+
+	int charge[8], isX[8];
+	unsigned int i = 0;
+	for (; i + 8 <= numberOfStrips; i += 8) {
+		const __m256i isXMask = isXMaskAVX2(
+				_mm256_loadu_si256((const __m256i*) (apvIDofStrip + i)));
+		const __m256i timeSlice = _mm256_blendv_epi8(timeSlicesY, timeSlicesX,
+				isXMask);
+		const __m256i offset = _mm256_add_epi32(
+				_mm256_mullo_epi32(strip, strides), timeSlice);
+		_mm256_storeu_si256((__m256i*) charge,
+				_mm256_i32gather_epi32((const int* ) chargeMatrix, offset,
+						sizeof(short)));
+		_mm256_storeu_si256((__m256i*) isX, isXMask);
+		strip = _mm256_add_epi32(strip, stripIncrement);
+
+		for (unsigned int lane = 0; lane != 8; lane++) {
+			appendToCrossSection(isX[lane] != 0, stripNumber[i + lane],
+					(short) charge[lane], crossSectionX, numberOfXStrips,
+					crossSectionY, numberOfYStrips);
+		}
+	}
+
+	for (; i != numberOfStrips; i++) {
+		const bool isXStrip = MMQuickEvent::isX(apvIDofStrip[i]);
+		appendToCrossSection(isXStrip, stripNumber[i],
+				chargeMatrix[i * stride + (isXStrip ? timeSliceX : timeSliceY)],
+				crossSectionX, numberOfXStrips, crossSectionY, numberOfYStrips);
+	}
+}
+
+#endif
+
+SimdKernels::InstructionSet SimdKernels::s_instructionSet = SimdKernels::SCALAR;
+SimdKernels::FindMaxChargeKernel SimdKernels::s_findMaxCharge =
+		&findMaxChargeScalar;
+SimdKernels::GatherCrossSectionsKernel SimdKernels::s_gatherCrossSections =
+		&gatherCrossSectionsScalar;
+
+SimdKernels::InstructionSet SimdKernels::detectInstructionSet() {
+#ifdef SIMD_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return AVX2;
+	}
+	if (__builtin_cpu_supports("sse4.1")) {
+		return SSE4;
+	}
+#endif
+	return SCALAR;
+}
+
+void SimdKernels::setInstructionSet(InstructionSet instructionSet) {
+	const InstructionSet supported = detectInstructionSet();
+	if (instructionSet > supported) {
+		instructionSet = supported;
+	}
+
+	s_instructionSet = instructionSet;
+	switch (instructionSet) {
+#ifdef SIMD_KERNELS_X86
+	case AVX2:
+		s_findMaxCharge = &findMaxChargeAVX2;
+		s_gatherCrossSections = &gatherCrossSectionsAVX2;
+		break;
+	case SSE4:
+		s_findMaxCharge = &findMaxChargeSSE4;
+		s_gatherCrossSections = &gatherCrossSectionsSSE4;
+		break;
+#endif
+	default:
+		s_instructionSet = SCALAR;
+		s_findMaxCharge = &findMaxChargeScalar;
+		s_gatherCrossSections = &gatherCrossSectionsScalar;
+	}
+}
+
+const char* SimdKernels::getInstructionSetName(InstructionSet instructionSet) {
+	switch (instructionSet) {
+	case AVX2:
+		return "AVX2";
+	case SSE4:
+		return "SSE4.1";
+	default:
+		return "scalar";
+	}
+}
+
+/*
+ * Select the fastest kernels supported by the CPU at startup
+ */
+static struct SimdKernelsInitializer {
+	SimdKernelsInitializer() {
+		SimdKernels::setInstructionSet(SimdKernels::detectInstructionSet());
+	}
+} simdKernelsInitializer;
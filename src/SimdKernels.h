@@ -0,0 +1,100 @@
+/*
+ * SimdKernels.h
+ */
+
+#ifndef SIMDKERNELS_H_
+#define SIMDKERNELS_H_
+
+#include <utility>
+
+/**
+ * Result of the search for the strips with the maximum charge in X and Y (see
+ * MMQuickEvent::findMaxCharge). Charges, strips and time slices are -1 if no strip with a
+ * charge larger than -1 has been found. The numbers of hits are the numbers of strips minus one.
+ */
+struct MaxChargeResult {
+	short maxChargeX;
+	int stripWithMaxChargeX;
+	int timeSliceOfMaxChargeX;
+	short maxChargeY;
+	int stripWithMaxChargeY;
+	int timeSliceOfMaxChargeY;
+
+	short numberOfXHits;
+	short numberOfYHits;
+};
+
+/**
+ * Vectorized versions of the per strip loops of MMQuickEvent. Every kernel exists as AVX2, SSE4.1
+ * and scalar implementation. The fastest implementation supported by the CPU is selected at
+ * startup; all implementations return bit-identical results (checked by KernelBenchmark --check,
+ * see the target check of the Makefile).
+ */
+class SimdKernels {
+public:
+	enum InstructionSet {
+		SCALAR, SSE4, AVX2
+	};
+
+	/**
+	 * Masked argmax of maxChargeOfStrip separately for X and Y strips (isX(apvIDofStrip[i])).
+	 * Ties are resolved in favour of the strip with the lower index.
+	 */
+	static void findMaxCharge(const unsigned int* apvIDofStrip,
+			const short* maxChargeOfStrip,
+			const short* timeSliceOfMaxChargeOfStrip,
+			unsigned int numberOfStrips, MaxChargeResult& result) {
+		s_findMaxCharge(apvIDofStrip, maxChargeOfStrip,
+				timeSliceOfMaxChargeOfStrip, numberOfStrips, result);
+	}
+
+	/**
+	 * Gathers the charge of every strip at a fixed time slice (timeSliceX for X strips and
+	 * timeSliceY for Y strips) from the strip x time charge matrix and stores (strip number,
+	 * charge) pairs in the order of the strips in crossSectionX/Y. Both arrays must be able to
+	 * store numberOfStrips entries.
+	 *
+	 * Both time slices must be in the range [0, stride-1) (see ChargeMatrix)
+	 */
+	static void gatherCrossSections(const unsigned int* apvIDofStrip,
+			const unsigned int* stripNumber, const short* chargeMatrix,
+			unsigned int stride, unsigned int numberOfStrips, int timeSliceX,
+			int timeSliceY, std::pair<int, short>* crossSectionX,
+			unsigned int& numberOfXStrips, std::pair<int, short>* crossSectionY,
+			unsigned int& numberOfYStrips) {
+		s_gatherCrossSections(apvIDofStrip, stripNumber, chargeMatrix, stride,
+				numberOfStrips, timeSliceX, timeSliceY, crossSectionX,
+				numberOfXStrips, crossSectionY, numberOfYStrips);
+	}
+
+	/**
+	 * Returns the best instruction set supported by the CPU
+	 */
+	static InstructionSet detectInstructionSet();
+
+	/**
+	 * Selects the implementation of all kernels. Selecting an instruction set not supported by
+	 * the CPU falls back to the best supported one.
+	 */
+	static void setInstructionSet(InstructionSet instructionSet);
+
+	static InstructionSet getInstructionSet() {
+		return s_instructionSet;
+	}
+
+	static const char* getInstructionSetName(InstructionSet instructionSet);
+
+private:
+	typedef void (*FindMaxChargeKernel)(const unsigned int*, const short*,
+			const short*, unsigned int, MaxChargeResult&);
+	typedef void (*GatherCrossSectionsKernel)(const unsigned int*,
+			const unsigned int*, const short*, unsigned int, unsigned int, int,
+			int, std::pair<int, short>*, unsigned int&, std::pair<int, short>*,
+			unsigned int&);
+
+	static InstructionSet s_instructionSet;
+	static FindMaxChargeKernel s_findMaxCharge;
+	static GatherCrossSectionsKernel s_gatherCrossSections;
+};
+
+#endif /* SIMDKERNELS_H_ */
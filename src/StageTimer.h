@@ -0,0 +1,200 @@
+/*
+ * StageTimer.h
+ */
+
+#ifndef STAGETIMER_H_
+#define STAGETIMER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/*
+ * Stages of the analysis chain timed by MM_TIME_STAGE
+ */
+enum class TimedStage {
+	ENTRY_LOADING, // MMQuickEvent::getNextEvent and loadCharges
+	FIND_MAX_CHARGE,
+	CROSS_SECTIONS, // generateFixedTimeCrossSections
+	PROPORTION_CUT,
+	HIT_FIT, // HitEstimator::estimate (fitGauss for the Minuit estimator)
+	HISTOGRAM_FILLS,
+	TREE_FILLS,
+	PDF_OUTPUT, // writeToPdf and writeTH2FToPdf, only the queuing if rendered asynchronously
+	NUMBER_OF_STAGES
+};
+
+/**
+ * Time spent and number of calls per TimedStage. The times are exclusive: a stage timed inside
+ * another one (e.g. loading the charges for the cross sections) is not counted for the outer one.
+ */
+struct StageTimes {
+	static const unsigned int NUMBER_OF_STAGES =
+			(unsigned int) TimedStage::NUMBER_OF_STAGES;
+
+	uint64_t nanoseconds[NUMBER_OF_STAGES];
+	uint64_t calls[NUMBER_OF_STAGES];
+
+	StageTimes() {
+		reset();
+	}
+
+	void reset() {
+		for (unsigned int i = 0; i < NUMBER_OF_STAGES; i++) {
+			nanoseconds[i] = 0;
+			calls[i] = 0;
+		}
+	}
+
+	void add(const StageTimes& other) {
+		for (unsigned int i = 0; i < NUMBER_OF_STAGES; i++) {
+			nanoseconds[i] += other.nanoseconds[i];
+			calls[i] += other.calls[i];
+		}
+	}
+
+	static const char* getName(unsigned int stage) {
+		static const char* names[NUMBER_OF_STAGES] = { "entry loading",
+				"findMaxCharge", "cross sections", "proportion cut", "hit fit",
+				"histogram fills", "tree fills", "pdf output" };
+		return names[stage];
+	}
+
+	/**
+	 * Prints the time, calls, time per call and share of every stage. Prints nothing if nothing has
+	 * been timed (MM_ENABLE_TIMING not defined).
+	 */
+	void print(const std::string& title) const {
+		uint64_t total = 0;
+		for (unsigned int i = 0; i < NUMBER_OF_STAGES; i++) {
+			total += nanoseconds[i];
+		}
+		if (total == 0) {
+			return;
+		}
+
+		std::stringstream report;
+		report << "Time per stage of " << title
+				<< " (stage, ms, calls, ns/call, %):" << std::endl;
+		for (unsigned int i = 0; i < NUMBER_OF_STAGES; i++) {
+			report << "  " << getName(i) << "\t" << nanoseconds[i] / 1e6
+					<< "\t" << calls[i] << "\t"
+					<< (calls[i] == 0 ? 0 : nanoseconds[i] / calls[i]) << "\t"
+					<< 100. * nanoseconds[i] / total << "%" << std::endl;
+		}
+		report << "  total\t" << total / 1e6 << std::endl;
+		std::cout << report.str();
+	}
+};
+
+/**
+ * Per-thread state of the stage timers: the StageTimes the current thread adds to (see
+ * StageTimeCollector), the stage being timed and when it was entered or resumed
+ */
+class StageTimer {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	/**
+	 * Times collected by the current thread outside of any StageTimeCollector
+	 */
+	static StageTimes& getThreadTimes() {
+		static thread_local StageTimes times;
+		return times;
+	}
+
+	static StageTimes*& target() {
+		static thread_local StageTimes* times = NULL;
+		return times;
+	}
+
+	static int& currentStage() {
+		static thread_local int stage = -1;
+		return stage;
+	}
+
+	static Clock::time_point& lastSwitch() {
+		static thread_local Clock::time_point time;
+		return time;
+	}
+
+	/*
+	 * Adds the time since the last switch to the current stage
+	 */
+	static void accountCurrentStage(Clock::time_point now) {
+		if (currentStage() >= 0) {
+			StageTimes* times = target() != NULL ? target() : &getThreadTimes();
+			times->nanoseconds[currentStage()] += std::chrono::duration_cast<
+					std::chrono::nanoseconds>(now - lastSwitch()).count();
+		}
+		lastSwitch() = now;
+	}
+};
+
+/**
+ * Times the enclosing scope as <stage>, pausing the stage that was being timed before
+ */
+class ScopedStageTimer {
+public:
+	explicit ScopedStageTimer(TimedStage stage) :
+			previousStage(StageTimer::currentStage()) {
+		StageTimer::accountCurrentStage(StageTimer::Clock::now());
+		StageTimer::currentStage() = (int) stage;
+	}
+
+	~ScopedStageTimer() {
+		StageTimer::accountCurrentStage(StageTimer::Clock::now());
+		StageTimes* times =
+				StageTimer::target() != NULL ?
+						StageTimer::target() : &StageTimer::getThreadTimes();
+		times->calls[StageTimer::currentStage()]++;
+		StageTimer::currentStage() = previousStage;
+	}
+
+private:
+	int previousStage;
+
+	ScopedStageTimer(const ScopedStageTimer&);
+	ScopedStageTimer& operator=(const ScopedStageTimer&);
+};
+
+/**
+ * All stages timed by the current thread while this object exists are added to <times> (e.g. the
+ * StageTimes of the AnalysisContext of the run being processed)
+ */
+class StageTimeCollector {
+public:
+	explicit StageTimeCollector(StageTimes& times) :
+			previousTarget(StageTimer::target()) {
+		StageTimer::accountCurrentStage(StageTimer::Clock::now());
+		StageTimer::target() = &times;
+	}
+
+	~StageTimeCollector() {
+		StageTimer::accountCurrentStage(StageTimer::Clock::now());
+		StageTimer::target() = previousTarget;
+	}
+
+private:
+	StageTimes* previousTarget;
+
+	StageTimeCollector(const StageTimeCollector&);
+	StageTimeCollector& operator=(const StageTimeCollector&);
+};
+
+/*
+ * Times the rest of the enclosing scope as TimedStage::<stage>. Compiled to nothing unless
+ * MM_ENABLE_TIMING is defined (see Makefile).
+ */
+#ifdef MM_ENABLE_TIMING
+#define MM_TIME_STAGE_NAME2(line) stageTimer ## line
+#define MM_TIME_STAGE_NAME(line) MM_TIME_STAGE_NAME2(line)
+#define MM_TIME_STAGE(stage) \
+	ScopedStageTimer MM_TIME_STAGE_NAME(__LINE__)(TimedStage::stage)
+#else
+#define MM_TIME_STAGE(stage)
+#endif
+
+#endif /* STAGETIMER_H_ */
@@ -0,0 +1,180 @@
+/*
+ * SyntheticEventGenerator.cxx
+ */
+
+#include "SyntheticEventGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "MMQuickEvent.h"
+
+/*
+ * Range of the pedestal subtracted charges of the 12 bit ADCs
+ */
+static const int MIN_ADC_CHARGE = -4096;
+static const int MAX_ADC_CHARGE = 4095;
+
+static const unsigned int STRIPS_PER_APV = 128;
+
+static const int APV_IDS_X[3] = { APVIDMM_X0, APVIDMM_X1, APVIDMM_X2 };
+static const int APV_IDS_Y[3] = { APVIDMM_Y0, APVIDMM_Y1, APVIDMM_Y2 };
+
+/*
+ * Values of the branches the analysis does not read
+ */
+static const unsigned int FEC_NUMBER = 1;
+static const char* DETECTOR_NAME = "MM";
+static const unsigned int READOUT_X = 0;
+static const unsigned int READOUT_Y = 1;
+
+SyntheticEventParameters::SyntheticEventParameters() :
+		rate(100), additionalHits(0), amplitudeSpread(0.5), noiseSigma(8), zeroSuppression(
+				3), pulseShapeOrder(1), shapingTime(3), minPulseStart(2), maxPulseStart(
+				12), numberOfTimeSlices(NUMBER_OF_TIME_SLICES) {
+	x.clusterWidth = 5;
+	x.amplitude = 400;
+	x.numberOfNoiseStrips = 4;
+
+	y.clusterWidth = 9;
+	y.amplitude = 600;
+	y.numberOfNoiseStrips = 4;
+}
+
+void SyntheticEventGenerator::generate(SyntheticEvent& event) {
+	event.clear();
+
+	event.apv_evt = numberOfEvents++;
+	timeOfLastEvent += std::exponential_distribution<double>(parameters.rate)(
+			random);
+	event.time_s = (int) timeOfLastEvent;
+	event.time_us = (int) ((timeOfLastEvent - event.time_s) * 1e6);
+	event.apv_presamples = 0;
+
+	const unsigned int numberOfHits = 1
+			+ (parameters.additionalHits > 0 ?
+					std::poisson_distribution<unsigned int>(
+							parameters.additionalHits)(random) :
+					0);
+
+	StripSignals signalsX;
+	StripSignals signalsY;
+	std::set<int> centerStripsX;
+	std::set<int> centerStripsY;
+	for (unsigned int hit = 0; hit != numberOfHits; hit++) {
+		const double pulseStart = std::uniform_real_distribution<double>(
+				parameters.minPulseStart, parameters.maxPulseStart)(random);
+		double position, amplitude;
+		addCluster(parameters.x, xStrips, pulseStart, signalsX, centerStripsX,
+				position, amplitude);
+		event.truth.positionX.push_back(position);
+		event.truth.amplitudeX.push_back(amplitude);
+		addCluster(parameters.y, yStrips, pulseStart, signalsY, centerStripsY,
+				position, amplitude);
+		event.truth.positionY.push_back(position);
+		event.truth.amplitudeY.push_back(amplitude);
+		event.truth.peakTime.push_back(pulseStart + parameters.shapingTime);
+	}
+
+	readOutAxis(parameters.x, true, xStrips, signalsX, centerStripsX, event);
+	readOutAxis(parameters.y, false, yStrips, signalsY, centerStripsY, event);
+}
+
+void SyntheticEventGenerator::addCluster(const SyntheticAxisParameters& axis,
+		unsigned int numberOfStrips, double pulseStart, StripSignals& signals,
+		std::set<int>& centerStrips, double& position, double& amplitude) {
+	amplitude = std::min((double) MAX_ADC_CHARGE,
+			std::lognormal_distribution<double>(std::log(axis.amplitude),
+					parameters.amplitudeSpread)(random));
+	position = std::uniform_real_distribution<double>(1, numberOfStrips)(
+			random);
+
+	/*
+	 * Strips up to clusterWidth (4 sigma) away from the center, the outer ones are usually zero
+	 * suppressed
+	 */
+	const double sigma = axis.clusterWidth / 4;
+	const int centerStrip = std::lround(position);
+	const int firstStrip = std::max(1,
+			centerStrip - (int) std::ceil(axis.clusterWidth));
+	const int lastStrip = std::min((int) numberOfStrips,
+			centerStrip + (int) std::ceil(axis.clusterWidth));
+	centerStrips.insert(centerStrip);
+
+	const unsigned int n = parameters.pulseShapeOrder;
+	for (int strip = firstStrip; strip <= lastStrip; strip++) {
+		const double distance = (strip - position) / sigma;
+		const double stripAmplitude = amplitude
+				* std::exp(-0.5 * distance * distance);
+
+		std::vector<double>& signal = signals[strip];
+		signal.resize(parameters.numberOfTimeSlices, 0);
+		for (unsigned int time = 0; time != parameters.numberOfTimeSlices;
+				time++) {
+			const double t = (time - pulseStart) / parameters.shapingTime;
+			if (t > 0) {
+				signal[time] += stripAmplitude * std::pow(t, n)
+						* std::exp(n * (1 - t));
+			}
+		}
+	}
+}
+
+void SyntheticEventGenerator::readOutAxis(const SyntheticAxisParameters& axis,
+		bool isX, unsigned int numberOfStrips, const StripSignals& signals,
+		const std::set<int>& centerStrips, SyntheticEvent& event) {
+	for (auto& pair : signals) {
+		addStrip(isX, pair.first, pair.second,
+				centerStrips.count(pair.first) == 0, event);
+	}
+
+	// Noise strips outside of the clusters, each one only once
+	const std::vector<double> noSignal(parameters.numberOfTimeSlices, 0);
+	std::set<int> noiseStrips;
+	std::uniform_int_distribution<int> drawStrip(1, numberOfStrips);
+	while (noiseStrips.size() < axis.numberOfNoiseStrips
+			&& noiseStrips.size() + signals.size() < numberOfStrips) {
+		const int strip = drawStrip(random);
+		if (signals.count(strip) != 0 || !noiseStrips.insert(strip).second) {
+			continue;
+		}
+		addStrip(isX, strip, noSignal, false, event);
+	}
+}
+
+bool SyntheticEventGenerator::addStrip(bool isX, unsigned int strip,
+		const std::vector<double>& signal, bool zeroSuppressed,
+		SyntheticEvent& event) {
+	std::normal_distribution<double> noise(0, parameters.noiseSigma);
+	std::vector<short> charges(parameters.numberOfTimeSlices);
+	short maxCharge = MIN_ADC_CHARGE;
+	short timeSliceOfMaxCharge = 0;
+	for (unsigned int time = 0; time != parameters.numberOfTimeSlices;
+			time++) {
+		const int charge = std::lround(signal[time] + noise(random));
+		charges[time] = std::max(MIN_ADC_CHARGE,
+				std::min(MAX_ADC_CHARGE, charge));
+		if (charges[time] > maxCharge) {
+			maxCharge = charges[time];
+			timeSliceOfMaxCharge = time;
+		}
+	}
+
+	if (zeroSuppressed
+			&& maxCharge < parameters.zeroSuppression * parameters.noiseSigma) {
+		return false;
+	}
+
+	const unsigned int channel = (strip - 1) % STRIPS_PER_APV;
+	const unsigned int apv = (strip - 1) / STRIPS_PER_APV;
+	event.apv_fecNo.push_back(FEC_NUMBER);
+	event.apv_id.push_back(isX ? APV_IDS_X[apv] : APV_IDS_Y[apv]);
+	event.apv_ch.push_back(channel);
+	event.mm_id.push_back(DETECTOR_NAME);
+	event.mm_readout.push_back(isX ? READOUT_X : READOUT_Y);
+	event.mm_strip.push_back(strip);
+	event.apv_q.push_back(charges);
+	event.apv_qmax.push_back(maxCharge);
+	event.apv_tbqmax.push_back(timeSliceOfMaxCharge);
+	return true;
+}
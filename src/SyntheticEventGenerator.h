@@ -0,0 +1,166 @@
+/*
+ * SyntheticEventGenerator.h
+ */
+
+#ifndef SYNTHETICEVENTGENERATOR_H_
+#define SYNTHETICEVENTGENERATOR_H_
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * Shape of the hits on one axis
+ */
+struct SyntheticAxisParameters {
+	double clusterWidth; // strips, the charge profile is a Gaussian with sigma = clusterWidth/4
+	double amplitude; // median of the (lognormal) maximum charge of the cluster in ADC counts
+	unsigned int numberOfNoiseStrips; // strips read out only because of noise
+};
+
+/**
+ * Parameters of the events generated by SyntheticEventGenerator. The defaults roughly resemble the
+ * events of the test beam campaign.
+ */
+struct SyntheticEventParameters {
+	SyntheticAxisParameters x;
+	SyntheticAxisParameters y;
+
+	double rate; // mean number of events per second, the times between events are exponential
+
+	/*
+	 * Every event has at least one hit (particle) with a cluster on both axes, plus a Poisson
+	 * distributed number of additional hits with this mean
+	 */
+	double additionalHits;
+
+	double amplitudeSpread; // sigma of the logarithm of the amplitude
+	double noiseSigma; // ADC counts, added to every time slice of every strip
+	double zeroSuppression; // strips with a maximum below zeroSuppression*noiseSigma are not read out
+
+	/*
+	 * Every strip of a hit has the CR-RC^n pulse shape (t/tau)^n*exp(n*(1-t/tau)) with its maximum
+	 * at t = tau, starting at a time slice uniformly distributed in [minPulseStart, maxPulseStart].
+	 * The X and Y cluster of a hit start at the same time.
+	 */
+	unsigned int pulseShapeOrder; // n
+	double shapingTime; // tau in time slices
+	double minPulseStart;
+	double maxPulseStart;
+	unsigned int numberOfTimeSlices;
+
+	SyntheticEventParameters();
+};
+
+/*
+ * True parameters of the hits of an event: hit i has the X cluster at positionX[i] and the Y
+ * cluster at positionY[i]
+ */
+struct SyntheticTruth {
+	std::vector<double> positionX; // absolute strip number of the cluster center
+	std::vector<double> amplitudeX; // maximum charge of the pulse of a strip at the cluster center
+	std::vector<double> positionY;
+	std::vector<double> amplitudeY;
+	std::vector<double> peakTime; // time slice of the maximum of the pulses
+};
+
+/**
+ * One generated event with all branches of the raw tree (see MMQuickEvent::addBranches) and the
+ * true hit parameters
+ */
+struct SyntheticEvent {
+	unsigned int apv_evt;
+	int time_s;
+	int time_us;
+	std::vector<unsigned int> apv_fecNo;
+	std::vector<unsigned int> apv_id;
+	std::vector<unsigned int> apv_ch;
+	std::vector<std::string> mm_id;
+	std::vector<unsigned int> mm_readout;
+	std::vector<unsigned int> mm_strip;
+	std::vector<std::vector<short> > apv_q;
+	unsigned int apv_presamples;
+	std::vector<short> apv_qmax;
+	std::vector<short> apv_tbqmax;
+
+	SyntheticTruth truth;
+
+	void clear() {
+		apv_fecNo.clear();
+		apv_id.clear();
+		apv_ch.clear();
+		mm_id.clear();
+		mm_readout.clear();
+		mm_strip.clear();
+		apv_q.clear();
+		apv_qmax.clear();
+		apv_tbqmax.clear();
+		truth.positionX.clear();
+		truth.amplitudeX.clear();
+		truth.positionY.clear();
+		truth.amplitudeY.clear();
+		truth.peakTime.clear();
+	}
+};
+
+/**
+ * Generates events with hits on top of noise. The strip at the center of each hit is never zero
+ * suppressed, so every event has X and Y strips. The charges of overlapping clusters add up. The
+ * events only depend on the parameters and the seed.
+ */
+class SyntheticEventGenerator {
+public:
+	SyntheticEventGenerator(const SyntheticEventParameters& _parameters,
+			unsigned int seed) :
+			parameters(_parameters), random(seed), numberOfEvents(0), timeOfLastEvent(0) {
+	}
+
+	/**
+	 * Replaces the content of <event> by the next event
+	 */
+	void generate(SyntheticEvent& event);
+
+	const SyntheticEventParameters& getParameters() const {
+		return parameters;
+	}
+
+private:
+	/*
+	 * Pulse heights (amplitude times the charge profile) of all hits of one axis per strip and time
+	 * slice, before the noise is added
+	 */
+	typedef std::map<int, std::vector<double> > StripSignals;
+
+	/*
+	 * Adds a cluster at a random position to <signals> and returns its position and amplitude
+	 */
+	void addCluster(const SyntheticAxisParameters& axis,
+			unsigned int numberOfStrips, double pulseStart,
+			StripSignals& signals, std::set<int>& centerStrips,
+			double& position, double& amplitude);
+
+	/*
+	 * Adds noise to the strips of <signals> and to additional noise strips and appends them to
+	 * <event> as strips of the X or Y APVs
+	 */
+	void readOutAxis(const SyntheticAxisParameters& axis, bool isX,
+			unsigned int numberOfStrips, const StripSignals& signals,
+			const std::set<int>& centerStrips, SyntheticEvent& event);
+
+	/*
+	 * Appends a strip with the given signal plus noise. Returns false (and appends nothing) if
+	 * <zeroSuppressed> and the maximum charge is below the threshold.
+	 */
+	bool addStrip(bool isX, unsigned int strip,
+			const std::vector<double>& signal, bool zeroSuppressed,
+			SyntheticEvent& event);
+
+	SyntheticEventParameters parameters;
+	std::mt19937 random;
+	unsigned int numberOfEvents;
+	double timeOfLastEvent; // seconds
+};
+
+#endif /* SYNTHETICEVENTGENERATOR_H_ */